@@ -0,0 +1,47 @@
+/*
+** Bax Benchmarks, 2021
+** Benoît Lormeau <blormeau@outlook.com>
+** AST dump benchmarks
+*/
+
+#include "Bax/Compiler/ASTWriter.hpp"
+#include "Bax/Compiler/Parser.hpp"
+#include "Bench.hpp"
+#include "Common/Arena.hpp"
+#include "Common/StringPool.hpp"
+#include "Common/SymbolTable.hpp"
+#include <cstdio>
+
+// -----------------------------------------------------------------------------
+
+// `bax --ast <format>` minus the compilation: the corpus' tree, dumped then
+// written to /dev/null
+static void ASTWriter_write(benchmark::State& state, std::string_view format)
+{
+	auto& source = Bench::corpus(state);
+	StringPool strings;
+	SymbolTable symbols;
+	Arena nodes;
+	auto tree = Bax::Parser(Bax::Lexer(source), strings, symbols, nodes).run();
+	if (!tree) {
+		state.SkipWithError("The corpus does not parse");
+		return;
+	}
+
+	FILE* null = std::fopen("/dev/null", "w");
+	auto writer = Bax::ASTWriter::make(format);
+	size_t output = 0;
+
+	size_t allocations = Bench::allocations();
+	for (auto _ : state) {
+		writer->write(tree);
+		output = writer->buffer().size();
+		writer->flush(null);
+	}
+	Bench::report(state, source.size(), 0, Bench::count_nodes(tree), allocations);
+	state.counters["output"] = output;
+	std::fclose(null);
+}
+BENCHMARK_CAPTURE(ASTWriter_write, text, "text")->Apply(Bench::corpus_arguments);
+BENCHMARK_CAPTURE(ASTWriter_write, json, "json")->Apply(Bench::corpus_arguments);
+BENCHMARK_CAPTURE(ASTWriter_write, binary, "binary")->Apply(Bench::corpus_arguments);
@@ -0,0 +1,114 @@
+/*
+** Bax Benchmarks, 2021
+** Benoît Lormeau <blormeau@outlook.com>
+** Bench.cpp
+*/
+
+#include "Bench.hpp"
+#include "Corpus.hpp"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+// -----------------------------------------------------------------------------
+
+static std::atomic<size_t> s_allocations = 0;
+
+// Never inlined, or GCC pairs `operator new` with the inlined `free`, or
+// `malloc` with `operator delete`, and warns of a mismatch
+[[gnu::noinline]] void* operator new(size_t size)
+{
+	s_allocations.fetch_add(1, std::memory_order_relaxed);
+	if (void* pointer = std::malloc(size ? size : 1))
+		return pointer;
+	throw std::bad_alloc();
+}
+
+[[gnu::noinline]] void operator delete(void* pointer) noexcept
+{
+	std::free(pointer);
+}
+
+[[gnu::noinline]] void operator delete(void* pointer, size_t) noexcept
+{
+	std::free(pointer);
+}
+
+// -----------------------------------------------------------------------------
+
+namespace Bench
+{
+
+void corpus_arguments(benchmark::internal::Benchmark* benchmark)
+{
+	std::vector<int64_t> shapes;
+	for (auto shape : Corpus::shapes)
+		shapes.push_back(static_cast<int64_t>(shape));
+
+	benchmark->ArgNames({ "shape", "bytes" });
+	benchmark->ArgsProduct({ shapes, { 1 << 10, 1 << 20, 100 << 20 } });
+	benchmark->Unit(benchmark::kMillisecond);
+}
+
+const std::string& corpus(benchmark::State& state)
+{
+	static Corpus::Shape s_shape;
+	static size_t s_size = 0;
+	static std::string s_corpus;
+
+	auto shape = static_cast<Corpus::Shape>(state.range(0));
+	auto size = static_cast<size_t>(state.range(1));
+	if (shape != s_shape || size != s_size) {
+		s_corpus = {};
+		s_corpus = Corpus::generate(shape, size);
+		s_shape = shape;
+		s_size = size;
+	}
+
+	state.SetLabel(std::string(Corpus::shape_name(shape)));
+	return s_corpus;
+}
+
+size_t allocations()
+{
+	return s_allocations.load(std::memory_order_relaxed);
+}
+
+size_t count_nodes(Bax::Ptr<const Bax::AST::Node> root)
+{
+	using namespace Bax::AST;
+
+	size_t count = 0;
+	std::vector<const Node*> pending = { root };
+
+	while (!pending.empty()) {
+		const Node* node = pending.back();
+		pending.pop_back();
+		if (!node)
+			continue;
+		++count;
+
+		for_each_child(*node, [&] (const Node* child) { pending.push_back(child); });
+	}
+
+	return count;
+}
+
+void report(benchmark::State& state, size_t bytes, size_t tokens, size_t nodes, size_t allocations_before)
+{
+	auto iterations = static_cast<double>(state.iterations());
+
+	state.SetBytesProcessed(static_cast<int64_t>(bytes * state.iterations()));
+	if (tokens != 0)
+		state.counters["tokens"] = benchmark::Counter(tokens * iterations, benchmark::Counter::kIsRate);
+	if (nodes != 0)
+		state.counters["nodes"] = benchmark::Counter(nodes * iterations, benchmark::Counter::kIsRate);
+	state.counters["allocs"] = benchmark::Counter(
+		static_cast<double>(allocations() - allocations_before),
+		benchmark::Counter::kAvgIterations
+	);
+}
+
+}
@@ -0,0 +1,39 @@
+/*
+** Bax Benchmarks, 2021
+** Benoît Lormeau <blormeau@outlook.com>
+** Bench.hpp
+*/
+
+#pragma once
+
+// -----------------------------------------------------------------------------
+
+#include "Bax/Compiler/AST.hpp"
+#include "benchmark/benchmark.h"
+#include <cstddef>
+#include <string>
+
+// -----------------------------------------------------------------------------
+
+// Shared by every benchmark: corpora, counters and their reporting
+namespace Bench
+{
+
+// Registers every corpus shape at 1 KB, 1 MB and 100 MB, as (shape, size) arguments
+void corpus_arguments(benchmark::internal::Benchmark* benchmark);
+
+// The corpus of the running benchmark. Only the last one is kept, since 100 MB
+// ones would not all fit in memory.
+const std::string& corpus(benchmark::State& state);
+
+// Calls to `operator new` since the program started, from any thread
+size_t allocations();
+
+// Nodes reachable from `root`, `root` included
+size_t count_nodes(Bax::Ptr<const Bax::AST::Node> root);
+
+// Rates per second of the work done by every iteration, and the allocations
+// made by each of them since `allocations_before`. Counts of 0 are not reported.
+void report(benchmark::State& state, size_t bytes, size_t tokens, size_t nodes, size_t allocations_before);
+
+}
@@ -0,0 +1,79 @@
+/*
+** Bax Benchmarks, 2021
+** Benoît Lormeau <blormeau@outlook.com>
+** Compiler benchmarks
+*/
+
+#include "Bax/Compiler/Compiler.hpp"
+#include "Bench.hpp"
+#include "Common/Log.hpp"
+#include "Corpus.hpp"
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+// -----------------------------------------------------------------------------
+
+// The whole pipeline, as run for `bax -i <code>`
+static void Compiler_do_string(benchmark::State& state)
+{
+	auto& source = Bench::corpus(state);
+	size_t tokens = Bax::Lexer(source).tokenize_all().size() - 1;
+	size_t nodes = 0;
+
+	// `do_string()` traces the whole source at the debug level
+	Log::set_level(Log::Warning);
+
+	size_t allocations = Bench::allocations();
+	for (auto _ : state) {
+		Bax::Compiler compiler;
+		if (!compiler.do_string(source)) {
+			state.SkipWithError("The corpus does not compile");
+			break;
+		}
+
+		if (nodes == 0) {
+			state.PauseTiming();
+			nodes = Bench::count_nodes(compiler.ast());
+			state.ResumeTiming();
+		}
+	}
+	Bench::report(state, source.size(), tokens, nodes, allocations);
+}
+BENCHMARK(Compiler_do_string)->Apply(Bench::corpus_arguments);
+
+// `bax -l` over a tree of 64 files of 256 KB, on 1 to 8 threads
+static void Compiler_do_files(benchmark::State& state)
+{
+	static const auto root = std::filesystem::temp_directory_path() / ("bax-bench-" + std::to_string(getpid()));
+	static const std::vector<std::string> files = [] {
+		std::vector<std::string> files;
+		std::filesystem::create_directories(root);
+		for (uint64_t i = 0; i < 64; ++i) {
+			files.push_back((root / (std::to_string(i) + ".bax")).string());
+			std::ofstream(files.back()) << Corpus::generate(Corpus::Shape::Mixed, 256 * 1024, Corpus::default_seed + i);
+		}
+		std::atexit([] { std::filesystem::remove_all(root); });
+		return files;
+	}();
+	size_t bytes = 0;
+	for (auto& file : files)
+		bytes += std::filesystem::file_size(file);
+
+	Log::set_level(Log::Warning);
+
+	size_t allocations = Bench::allocations();
+	for (auto _ : state) {
+		Bax::Compiler compiler;
+		compiler.set_thread_count(state.range(0));
+		if (!compiler.do_files(files)) {
+			state.SkipWithError("The corpus does not compile");
+			break;
+		}
+	}
+	Bench::report(state, bytes, 0, 0, allocations);
+}
+BENCHMARK(Compiler_do_files)->ArgName("threads")->Arg(1)->Arg(2)->Arg(4)->Arg(8)->Unit(benchmark::kMillisecond)->UseRealTime();
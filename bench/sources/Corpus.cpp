@@ -0,0 +1,459 @@
+/*
+** Bax Benchmarks, 2021
+** Benoît Lormeau <blormeau@outlook.com>
+** Corpus.cpp
+*/
+
+#include "Corpus.hpp"
+#include <random>
+#include <vector>
+
+// -----------------------------------------------------------------------------
+
+namespace Corpus
+{
+
+namespace
+{
+
+constexpr const char* names[] = {
+	"buffer", "count", "current", "delta", "entry", "first", "index", "item",
+	"last", "left", "length", "limit", "node", "offset", "parent", "result",
+	"right", "scale", "size", "source", "target", "total", "value", "width",
+};
+
+constexpr const char* callees[] = {
+	"append", "compute", "emit", "flush", "insert", "print", "println", "reduce",
+	"resize", "update", "visit", "write",
+};
+
+constexpr const char* binary_operators[] = {
+	"+", "-", "*", "/", "%", "**", "<<", ">>", "&", "|", "^", "&&", "||", "??",
+	"?:", "==", "!=", "<", "<=", ">", ">=",
+};
+
+constexpr const char* assignment_operators[] = {
+	"=", "+=", "-=", "*=", "/=", "%=", "**=", "<<=", ">>=", "&=", "|=", "^=",
+	"&&=", "||=", "?\?=",
+};
+
+constexpr const char* unary_operators[] = { "-", "+", "!", "~" };
+
+constexpr const char* member_operators[] = { ".", "?.", "::" };
+
+constexpr const char* numbers[] = {
+	"0", "1", "2", "10", "42", "255", "1024", "65536", "3.14159", "0.5",
+	"6.02214076e23", "1e-9", "2.5E+10", "0x1F", "0xDEADBEEF", "0b101101",
+	"0o755", "18446744073709551615", "123456789.987654321",
+};
+
+constexpr const char* glyphs[] = {
+	"'a'", "'Z'", "'0'", "' '", "'\\n'", "'\\t'", "'\\''", "'\\\\'", "'\\u00e9'",
+};
+
+constexpr const char* escapes[] = { "\\n", "\\t", "\\\"", "\\\\", "\\u00e9", "\\u2603" };
+
+constexpr std::string_view text_alphabet =
+	"abcdefghijklmnopqrstuvwxyz ABCDEFGHIJKLMNOPQRSTUVWXYZ 0123456789 .,;:!?-+*/()[]{}<>=_";
+
+// -----------------------------------------------------------------------------
+
+class Generator
+{
+	// Only the raw engine output is used: distributions are implementation-defined
+	std::mt19937_64 m_random;
+	std::string m_out;
+
+public:
+	explicit Generator(uint64_t seed)
+	: m_random(seed)
+	{}
+
+	std::string run(Shape shape, size_t size)
+	{
+		m_out.reserve(size + 64 * 1024);
+		m_out += "{\n";
+		while (m_out.size() < size) {
+			switch (shape) {
+				case Shape::Mixed:        mixed_statement(1, 0); break;
+				case Shape::DeepNesting:  nested_statement(); break;
+				case Shape::LongLiterals: literal_statement(); break;
+				case Shape::OperatorSoup: operator_statement(); break;
+			}
+		}
+		m_out += "}\n";
+		return std::move(m_out);
+	}
+
+	std::string run_long_expression(size_t terms)
+	{
+		m_out.reserve(terms * 12 + 64);
+		m_out += "{\n\tresult = ";
+		for (size_t i = 0; i < terms; ++i) {
+			if (i > 0) {
+				m_out += ' ';
+				m_out += pick(binary_operators);
+				m_out += ' ';
+			}
+			operand(0);
+		}
+		m_out += ";\n}\n";
+		return std::move(m_out);
+	}
+
+private:
+	size_t below(size_t bound) { return m_random() % bound; }
+	bool chance(size_t percent) { return below(100) < percent; }
+
+	template <size_t N>
+	const char* pick(const char* const (&items)[N]) { return items[below(N)]; }
+
+	void indent(size_t level) { m_out.append(level, '\t'); }
+
+	// -------------------------------------------------------------------------
+
+	void identifier()
+	{
+		m_out += pick(names);
+		if (chance(40))
+			m_out += std::to_string(below(100));
+	}
+
+	void string(size_t length, size_t escape_percent)
+	{
+		m_out += '"';
+		for (size_t i = 0; i < length; ++i) {
+			if (escape_percent != 0 && chance(escape_percent))
+				m_out += pick(escapes);
+			else
+				m_out += text_alphabet[below(text_alphabet.size())];
+		}
+		m_out += '"';
+	}
+
+	void operand(size_t depth)
+	{
+		switch (below(depth > 0 ? 12 : 8)) {
+			case 0: case 1: case 2:
+				identifier();
+				break;
+			case 3: case 4:
+				m_out += pick(numbers);
+				break;
+			case 5:
+				string(4 + below(24), 5);
+				break;
+			case 6:
+				m_out += pick(glyphs);
+				break;
+			case 7:
+				m_out += pick({ "true", "false", "null" });
+				break;
+			case 8:
+				identifier();
+				m_out += pick(member_operators);
+				identifier();
+				break;
+			case 9:
+				m_out += pick(callees);
+				m_out += '(';
+				for (size_t i = 0, count = below(4); i < count; ++i) {
+					if (i != 0) m_out += ", ";
+					expression(depth - 1, 1 + below(3));
+				}
+				m_out += ')';
+				break;
+			case 10:
+				identifier();
+				m_out += '[';
+				expression(depth - 1, 1 + below(2));
+				m_out += ']';
+				break;
+			case 11:
+				m_out += '(';
+				expression(depth - 1, 2 + below(4));
+				m_out += ')';
+				break;
+		}
+	}
+
+	void expression(size_t depth, size_t terms)
+	{
+		for (size_t i = 0; i < terms; ++i) {
+			if (i != 0) {
+				m_out += ' ';
+				m_out += pick(binary_operators);
+				m_out += ' ';
+			}
+			if (chance(10))
+				m_out += pick(unary_operators);
+			operand(depth);
+		}
+		if (depth > 0 && chance(5)) {
+			m_out += " ? ";
+			operand(depth - 1);
+			m_out += " : ";
+			operand(depth - 1);
+		}
+	}
+
+	// -------------------------------------------------------------------------
+
+	void mixed_statement(size_t level, size_t depth)
+	{
+		indent(level);
+		switch (below(depth < 3 ? 10 : 6)) {
+			case 0: case 1:
+				m_out += pick({ "let ", "const ", "static let ", "static const " });
+				identifier();
+				m_out += " = ";
+				expression(2, 1 + below(4));
+				m_out += ";\n";
+				break;
+			case 2:
+				identifier();
+				m_out += ' ';
+				m_out += pick(assignment_operators);
+				m_out += ' ';
+				expression(2, 1 + below(4));
+				m_out += ";\n";
+				break;
+			case 3: case 4:
+				m_out += pick(callees);
+				m_out += '(';
+				for (size_t i = 0, count = below(4); i < count; ++i) {
+					if (i != 0) m_out += ", ";
+					expression(1, 1 + below(3));
+				}
+				m_out += ");\n";
+				break;
+			case 5:
+				identifier();
+				m_out += pick({ "++", "--" });
+				m_out += ";\n";
+				break;
+			case 6:
+				m_out += "if (";
+				expression(1, 1 + below(3));
+				m_out += ") ";
+				mixed_block(level, depth + 1);
+				if (chance(40)) {
+					m_out.back() = ' ';
+					m_out += "else ";
+					mixed_block(level, depth + 1);
+				}
+				break;
+			case 7:
+				m_out += "while (";
+				expression(1, 1 + below(3));
+				m_out += ") ";
+				mixed_block(level, depth + 1);
+				break;
+			case 8:
+				m_out += "const ";
+				identifier();
+				m_out += " = function (";
+				for (size_t i = 0, count = below(4); i < count; ++i) {
+					if (i != 0) m_out += ", ";
+					identifier();
+				}
+				m_out += ") {\n";
+				for (size_t i = 0, count = 1 + below(5); i < count; ++i)
+					mixed_statement(level + 1, depth + 1);
+				indent(level + 1);
+				m_out += "return ";
+				expression(1, 1 + below(3));
+				m_out += ";\n";
+				indent(level);
+				m_out += "};\n";
+				break;
+			case 9:
+				m_out += "const ";
+				identifier();
+				m_out += " = match (";
+				identifier();
+				m_out += ") {\n";
+				for (size_t i = 0, count = 1 + below(4); i < count; ++i) {
+					indent(level + 1);
+					m_out += pick(numbers);
+					m_out += " => ";
+					expression(1, 1 + below(2));
+					m_out += ",\n";
+				}
+				indent(level + 1);
+				m_out += "default => ";
+				string(8, 0);
+				m_out += ",\n";
+				indent(level);
+				m_out += "};\n";
+				break;
+		}
+	}
+
+	void mixed_block(size_t level, size_t depth)
+	{
+		m_out += "{\n";
+		for (size_t i = 0, count = 1 + below(4); i < count; ++i)
+			mixed_statement(level + 1, depth);
+		indent(level);
+		m_out += "}\n";
+	}
+
+	// Nests up to 48 statements, then up to 32 expressions, in a single chain
+	void nested_statement()
+	{
+		std::vector<const char*> closers;
+		size_t depth = 16 + below(33);
+
+		for (size_t level = 1; level <= depth; ++level) {
+			indent(level);
+			switch (below(4)) {
+				case 0:
+					m_out += "if (";
+					expression(1, 1 + below(2));
+					m_out += ") {\n";
+					closers.push_back("}\n");
+					break;
+				case 1:
+					m_out += "while (";
+					expression(1, 1 + below(2));
+					m_out += ") {\n";
+					closers.push_back("}\n");
+					break;
+				case 2:
+					m_out += "{\n";
+					closers.push_back("}\n");
+					break;
+				case 3:
+					m_out += "const ";
+					identifier();
+					m_out += " = function (";
+					identifier();
+					m_out += ") {\n";
+					closers.push_back("};\n");
+					break;
+			}
+		}
+
+		indent(depth + 1);
+		identifier();
+		m_out += " = ";
+		nested_expression(8 + below(25));
+		m_out += ";\n";
+
+		for (size_t level = depth; level >= 1; --level) {
+			indent(level);
+			m_out += closers[level - 1];
+		}
+	}
+
+	void nested_expression(size_t depth)
+	{
+		if (depth == 0) {
+			operand(0);
+			return;
+		}
+
+		const char* closer = ")";
+		switch (below(3)) {
+			case 0: m_out += '('; break;
+			case 1: m_out += '['; closer = "]"; break;
+			case 2: m_out += pick(callees); m_out += '('; break;
+		}
+		nested_expression(depth - 1);
+		if (chance(50)) {
+			m_out += ' ';
+			m_out += pick(binary_operators);
+			m_out += ' ';
+			operand(0);
+		}
+		m_out += closer;
+	}
+
+	void literal_statement()
+	{
+		indent(1);
+		switch (below(4)) {
+			case 0: case 1:
+				m_out += "const ";
+				identifier();
+				m_out += " = ";
+				string(256 + below(3841), chance(25) ? 2 : 0);
+				m_out += ";\n";
+				break;
+			case 2:
+				m_out += "let ";
+				identifier();
+				m_out += " = [";
+				for (size_t i = 0, count = 32 + below(225); i < count; ++i) {
+					if (i != 0) m_out += ", ";
+					m_out += pick(numbers);
+				}
+				m_out += "];\n";
+				break;
+			case 3:
+				m_out += pick(callees);
+				m_out += '(';
+				string(64 + below(449), 1);
+				m_out += ", ";
+				m_out += pick(glyphs);
+				m_out += ", ";
+				m_out += std::to_string(m_random());
+				m_out += '.';
+				m_out += std::to_string(m_random());
+				m_out += ");\n";
+				break;
+		}
+	}
+
+	void operator_statement()
+	{
+		indent(1);
+		identifier();
+		if (chance(30)) {
+			m_out += pick(member_operators);
+			identifier();
+		}
+		m_out += ' ';
+		m_out += pick(assignment_operators);
+		m_out += ' ';
+		expression(3, 8 + below(57));
+		m_out += ";\n";
+	}
+};
+
+}
+
+// -----------------------------------------------------------------------------
+
+std::string_view shape_name(Shape shape)
+{
+	switch (shape) {
+		case Shape::Mixed:        return "mixed";
+		case Shape::DeepNesting:  return "deep-nesting";
+		case Shape::LongLiterals: return "long-literals";
+		case Shape::OperatorSoup: return "operator-soup";
+	}
+	return "unknown";
+}
+
+std::optional<Shape> shape_from_name(std::string_view name)
+{
+	for (auto shape : shapes) {
+		if (shape_name(shape) == name)
+			return shape;
+	}
+	return std::nullopt;
+}
+
+std::string generate(Shape shape, size_t size, uint64_t seed)
+{
+	return Generator(seed).run(shape, size);
+}
+
+std::string long_expression(size_t terms, uint64_t seed)
+{
+	return Generator(seed).run_long_expression(terms);
+}
+
+}
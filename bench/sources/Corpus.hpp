@@ -0,0 +1,52 @@
+/*
+** Bax Benchmarks, 2021
+** Benoît Lormeau <blormeau@outlook.com>
+** Corpus.hpp
+*/
+
+#pragma once
+
+// -----------------------------------------------------------------------------
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+
+// -----------------------------------------------------------------------------
+
+// Synthetic, valid Bax programs. The same shape, size and seed always yield the
+// same bytes, whatever the platform, so numbers stay comparable across runs.
+namespace Corpus
+{
+
+enum class Shape
+{
+	Mixed,        // Declarations, calls, conditions and loops, like real code
+	DeepNesting,  // Blocks, conditions and parentheses nested dozens deep
+	LongLiterals, // Kilobyte-long strings, long numbers and big arrays
+	OperatorSoup, // Long chains of every unary, binary and assignment operator
+};
+
+constexpr Shape shapes[] = {
+	Shape::Mixed,
+	Shape::DeepNesting,
+	Shape::LongLiterals,
+	Shape::OperatorSoup,
+};
+
+constexpr uint64_t default_seed = 0xBA7;
+
+std::string_view shape_name(Shape shape);
+std::optional<Shape> shape_from_name(std::string_view name);
+
+// A single block statement of about `size` bytes (slightly more, so the last
+// statement and the closing braces fit)
+std::string generate(Shape shape, size_t size, uint64_t seed = default_seed);
+
+// A block statement with a single assignment, whose value is `terms` operands
+// joined by random binary operators, left- and right-associative ones alike
+std::string long_expression(size_t terms, uint64_t seed = default_seed);
+
+}
@@ -0,0 +1,96 @@
+/*
+** Bax Benchmarks, 2021
+** Benoît Lormeau <blormeau@outlook.com>
+** Flat AST benchmarks
+*/
+
+#include "Bax/Compiler/FlatAST.hpp"
+#include "Bax/Compiler/Parser.hpp"
+#include "Bench.hpp"
+#include "Common/Arena.hpp"
+#include "Common/StringPool.hpp"
+#include "Common/SymbolTable.hpp"
+
+// -----------------------------------------------------------------------------
+
+namespace
+{
+
+// The tree of the running benchmark's corpus
+struct ParsedCorpus
+{
+	StringPool strings;
+	SymbolTable symbols;
+	Arena nodes;
+	Bax::Ptr<Bax::AST::Node> tree = nullptr;
+
+	ParsedCorpus(const std::string& source)
+	{
+		tree = Bax::Parser(Bax::Lexer(source), strings, symbols, nodes).run();
+	}
+};
+
+}
+
+// -----------------------------------------------------------------------------
+
+static void FlatAST_from_tree(benchmark::State& state)
+{
+	auto& source = Bench::corpus(state);
+	ParsedCorpus corpus(source);
+	if (!corpus.tree) {
+		state.SkipWithError("The corpus does not parse");
+		return;
+	}
+	size_t nodes = Bench::count_nodes(corpus.tree);
+
+	size_t allocations = Bench::allocations();
+	for (auto _ : state) {
+		auto flat = Bax::FlatAST::from_tree(corpus.tree);
+		benchmark::DoNotOptimize(flat.kinds.data());
+	}
+	Bench::report(state, source.size(), 0, nodes, allocations);
+}
+BENCHMARK(FlatAST_from_tree)->Apply(Bench::corpus_arguments);
+
+// A pass over every node, as a linear scan of the flat arrays. Compare with
+// AST_walk, the same pass over the pointer tree.
+static void FlatAST_walk(benchmark::State& state)
+{
+	auto& source = Bench::corpus(state);
+	ParsedCorpus corpus(source);
+	if (!corpus.tree) {
+		state.SkipWithError("The corpus does not parse");
+		return;
+	}
+	auto flat = Bax::FlatAST::from_tree(corpus.tree);
+
+	size_t allocations = Bench::allocations();
+	for (auto _ : state) {
+		size_t count = 0;
+		for (auto kind : flat.kinds)
+			count += kind != Bax::FlatAST::Kind::Null;
+		benchmark::DoNotOptimize(count);
+	}
+	Bench::report(state, source.size(), 0, flat.size(), allocations);
+}
+BENCHMARK(FlatAST_walk)->Apply(Bench::corpus_arguments);
+
+static void AST_walk(benchmark::State& state)
+{
+	auto& source = Bench::corpus(state);
+	ParsedCorpus corpus(source);
+	if (!corpus.tree) {
+		state.SkipWithError("The corpus does not parse");
+		return;
+	}
+	size_t nodes = 0;
+
+	size_t allocations = Bench::allocations();
+	for (auto _ : state) {
+		nodes = Bench::count_nodes(corpus.tree);
+		benchmark::DoNotOptimize(nodes);
+	}
+	Bench::report(state, source.size(), 0, nodes, allocations);
+}
+BENCHMARK(AST_walk)->Apply(Bench::corpus_arguments);
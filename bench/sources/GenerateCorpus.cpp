@@ -0,0 +1,64 @@
+/*
+** Bax Benchmarks, 2021
+** Benoît Lormeau <blormeau@outlook.com>
+** Corpus generator entry point
+*/
+
+#include "Common/OptionParser.hpp"
+#include "Corpus.hpp"
+#include "fmt/format.h"
+#include <cstdio>
+#include <string>
+
+// -----------------------------------------------------------------------------
+
+// Parses sizes like `1024`, `64K` or `100M`
+static bool parse_size(const std::string& text, size_t& size)
+{
+	size_t end = 0;
+	try {
+		size = std::stoull(text, &end);
+	}
+	catch (const std::exception&) {
+		return false;
+	}
+
+	std::string suffix = text.substr(end);
+	if (suffix == "K" || suffix == "k")
+		size <<= 10;
+	else if (suffix == "M" || suffix == "m")
+		size <<= 20;
+	else if (!suffix.empty())
+		return false;
+	return true;
+}
+
+int main(int argc, char** argv)
+{
+	std::string shape_name;
+	std::string size_text;
+	int seed = Corpus::default_seed;
+
+	OptionParser opt;
+	opt.add_option(seed, 's', "seed", "Seed of the generator", "seed");
+	opt.add_argument(shape_name, "shape", "mixed, deep-nesting, long-literals or operator-soup");
+	opt.add_argument(size_text, "size", "Size of the corpus, in bytes, or with a K or M suffix");
+	if (!opt.parse(argc, argv))
+		return EXIT_FAILURE;
+
+	auto shape = Corpus::shape_from_name(shape_name);
+	if (!shape) {
+		fmt::print(stderr, "Unknown corpus shape '{}'\n", shape_name);
+		return EXIT_FAILURE;
+	}
+
+	size_t size = 0;
+	if (!parse_size(size_text, size)) {
+		fmt::print(stderr, "Invalid corpus size '{}'\n", size_text);
+		return EXIT_FAILURE;
+	}
+
+	auto corpus = Corpus::generate(*shape, size, static_cast<uint64_t>(seed));
+	std::fwrite(corpus.data(), 1, corpus.size(), stdout);
+	return EXIT_SUCCESS;
+}
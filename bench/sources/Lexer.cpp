@@ -0,0 +1,43 @@
+/*
+** Bax Benchmarks, 2021
+** Benoît Lormeau <blormeau@outlook.com>
+** Lexer benchmarks
+*/
+
+#include "Bax/Compiler/Lexer.hpp"
+#include "Bench.hpp"
+
+// -----------------------------------------------------------------------------
+
+static void Lexer_next(benchmark::State& state)
+{
+	auto& source = Bench::corpus(state);
+	size_t tokens = 0;
+
+	size_t allocations = Bench::allocations();
+	for (auto _ : state) {
+		Bax::Lexer lexer(source);
+		tokens = 0;
+		while (lexer.next().type != Bax::Token::Type::Eof)
+			++tokens;
+		benchmark::DoNotOptimize(tokens);
+	}
+	Bench::report(state, source.size(), tokens, 0, allocations);
+}
+BENCHMARK(Lexer_next)->Apply(Bench::corpus_arguments);
+
+static void Lexer_tokenize_all(benchmark::State& state)
+{
+	auto& source = Bench::corpus(state);
+	size_t tokens = 0;
+
+	size_t allocations = Bench::allocations();
+	for (auto _ : state) {
+		auto stream = Bax::Lexer(source).tokenize_all();
+		// Without the trailing Eof, as counted by Lexer_next
+		tokens = stream.size() - 1;
+		benchmark::DoNotOptimize(stream.types.data());
+	}
+	Bench::report(state, source.size(), tokens, 0, allocations);
+}
+BENCHMARK(Lexer_tokenize_all)->Apply(Bench::corpus_arguments);
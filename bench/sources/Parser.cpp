@@ -0,0 +1,72 @@
+/*
+** Bax Benchmarks, 2021
+** Benoît Lormeau <blormeau@outlook.com>
+** Parser benchmarks
+*/
+
+#include "Bax/Compiler/Parser.hpp"
+#include "Bench.hpp"
+#include "Corpus.hpp"
+#include "Common/Arena.hpp"
+#include "Common/StringPool.hpp"
+#include "Common/SymbolTable.hpp"
+
+// -----------------------------------------------------------------------------
+
+// Parses and frees the AST of the whole corpus, with the tokens it is made of
+static void Parser_run(benchmark::State& state)
+{
+	auto& source = Bench::corpus(state);
+	size_t tokens = Bax::Lexer(source).tokenize_all().size() - 1;
+	size_t nodes = 0;
+
+	size_t allocations = Bench::allocations();
+	for (auto _ : state) {
+		StringPool strings;
+		SymbolTable symbols;
+		Arena arena;
+		Bax::Parser parser(Bax::Lexer(source), strings, symbols, arena);
+		auto ast = parser.run();
+		if (!ast) {
+			state.SkipWithError("The corpus does not parse");
+			break;
+		}
+
+		if (nodes == 0) {
+			state.PauseTiming();
+			nodes = Bench::count_nodes(ast);
+			state.ResumeTiming();
+		}
+	}
+	Bench::report(state, source.size(), tokens, nodes, allocations);
+}
+BENCHMARK(Parser_run)->Apply(Bench::corpus_arguments);
+
+// A single expression of a million operands, which must not overflow the stack
+static void Parser_long_expression(benchmark::State& state)
+{
+	static const std::string source = Corpus::long_expression(1'000'000);
+	size_t tokens = Bax::Lexer(source).tokenize_all().size() - 1;
+	size_t nodes = 0;
+
+	size_t allocations = Bench::allocations();
+	for (auto _ : state) {
+		StringPool strings;
+		SymbolTable symbols;
+		Arena arena;
+		Bax::Parser parser(Bax::Lexer(source), strings, symbols, arena);
+		auto ast = parser.run();
+		if (!ast) {
+			state.SkipWithError("The expression does not parse");
+			break;
+		}
+
+		if (nodes == 0) {
+			state.PauseTiming();
+			nodes = Bench::count_nodes(ast);
+			state.ResumeTiming();
+		}
+	}
+	Bench::report(state, source.size(), tokens, nodes, allocations);
+}
+BENCHMARK(Parser_long_expression)->Unit(benchmark::kMillisecond);
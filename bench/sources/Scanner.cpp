@@ -0,0 +1,105 @@
+/*
+** Bax Benchmarks, 2021
+** Benoît Lormeau <blormeau@outlook.com>
+** Scanner benchmarks
+*/
+
+#include "Bench.hpp"
+#include "Common/GenericLexer.hpp"
+#include "Common/Scanner.hpp"
+#include <string>
+
+// -----------------------------------------------------------------------------
+
+// Runs of trivia as long as the first argument, then the byte that ends them.
+// Each is skipped by the Scanner, and byte by byte as the lexer used to.
+
+static void trivia_arguments(benchmark::internal::Benchmark* benchmark)
+{
+	benchmark->ArgName("bytes");
+	benchmark->RangeMultiplier(16)->Range(16, 1 << 20);
+}
+
+static std::string trivia(size_t length, std::string_view pattern, char end)
+{
+	std::string input;
+	input.reserve(length + 1);
+	while (input.size() < length)
+		input += pattern;
+	input.resize(length);
+	input += end;
+	return input;
+}
+
+static void scan(benchmark::State& state, const std::string& input, auto skip)
+{
+	size_t allocations = Bench::allocations();
+	for (auto _ : state) {
+		size_t index = skip(input);
+		benchmark::DoNotOptimize(index);
+	}
+	state.SetLabel(Scanner::implementation());
+	Bench::report(state, input.size(), 0, 0, allocations);
+}
+
+// -----------------------------------------------------------------------------
+
+// Indentation and blank lines
+static void Scanner_skip_whitespace(benchmark::State& state)
+{
+	auto input = trivia(state.range(0), "\n\t\t    ", 'x');
+	scan(state, input, [] (std::string_view s) { return Scanner::skip_whitespace(s, 0); });
+}
+BENCHMARK(Scanner_skip_whitespace)->Apply(trivia_arguments);
+
+static void Scanner_skip_whitespace_bytewise(benchmark::State& state)
+{
+	auto input = trivia(state.range(0), "\n\t\t    ", 'x');
+	scan(state, input, [] (std::string_view s) {
+		size_t i = 0;
+		while (i < s.length() && GenericLexer::is_whitespace(s[i]))
+			++i;
+		return i;
+	});
+}
+BENCHMARK(Scanner_skip_whitespace_bytewise)->Apply(trivia_arguments);
+
+// The rest of a line comment
+static void Scanner_find(benchmark::State& state)
+{
+	auto input = trivia(state.range(0), "// ---- comment ---- ", '\n');
+	scan(state, input, [] (std::string_view s) { return Scanner::find(s, 0, '\n'); });
+}
+BENCHMARK(Scanner_find)->Apply(trivia_arguments);
+
+static void Scanner_find_bytewise(benchmark::State& state)
+{
+	auto input = trivia(state.range(0), "// ---- comment ---- ", '\n');
+	scan(state, input, [] (std::string_view s) {
+		size_t i = 0;
+		while (i < s.length() && s[i] != '\n')
+			++i;
+		return i;
+	});
+}
+BENCHMARK(Scanner_find_bytewise)->Apply(trivia_arguments);
+
+// The rest of a block comment, with stars that do not close it
+static void Scanner_find_pair(benchmark::State& state)
+{
+	auto input = trivia(state.range(0), " ** banner ** ", '*') + '/';
+	scan(state, input, [] (std::string_view s) { return Scanner::find(s, 0, '*', '/'); });
+}
+BENCHMARK(Scanner_find_pair)->Apply(trivia_arguments);
+
+static void Scanner_find_pair_bytewise(benchmark::State& state)
+{
+	auto input = trivia(state.range(0), " ** banner ** ", '*') + '/';
+	scan(state, input, [] (std::string_view s) {
+		size_t i = 0;
+		while (i + 1 < s.length() && !(s[i] == '*' && s[i + 1] == '/'))
+			++i;
+		return i;
+	});
+}
+BENCHMARK(Scanner_find_pair_bytewise)->Apply(trivia_arguments);
@@ -0,0 +1,97 @@
+/*
+** Bax Benchmarks, 2021
+** Benoît Lormeau <blormeau@outlook.com>
+** VM benchmarks
+*/
+
+#include "Bax/Compiler/Compiler.hpp"
+#include "Bax/VM/VM.hpp"
+#include "Bench.hpp"
+#include "Common/Log.hpp"
+#include <cstdio>
+#include <string>
+
+// -----------------------------------------------------------------------------
+
+// Sums 1M integers
+static const char* const loop = R"({
+	let sum = 0;
+	let i = 0;
+	while (i < 1000000) {
+		sum += i;
+		i++;
+	}
+	return sum;
+})";
+
+// Hashes 1M integers, whose operations never overflow
+static const char* const hash = R"({
+	let h = 0;
+	let i = 0;
+	while (i < 1000000) {
+		h = (h * 31 + i % 7) & 65535;
+		i++;
+	}
+	return h;
+})";
+
+// 21891 calls
+static const char* const fib = R"({
+	const fib = function(n) {
+		if (n < 2)
+			return n;
+		return fib(n - 1) + fib(n - 2);
+	};
+	return fib(20);
+})";
+
+// 100K matches, of strings built by the closure
+static const char* const fizzbuzz = R"({
+	let count = 0;
+	let i = 0;
+	const name = function() {
+		return match (0) {
+			i % 15  => "FizzBuzz",
+			i % 3   => "Fizz",
+			i % 5   => "Buzz",
+			default => i.toString(),
+		};
+	};
+	while (i < 100000) {
+		i++;
+		const s = name();
+		count += s.length();
+	}
+	return count;
+})";
+
+// Runs a program compiled once, `items` is the work done by every run
+static void VM_run(benchmark::State& state, const char* source, size_t items)
+{
+	Log::set_level(Log::Warning);
+	Bax::Compiler compiler;
+	if (!compiler.do_string(source)) {
+		state.SkipWithError("The program does not compile");
+		return;
+	}
+
+	size_t allocations = Bench::allocations();
+	for (auto _ : state) {
+		// A new VM each time, nothing is collected yet
+		Bax::VM vm;
+		if (!vm.run(*compiler.program())) {
+			state.SkipWithError("The program failed");
+			break;
+		}
+		benchmark::DoNotOptimize(vm.result());
+	}
+	state.SetItemsProcessed(static_cast<int64_t>(items * state.iterations()));
+	state.counters["allocs"] = benchmark::Counter(
+		static_cast<double>(Bench::allocations() - allocations),
+		benchmark::Counter::kAvgIterations
+	);
+}
+BENCHMARK_CAPTURE(VM_run, loop, loop, 1000000)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(VM_run, hash, hash, 1000000)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(VM_run, fib, fib, 21891)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(VM_run, fizzbuzz, fizzbuzz, 100000)->Unit(benchmark::kMillisecond);
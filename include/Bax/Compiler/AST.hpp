@@ -8,10 +8,43 @@
 
 // -----------------------------------------------------------------------------
 
+#include "Common/SymbolTable.hpp"
 #include "fmt/format.h"
-#include <map>
 #include <memory>
 #include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// -----------------------------------------------------------------------------
+
+// Concrete nodes: expressions, then literals, statements and declarations
+#define __ENUMERATE_AST_NODES            \
+	__ENUMERATE(Identifier)              \
+	__ENUMERATE(ArrayExpression)         \
+	__ENUMERATE(AssignmentExpression)    \
+	__ENUMERATE(BinaryExpression)        \
+	__ENUMERATE(CallExpression)          \
+	__ENUMERATE(FunctionExpression)      \
+	__ENUMERATE(MatchExpression)         \
+	__ENUMERATE(MemberExpression)        \
+	__ENUMERATE(ObjectExpression)        \
+	__ENUMERATE(SubscriptExpression)     \
+	__ENUMERATE(TernaryExpression)       \
+	__ENUMERATE(UnaryExpression)         \
+	__ENUMERATE(UpdateExpression)        \
+	__ENUMERATE(Null)                    \
+	__ENUMERATE(Boolean)                 \
+	__ENUMERATE(Glyph)                   \
+	__ENUMERATE(Number)                  \
+	__ENUMERATE(String)                  \
+	__ENUMERATE(BlockStatement)          \
+	__ENUMERATE(ExpressionStatement)     \
+	__ENUMERATE(IfStatement)             \
+	__ENUMERATE(ReturnStatement)         \
+	__ENUMERATE(WhileStatement)          \
+	__ENUMERATE(VariableDeclaration)
 
 // -----------------------------------------------------------------------------
 
@@ -20,76 +53,83 @@ namespace Bax
 	template <typename T>
 	using Own = std::unique_ptr<T>;
 
+	// Nodes live in the arena of their compilation, which frees them all at once
 	template <typename T>
-	using Ptr = std::shared_ptr<T>;
-
-	template <typename T, typename... Args>
-	Ptr<T> makeNode(Args&&... args) {
-		return std::make_shared<T>(std::forward<Args>(args)...);
-	}
+	using Ptr = T*;
 
 	namespace AST
 	{
-		namespace priv
+		/// 0. Basics ----------------------------------------------------------
+
+		enum class Kind : uint8_t
 		{
-			template <typename... Args>
-			constexpr void print(int indent, fmt::string_view format, Args&&... args) {
-				for (int i = 0; i < indent; ++i)
-					fmt::print("  ");
-				fmt::vprint(format, fmt::make_args_checked<Args...>(format, args...));
-			}
-		}
+#define __ENUMERATE(T) T,
+			__ENUMERATE_AST_NODES
+#undef __ENUMERATE
+		};
 
-		/// 0. Basics ----------------------------------------------------------
+#define __ENUMERATE(T) + 1
+		static constexpr size_t kind_count = 0 __ENUMERATE_AST_NODES;
+#undef __ENUMERATE
+
+		const char* kind_name(Kind);
 
 		struct Node
 		{
-			virtual ~Node() {}
-			virtual const char* class_name() const { return "Node"; }
-			virtual void dump(int i = 0) const {
-				priv::print(i, "{}\n", class_name());
-			}
+			// Type of the concrete node, for checks and dispatch without RTTI
+			const Kind kind;
+
+			const char* class_name() const { return kind_name(kind); }
+
+		protected:
+			Node(Kind k)
+			: kind(k)
+			{}
+
+			// Never deleted through a base pointer: the arena destroys nodes by
+			// their actual type, and skips those that are trivially destructible
+			~Node() = default;
 		};
 
 		/// 1. Expressions -----------------------------------------------------
 
 		struct Expression : public Node
 		{
-			virtual const char* class_name() const { return "Expression"; }
+		protected:
+			using Node::Node;
 		};
 
 		struct Identifier final : public Expression
 		{
-			std::string name;
+			static constexpr Kind node_kind = Kind::Identifier;
 
-			Identifier(std::string n)
-			: name(std::move(n))
-			{}
+			// Interned in the compilation's symbol table, which owns the name
+			Symbol symbol;
+			std::string_view name;
 
-			const char* class_name() const { return "Identifier"; }
-			void dump(int i = 0) const {
-				priv::print(i, "{}({})\n", class_name(), name);
-			}
+			Identifier(Symbol sym, std::string_view n)
+			: Expression(node_kind)
+			, symbol(sym)
+			, name(n)
+			{}
 		};
 
 		struct ArrayExpression final : public Expression
 		{
+			static constexpr Kind node_kind = Kind::ArrayExpression;
+
 			std::vector<Ptr<Expression>> elements;
 
 			ArrayExpression(std::vector<Ptr<Expression>> els)
-			: elements(std::move(els))
+			: Expression(node_kind)
+			, elements(std::move(els))
 			{}
-
-			const char* class_name() const { return "ArrayExpression"; }
-			void dump(int i = 0) const {
-				Node::dump(i);
-				for (auto &el : elements)
-					el->dump(i + 1);
-			}
 		};
 
 		struct AssignmentExpression final : public Expression
 		{
+			static constexpr Kind node_kind = Kind::AssignmentExpression;
+
 			enum class Operators {
 				Add,
 				Assign,
@@ -111,21 +151,17 @@ namespace Bax
 			Ptr<Expression> lhs, rhs;
 
 			AssignmentExpression(Operators o, Ptr<Expression> l, Ptr<Expression> r)
-			: op(o)
+			: Expression(node_kind)
+			, op(o)
 			, lhs(std::move(l))
 			, rhs(std::move(r))
 			{}
-
-			const char* class_name() const { return "AssignmentExpression"; }
-			void dump(int i = 0) const {
-				priv::print(i, "{}({})\n", class_name(), (int)op);
-				lhs->dump(i + 1);
-				rhs->dump(i + 1);
-			}
 		};
 
 		struct BinaryExpression final : public Expression
 		{
+			static constexpr Kind node_kind = Kind::BinaryExpression;
+
 			enum class Operators {
 				Add,
 				BitwiseAnd,
@@ -153,85 +189,64 @@ namespace Bax
 			Ptr<Expression> lhs, rhs;
 
 			BinaryExpression(Operators o, Ptr<Expression> l, Ptr<Expression> r)
-			: op(o)
+			: Expression(node_kind)
+			, op(o)
 			, lhs(std::move(l))
 			, rhs(std::move(r))
 			{}
-
-			const char* class_name() const { return "BinaryExpression"; }
-			void dump(int i = 0) const {
-				priv::print(i, "{}({})\n", class_name(), (int)op);
-				lhs->dump(i + 1);
-				rhs->dump(i + 1);
-			}
 		};
 
 		struct CallExpression final : public Expression
 		{
+			static constexpr Kind node_kind = Kind::CallExpression;
+
 			Ptr<Expression> lhs;
 			std::vector<Ptr<Expression>> arguments;
 
 			CallExpression(Ptr<Expression> l, std::vector<Ptr<Expression>> args)
-			: lhs(std::move(l))
+			: Expression(node_kind)
+			, lhs(std::move(l))
 			, arguments(std::move(args))
 			{}
-
-			const char* class_name() const { return "CallExpression"; }
-			void dump(int i = 0) const {
-				Node::dump(i);
-				lhs->dump(i + 1);
-				for (auto &arg : arguments)
-					arg->dump(i + 1);
-			}
 		};
 
 		struct BlockStatement;
 		struct FunctionExpression final : public Expression
 		{
+			static constexpr Kind node_kind = Kind::FunctionExpression;
+
 			using Parameter = Ptr<Expression>;
 
 			std::vector<Parameter> parameters;
 			Ptr<BlockStatement> body;
 
 			FunctionExpression(std::vector<Parameter> params, Ptr<BlockStatement> bd)
-			: parameters(std::move(params))
+			: Expression(node_kind)
+			, parameters(std::move(params))
 			, body(std::move(bd))
 			{}
-
-			const char* class_name() const { return "FunctionExpression"; }
-			void dump(int i = 0) const;
 		};
 
 		struct MatchExpression final : public Expression
 		{
+			static constexpr Kind node_kind = Kind::MatchExpression;
+
 			using CasesType = std::vector<std::pair<std::vector<Ptr<Expression>>, Ptr<Expression>>>;
 
 			Ptr<Expression> subject;
 			CasesType cases;
 
 			MatchExpression(Ptr<Expression> s, CasesType c)
-			: subject(std::move(s))
+			: Expression(node_kind)
+			, subject(std::move(s))
 			, cases(std::move(c))
 			{}
-
-			const char* class_name() const { return "MatchExpression"; }
-			void dump(int i = 0) const {
-				Expression::dump(i);
-				subject->dump(i + 1);
-				for (auto& c : cases) {
-					for (auto& ce : c.first) {
-						if (ce)
-							ce->dump(i + 1);
-						else
-							priv::print(i + 1, "default\n");
-					}
-					c.second->dump(i + 1);
-				}
-			}
 		};
 
 		struct MemberExpression final : public Expression
 		{
+			static constexpr Kind node_kind = Kind::MemberExpression;
+
 			enum class Operators {
 				Member,
 				Namespace,
@@ -242,78 +257,59 @@ namespace Bax
 			Ptr<Expression> lhs, rhs;
 
 			MemberExpression(Operators o, Ptr<Expression> l, Ptr<Expression> r)
-			: op(o)
+			: Expression(node_kind)
+			, op(o)
 			, lhs(std::move(l))
 			, rhs(std::move(r))
 			{}
-
-			const char* class_name() const { return "MemberExpression"; }
-			void dump(int i = 0) const {
-				priv::print(i, "{}({})\n", class_name(), (int)op);
-				lhs->dump(i + 1);
-				rhs->dump(i + 1);
-			}
 		};
 
 		struct ObjectExpression final : public Expression
 		{
-			std::map<Ptr<Identifier>, Ptr<Expression>> members;
+			static constexpr Kind node_kind = Kind::ObjectExpression;
 
-			ObjectExpression(std::map<Ptr<Identifier>, Ptr<Expression>> mems)
-			: members(std::move(mems))
-			{}
+			// In source order, keys are distinct symbols
+			using MembersType = std::vector<std::pair<Ptr<Identifier>, Ptr<Expression>>>;
 
-			const char* class_name() const { return "ObjectExpression"; }
-			void dump(int i = 0) const {
-				Node::dump(i);
-				for (auto &mem : members) {
-					mem.first->dump(i + 1);
-					mem.second->dump(i + 2);
-				}
-			}
+			MembersType members;
+
+			ObjectExpression(MembersType mems)
+			: Expression(node_kind)
+			, members(std::move(mems))
+			{}
 		};
 
 		struct SubscriptExpression final : public Expression
 		{
+			static constexpr Kind node_kind = Kind::SubscriptExpression;
+
 			Ptr<Expression> lhs, rhs;
 
 			SubscriptExpression(Ptr<Expression> l, Ptr<Expression> r = nullptr)
-			: lhs(l)
+			: Expression(node_kind)
+			, lhs(l)
 			, rhs(r)
 			{}
-
-			const char* class_name() const { return "SubscriptExpression"; }
-			void dump(int i = 0) const {
-				priv::print(i, "{}\n", class_name());
-				lhs->dump(i + 1);
-				if (rhs)
-					rhs->dump(i + 1);
-				else
-					priv::print(i + 1, "(empty subscript)\n");
-			}
 		};
 
 		struct TernaryExpression final : public Expression
 		{
+			static constexpr Kind node_kind = Kind::TernaryExpression;
+
 			Ptr<Expression> condition, consequent, alternate;
 
 			TernaryExpression(Ptr<Expression> cond, Ptr<Expression> cons, Ptr<Expression> alt)
-			: condition(std::move(cond))
+			: Expression(node_kind)
+			, condition(std::move(cond))
 			, consequent(std::move(cons))
 			, alternate(std::move(alt))
 			{}
-
-			const char* class_name() const { return "TernaryExpression"; }
-			void dump(int i = 0) const {
-				Node::dump(i);
-				condition->dump(i + 1);
-				consequent->dump(i + 1);
-				alternate->dump(i + 1);
-			}
 		};
 
 		struct UnaryExpression final : public Expression
 		{
+			static constexpr Kind node_kind = Kind::UnaryExpression;
+
 			enum class Operators {
 				BitwiseNot,
 				BooleanNot,
@@ -324,19 +320,16 @@ namespace Bax
 			Ptr<Expression> rhs;
 
 			UnaryExpression(Operators o, Ptr<Expression> r)
-			: op(o)
+			: Expression(node_kind)
+			, op(o)
 			, rhs(std::move(r))
 			{}
-
-			const char* class_name() const { return "UnaryExpression"; }
-			void dump(int i = 0) const {
-				priv::print(i, "{}({})\n", class_name(), (int)op);
-				rhs->dump(i + 1);
-			}
 		};
 
 		struct UpdateExpression final : public Expression
 		{
+			static constexpr Kind node_kind = Kind::UpdateExpression;
+
 			enum class Operators {
 				Increment,
 				Decrement,
@@ -346,210 +339,249 @@ namespace Bax
 			bool is_prefix_update;
 
 			UpdateExpression(Operators o, Ptr<Expression> r, bool pre)
-			: op(o)
+			: Expression(node_kind)
+			, op(o)
 			, expr(std::move(r))
 			, is_prefix_update(pre)
 			{}
-
-			const char* class_name() const { return "UpdateExpression"; }
-			void dump(int i = 0) const {
-				priv::print(i, "{}{}({})\n", is_prefix_update ? "Pre" : "Post", class_name(), (int)op);
-				expr->dump(i + 1);
-			}
 		};
 
 		/// 1. A. Literals -----------------------------------------------------
 
 		struct Literal : public Expression
 		{
-			virtual const char* class_name() const { return "Literal"; }
+		protected:
+			using Expression::Expression;
 		};
 
 		struct Null final : public Literal
 		{
-			const char* class_name() const { return "Null"; }
+			static constexpr Kind node_kind = Kind::Null;
+
+			Null()
+			: Literal(node_kind)
+			{}
+
 		};
 
 		struct Boolean final : public Literal
 		{
+			static constexpr Kind node_kind = Kind::Boolean;
+
 			bool value;
 
 			Boolean(bool v)
-			: value(v)
+			: Literal(node_kind)
+			, value(v)
 			{}
-
-			const char* class_name() const { return "Boolean"; }
-			void dump(int i = 0) const {
-				priv::print(i, "{}({})\n", class_name(), value);
-			}
 		};
 
 		struct Glyph final : public Literal
 		{
+			static constexpr Kind node_kind = Kind::Glyph;
+
 			uint32_t value;
 
 			Glyph(uint32_t v)
-			: value(v)
+			: Literal(node_kind)
+			, value(v)
 			{}
-
-			const char* class_name() const { return "Glyph"; }
-			void dump(int i = 0) const {
-				priv::print(i, "{}({:c}|{:d})\n", class_name(), value, value);
-			}
 		};
 
 		struct Number final : public Literal
 		{
+			static constexpr Kind node_kind = Kind::Number;
+
 			double value;
 
 			Number(double v)
-			: value(v)
+			: Literal(node_kind)
+			, value(v)
 			{}
-
-			const char* class_name() const { return "Number"; }
-			void dump(int i = 0) const {
-				priv::print(i, "{}({:g})\n", class_name(), value);
-			}
 		};
 
 		struct String final : public Literal
 		{
-			std::string value;
+			static constexpr Kind node_kind = Kind::String;
 
-			String(std::string v)
-			: value(std::move(v))
-			{}
+			// Refers to the source, or to the compilation's string pool
+			std::string_view value;
 
-			const char* class_name() const { return "String"; }
-			void dump(int i = 0) const {
-				priv::print(i, "{}({:s})\n", class_name(), value);
-			}
+			String(std::string_view v)
+			: Literal(node_kind)
+			, value(v)
+			{}
 		};
 
 		/// 2. Statements ------------------------------------------------------
 
 		struct Statement : public Node
 		{
-			virtual const char* class_name() const { return "Statement"; }
+		protected:
+			using Node::Node;
 		};
 
 		struct BlockStatement final : public Statement
 		{
+			static constexpr Kind node_kind = Kind::BlockStatement;
+
 			std::vector<Ptr<Statement>> statements;
 
 			BlockStatement(std::vector<Ptr<Statement>> s)
-			: statements(std::move(s))
+			: Statement(node_kind)
+			, statements(std::move(s))
 			{}
-
-			const char* class_name() const { return "BlockStatement"; }
-			void dump(int i = 0) const {
-				Node::dump(i);
-				for (auto &stmt : statements)
-					stmt->dump(i + 1);
-			}
 		};
 
 		struct ExpressionStatement final : public Statement
 		{
+			static constexpr Kind node_kind = Kind::ExpressionStatement;
+
 			Ptr<Expression> expression;
 
 			ExpressionStatement(Ptr<Expression> expr)
-			: expression(std::move(expr))
+			: Statement(node_kind)
+			, expression(std::move(expr))
 			{}
-
-			const char* class_name() const { return "ExpressionStatement"; }
-			void dump(int i = 0) const {
-				Node::dump(i);
-				expression->dump(i + 1);
-			}
 		};
 
 		struct IfStatement final : public Statement
 		{
+			static constexpr Kind node_kind = Kind::IfStatement;
+
 			Ptr<Expression> condition;
 			Ptr<Statement> consequent, alternate;
 
 			IfStatement(Ptr<Expression> cond, Ptr<Statement> cons, Ptr<Statement> alt = nullptr)
-			: condition(std::move(cond))
+			: Statement(node_kind)
+			, condition(std::move(cond))
 			, consequent(std::move(cons))
 			, alternate(std::move(alt))
 			{}
-
-			const char* class_name() const { return "IfStatement"; }
-			void dump(int i = 0) const {
-				Node::dump(i);
-				condition->dump(i + 1);
-				consequent->dump(i + 1);
-				if (alternate)
-					alternate->dump(i + 1);
-			}
 		};
 
 		struct ReturnStatement final : public Statement
 		{
+			static constexpr Kind node_kind = Kind::ReturnStatement;
+
 			Ptr<Expression> value;
 
 			ReturnStatement(Ptr<Expression> val)
-			: value(std::move(val))
+			: Statement(node_kind)
+			, value(std::move(val))
 			{}
-
-			const char* class_name() const { return "ReturnStatement"; }
-			void dump(int i = 0) const {
-				Node::dump(i);
-				value->dump(i + 1);
-			}
 		};
 
 		struct WhileStatement final : public Statement
 		{
+			static constexpr Kind node_kind = Kind::WhileStatement;
+
 			Ptr<Expression> condition;
 			Ptr<Statement> body;
 
 			WhileStatement(Ptr<Expression> cond, Ptr<Statement> bd)
-			: condition(std::move(cond))
+			: Statement(node_kind)
+			, condition(std::move(cond))
 			, body(std::move(bd))
 			{}
-
-			const char* class_name() const { return "WhileStatement"; }
-			void dump(int i = 0) const {
-				Node::dump(i);
-				condition->dump(i + 1);
-				body->dump(i + 1);
-			}
 		};
 
 		/// 2. A. Declarations -------------------------------------------------
 
 		struct Declaration : public Statement
 		{
-			virtual const char* class_name() const { return "Declaration"; }
+		protected:
+			using Statement::Statement;
 		};
 
-		struct VariableDeclaration : public Declaration
+		struct VariableDeclaration final : public Declaration
 		{
+			static constexpr Kind node_kind = Kind::VariableDeclaration;
+
 			Ptr<Identifier> name;
 			Ptr<Expression> value;
 			bool is_constant;
 			bool is_static;
 
 			VariableDeclaration(Ptr<Identifier> n, Ptr<Expression> v, bool c, bool s)
-			: name(std::move(n))
+			: Declaration(node_kind)
+			, name(std::move(n))
 			, value(std::move(v))
 			, is_constant(c)
 			, is_static(s)
 			{}
+		};
 
-			const char* class_name() const { return "VariableDeclaration"; }
-			void dump(int i = 0) const {
-				priv::print(i, "{}({}, {})\n",
-					class_name(),
-					is_constant ? "const" : "let",
-					is_static ? "static" : "scoped"
-				);
-				name->dump(i + 1);
-				value->dump(i + 1);
+		/// 3. Dispatch --------------------------------------------------------
+
+		template <typename T>
+		bool is(Ptr<const Node> node) {
+			return node && node->kind == T::node_kind;
+		}
+
+		// `node` as a `T`, or null if it is another kind of node
+		template <typename T, typename N>
+		auto as(N* node) -> std::conditional_t<std::is_const_v<N>, const T*, T*> {
+			return is<T>(node) ? static_cast<std::conditional_t<std::is_const_v<N>, const T*, T*>>(node) : nullptr;
+		}
+
+		// Calls `visitor` with `node` cast to its concrete type. The dispatch is
+		// a single switch on the kind, `visitor` is usually a generic lambda or
+		// a set of overloads.
+		template <typename N, typename Visitor>
+		decltype(auto) visit(N& node, Visitor&& visitor) {
+			switch (node.kind) {
+#define __ENUMERATE(T) \
+				case Kind::T: return visitor(static_cast<std::conditional_t<std::is_const_v<N>, const T&, T&>>(node));
+				__ENUMERATE_AST_NODES
+#undef __ENUMERATE
 			}
-		};
+			__builtin_unreachable();
+		}
+
+		// Calls `f` with each child of `node`, in source order. Missing children
+		// are passed as null: default patterns of matches, empty subscripts and
+		// missing else branches. Object members are passed as their key, then
+		// their value.
+		template <typename F>
+		void for_each_child(const Node& node, F&& f) {
+			auto all = [&] (const auto& nodes) {
+				for (auto& child : nodes)
+					f(static_cast<Ptr<const Node>>(child));
+			};
+			visit(node, [&] <typename T> (const T& n) {
+				if constexpr (std::is_same_v<T, ArrayExpression>) all(n.elements);
+				else if constexpr (std::is_same_v<T, AssignmentExpression>) { f(n.lhs); f(n.rhs); }
+				else if constexpr (std::is_same_v<T, BinaryExpression>) { f(n.lhs); f(n.rhs); }
+				else if constexpr (std::is_same_v<T, CallExpression>) { f(n.lhs); all(n.arguments); }
+				else if constexpr (std::is_same_v<T, FunctionExpression>) { all(n.parameters); f(n.body); }
+				else if constexpr (std::is_same_v<T, MatchExpression>) {
+					f(n.subject);
+					for (auto& [patterns, value] : n.cases) {
+						all(patterns);
+						f(value);
+					}
+				}
+				else if constexpr (std::is_same_v<T, MemberExpression>) { f(n.lhs); f(n.rhs); }
+				else if constexpr (std::is_same_v<T, ObjectExpression>) {
+					for (auto& [key, value] : n.members) {
+						f(key);
+						f(value);
+					}
+				}
+				else if constexpr (std::is_same_v<T, SubscriptExpression>) { f(n.lhs); f(n.rhs); }
+				else if constexpr (std::is_same_v<T, TernaryExpression>) { f(n.condition); f(n.consequent); f(n.alternate); }
+				else if constexpr (std::is_same_v<T, UnaryExpression>) f(n.rhs);
+				else if constexpr (std::is_same_v<T, UpdateExpression>) f(n.expr);
+				else if constexpr (std::is_same_v<T, BlockStatement>) all(n.statements);
+				else if constexpr (std::is_same_v<T, ExpressionStatement>) f(n.expression);
+				else if constexpr (std::is_same_v<T, IfStatement>) { f(n.condition); f(n.consequent); f(n.alternate); }
+				else if constexpr (std::is_same_v<T, ReturnStatement>) f(n.value);
+				else if constexpr (std::is_same_v<T, WhileStatement>) { f(n.condition); f(n.body); }
+				else if constexpr (std::is_same_v<T, VariableDeclaration>) { f(n.name); f(n.value); }
+				else static_assert(std::is_base_of_v<Literal, T> || std::is_same_v<T, Identifier>, "Children of a node kind are not enumerated");
+			});
+		}
 	}
 }
 
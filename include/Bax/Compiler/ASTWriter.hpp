@@ -0,0 +1,110 @@
+/*
+** Bax, 2021
+** Benoit Lormeau <blormeau@outlook.com>
+** ASTWriter.hpp
+*/
+
+#pragma once
+
+// -----------------------------------------------------------------------------
+
+#include "Bax/Compiler/AST.hpp"
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <string_view>
+
+// -----------------------------------------------------------------------------
+
+namespace Bax
+{
+
+// Dumps trees into a single growing buffer, which `flush` writes out at once.
+// Trees are walked here, in pre-order and without recursion, so that any tree
+// the parser accepts can be dumped. Back-ends only format each node.
+class ASTWriter
+{
+public:
+	virtual ~ASTWriter() = default;
+
+	// The back-end named `format` (text, json or binary), or null
+	static std::unique_ptr<ASTWriter> make(std::string_view format);
+
+	// Appends `root` and every node under it to the buffer
+	void write(Ptr<const AST::Node> root);
+	// Writes the whole buffer to `file` and empties it
+	bool flush(FILE* file);
+
+	const std::string& buffer() const { return m_buffer; }
+
+protected:
+	std::string m_buffer;
+
+	// Before the children of `node`, which is `depth` levels under the root
+	virtual void open(const AST::Node& node, size_t depth) = 0;
+	// After them
+	virtual void close(const AST::Node&, size_t) {}
+	// In place of an optional child of `parent` that is not there: default
+	// match patterns, empty subscripts and missing else branches
+	virtual void missing(const AST::Node&, size_t) {}
+	// After each tree
+	virtual void end() {}
+};
+
+// -----------------------------------------------------------------------------
+
+// Indented, one node per line, eg. `BinaryExpression(0)`
+class TextASTWriter final : public ASTWriter
+{
+	void open(const AST::Node& node, size_t depth) override;
+	void missing(const AST::Node& parent, size_t depth) override;
+};
+
+// One JSON object per tree and per line, nodes are objects such as
+// `{"kind":"Identifier","name":"a","children":[]}`. Lists of children come
+// flattened, like in the text format: match expressions give the number of
+// patterns of each case in `cases`, and missing children are `null`.
+class JsonASTWriter final : public ASTWriter
+{
+	// Whether the next node or `null` is the first of its list
+	bool m_first = true;
+
+	void open(const AST::Node& node, size_t depth) override;
+	void close(const AST::Node& node, size_t depth) override;
+	void missing(const AST::Node& parent, size_t depth) override;
+	void end() override;
+
+	void write_string(std::string_view);
+};
+
+// Compact encoding, in pre-order. Each node is its kind as a byte, or 0xFF for
+// a missing child, followed by:
+//
+//   Identifier, String                       length, bytes of the name or value
+//   Number                                   8 bytes, little-endian IEEE 754
+//   Glyph                                    code point
+//   Boolean                                  1 byte
+//   Assignment, Binary, Member, Unary        operator byte
+//   UpdateExpression                         operator byte, 1 byte: prefix
+//   VariableDeclaration                      FlatAST::VariableFlags byte
+//   Array, Block, Call, Function, Object     number of elements, statements,
+//                                            arguments, parameters or members
+//   MatchExpression                          number of cases, then of the
+//                                            patterns of each case
+//
+// then by its children, in the order of the text format. Lengths, counts and
+// code points are LEB128 varints.
+class BinaryASTWriter final : public ASTWriter
+{
+	static constexpr uint8_t missing_node = 0xFF;
+
+	void open(const AST::Node& node, size_t depth) override;
+	void missing(const AST::Node& parent, size_t depth) override;
+
+	void write_byte(uint8_t byte) { m_buffer.push_back(static_cast<char>(byte)); }
+	void write_varint(uint64_t value);
+	void write_string(std::string_view);
+};
+
+}
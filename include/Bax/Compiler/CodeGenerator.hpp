@@ -0,0 +1,156 @@
+/*
+** Bax, 2021
+** Benoit Lormeau <blormeau@outlook.com>
+** CodeGenerator.hpp
+*/
+
+#pragma once
+
+// -----------------------------------------------------------------------------
+
+#include "Bax/Compiler/AST.hpp"
+#include "Bax/Compiler/Diagnostic.hpp"
+#include "Bax/VM/Bytecode.hpp"
+#include "fmt/format.h"
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// -----------------------------------------------------------------------------
+
+namespace Bax
+{
+
+// Compiles a tree to register-based bytecode. Local variables and temporaries
+// live in registers, allocated as a stack: each expression is evaluated in the
+// first free register, or directly into the one asked by its parent.
+class CodeGenerator
+{
+public:
+	static constexpr size_t default_max_depth = 1024;
+
+private:
+	using Register = uint8_t;
+	// Lets an expression choose its own register
+	static constexpr int any_register = -1;
+	static constexpr size_t max_registers = 255;
+
+	struct Local {
+		Symbol name;
+		bool is_static;
+		bool is_constant;
+		// Whether a closure refers to it, it must then be closed when it goes
+		// out of scope
+		bool is_captured = false;
+		// Register, or index of a static variable
+		uint32_t index;
+		size_t scope;
+	};
+
+	struct Variable {
+		enum class Kind { Register, Upvalue, Static, Global } kind;
+		uint32_t index;
+		bool is_constant;
+	};
+
+	struct Upvalue {
+		Symbol name;
+		bool is_constant;
+		Function::UpvalueSource source;
+	};
+
+	struct FunctionState {
+		Function* function;
+		FunctionState* enclosing;
+		std::vector<Local> locals {};
+		std::vector<Upvalue> upvalues {};
+		size_t scope = 0;
+		// First free register, and the first one past the local variables
+		size_t top = 0;
+		size_t locals_top = 0;
+		// Deduplicated constants
+		std::unordered_map<uint64_t, uint16_t> numbers {};
+		std::unordered_map<uint32_t, uint16_t> glyphs {};
+		std::unordered_map<std::string_view, uint16_t> strings {};
+	};
+
+	std::unique_ptr<Program> m_program;
+	FunctionState* m_function = nullptr;
+	std::unordered_map<std::string_view, uint16_t> m_globals;
+	std::unordered_map<std::string_view, String*> m_strings;
+	size_t m_depth = 0;
+	size_t m_max_depth = default_max_depth;
+	Diagnostics m_diagnostics;
+
+public:
+	CodeGenerator();
+	~CodeGenerator();
+
+	// Null if any error was found, they are then all in `diagnostics`
+	std::unique_ptr<Program> run(Ptr<const AST::Node> root);
+	const Diagnostics& diagnostics() const { return m_diagnostics; }
+
+	// Deeper code is reported as an error, instead of overflowing the stack
+	void set_max_depth(size_t depth) { m_max_depth = depth; }
+
+private:
+	template <typename S, typename... Args>
+	void error(const S& format, Args&&... args) { report(fmt::vformat(format, fmt::make_args_checked<Args...>(format, args...))); }
+	void report(std::string message);
+	bool check_depth();
+
+	void function(Function& function, const AST::FunctionExpression& node);
+
+	void statement(Ptr<const AST::Statement>);
+	void block(const AST::BlockStatement&);
+	void declaration(const AST::VariableDeclaration&);
+	void if_statement(const AST::IfStatement&);
+	void while_statement(const AST::WhileStatement&);
+
+	// Evaluates `expr` into `target`, or into any register. The result may be
+	// a local variable's register, which must then not be written to.
+	Register expression(Ptr<const AST::Expression> expr, int target = any_register);
+	// Evaluates `expr` for its side effects only
+	void effect(Ptr<const AST::Expression> expr);
+	// Emits the jumps taken when `expr` is `when`, to be patched by the caller
+	std::vector<size_t> jump_if(Ptr<const AST::Expression> expr, bool when);
+
+	Register arithmetic(const AST::BinaryExpression&, int target);
+	Register logical(const AST::BinaryExpression&, int target);
+	Register assignment(const AST::AssignmentExpression&, int target);
+	Register call(const AST::CallExpression&, int target);
+	Register match(const AST::MatchExpression&, int target);
+	Register member(const AST::MemberExpression&, int target);
+	Register update(const AST::UpdateExpression&, int target, bool discarded);
+	Register closure(const AST::FunctionExpression&, std::string_view name, int target);
+	Register literal(Value value, int target);
+
+	Variable resolve(const AST::Identifier&);
+	Variable resolve(FunctionState&, const AST::Identifier&);
+	void read(const Variable&, Register target);
+	void write(const Variable&, Register source);
+	Local* declare(const AST::Identifier&, bool is_static, bool is_constant, uint32_t index);
+	void begin_scope();
+	void end_scope();
+
+	Register allocate();
+	Register destination(int target) { return target == any_register ? allocate() : static_cast<Register>(target); }
+	void free_to(size_t top) { m_function->top = top; }
+
+	size_t emit(Instruction);
+	size_t emit_jump();
+	void patch(size_t jump, size_t target);
+	void patch_here(size_t jump) { patch(jump, m_function->function->code.size()); }
+	void patch_here(const std::vector<size_t>& jumps);
+
+	uint16_t constant(Value);
+	uint16_t number_constant(double);
+	uint16_t string_constant(std::string_view);
+	uint16_t glyph_constant(uint32_t);
+	// A constant that fits in a C operand, for member names
+	uint8_t name_constant(std::string_view);
+};
+
+}
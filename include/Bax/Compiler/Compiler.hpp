@@ -9,9 +9,20 @@
 // -----------------------------------------------------------------------------
 
 #include "Bax/Compiler/AST.hpp"
+#include "Bax/Compiler/ASTWriter.hpp"
+#include "Bax/Compiler/Diagnostic.hpp"
+#include "Bax/Compiler/Lexer.hpp"
+#include "Bax/VM/Bytecode.hpp"
+#include "Common/Arena.hpp"
+#include "Common/ConcurrentSymbolTable.hpp"
+#include "Common/SourceBuffer.hpp"
+#include "Common/StringPool.hpp"
+#include "Common/SymbolTable.hpp"
 #include <istream>
+#include <memory>
 #include <string>
 #include <string_view>
+#include <vector>
 
 // -----------------------------------------------------------------------------
 
@@ -20,7 +31,45 @@ namespace Bax
 
 class Compiler
 {
-	Ptr<AST::Node> m_ast;
+public:
+	// One of the inputs of `do_files`
+	struct Unit
+	{
+		std::string path;
+		// Kept alive for the whole compilation, tokens and nodes may refer to it
+		SourceBuffer source;
+		// Null if it failed
+		Ptr<AST::Node> ast = nullptr;
+		Diagnostics diagnostics;
+	};
+
+private:
+	// Allocators of each thread of `do_files`
+	struct Worker
+	{
+		StringPool strings;
+		SymbolTable symbols;
+		Arena nodes;
+
+		explicit Worker(ConcurrentSymbolTable& shared)
+		: symbols(shared)
+		{}
+	};
+
+	// Kept alive for the whole compilation, tokens and nodes may refer to it
+	SourceBuffer m_source;
+	StringPool m_strings;
+	ConcurrentSymbolTable m_symbols;
+	Arena m_nodes;
+	Ptr<AST::Node> m_ast = nullptr;
+	std::unique_ptr<Program> m_program;
+	std::vector<Unit> m_units;
+	std::vector<Worker> m_workers;
+	Diagnostics m_diagnostics;
+	ASTWriter* m_ast_writer = nullptr;
+	size_t m_max_depth;
+	size_t m_thread_count = 0;
+	bool m_only_parse = false;
 
 public:
 	Compiler();
@@ -29,9 +78,34 @@ public:
 	bool do_istream(std::istream& input);
 	bool do_file(const std::string& filename);
 	bool do_string(std::string_view source);
+	// Compiles many files concurrently, directories stand for every `.bax`
+	// file under them. Fails if any of them does.
+	bool do_files(const std::vector<std::string>& paths);
+
+	// The tree of the last compilation, null if it failed
+	Ptr<const AST::Node> ast() const { return m_ast; }
+	// The bytecode of the last single input, null if it failed or was only
+	// parsed. Inputs of `do_files` are always only parsed.
+	const Program* program() const { return m_program.get(); }
+	// The inputs of the last `do_files`, in order
+	const std::vector<Unit>& units() const { return m_units; }
+	// Every error found by the last compilation, in input then source order
+	const Diagnostics& diagnostics() const { return m_diagnostics; }
+	// Names of the identifiers of every compilation so far
+	const ConcurrentSymbolTable& symbols() const { return m_symbols; }
+	// Where trees are dumped once parsed, not at all if null (the default)
+	void set_ast_writer(ASTWriter* writer) { m_ast_writer = writer; }
+	// Nesting of expressions and statements beyond which parsing fails
+	void set_max_depth(size_t depth) { m_max_depth = depth; }
+	// Threads of `do_files`, or lexing a single large input, all available
+	// cores if 0
+	void set_thread_count(size_t count) { m_thread_count = count; }
+	// Stops single inputs once parsed too, as when linting
+	void set_only_parse(bool only_parse) { m_only_parse = only_parse; }
 
 private:
-	bool run(std::string_view source);
+	bool run(Lexer lexer);
+	void reset();
 };
 
 }
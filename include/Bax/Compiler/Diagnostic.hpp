@@ -0,0 +1,32 @@
+/*
+** Bax, 2021
+** Benoit Lormeau <blormeau@outlook.com>
+** Diagnostic.hpp
+*/
+
+#pragma once
+
+// -----------------------------------------------------------------------------
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// -----------------------------------------------------------------------------
+
+namespace Bax
+{
+
+// An error found in the source, collected instead of stopping the compilation
+struct Diagnostic
+{
+	// Where the error was found, diagnostics are reported in this order
+	size_t offset = 0;
+	std::string message;
+	// Path of the input, when there are several
+	std::string file {};
+};
+
+using Diagnostics = std::vector<Diagnostic>;
+
+}
@@ -0,0 +1,109 @@
+/*
+** Bax, 2021
+** Benoit Lormeau <blormeau@outlook.com>
+** FlatAST.hpp
+*/
+
+#pragma once
+
+// -----------------------------------------------------------------------------
+
+#include "Bax/Compiler/AST.hpp"
+#include "Common/Arena.hpp"
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include <vector>
+
+// -----------------------------------------------------------------------------
+
+namespace Bax
+{
+
+// A tree as parallel arrays of nodes, whose children are 32-bit indices.
+// Nodes are stored in post-order: children always come before their parent,
+// and the root is the last node. A pass that needs its children done first can
+// then simply iterate over the arrays.
+//
+// Each node has the kind of the tree node it stands for, and two operands,
+// `lhs` and `rhs`, whose meaning depends on that kind. Lists are [begin, end)
+// ranges of `extra`, and nodes with more than two operands keep the others
+// there as well:
+//
+//   Identifier                        lhs: symbol, rhs: index of the name in `strings`
+//   String                            lhs: index in `strings`
+//   Number                            lhs: index in `numbers`
+//   Glyph                             lhs: code point
+//   Boolean                           op: value
+//   ArrayExpression, BlockStatement   lhs, rhs: range of elements or statements
+//   AssignmentExpression              op, lhs, rhs: operands
+//   BinaryExpression                  op, lhs, rhs: operands
+//   MemberExpression                  op, lhs, rhs: operands
+//   CallExpression                    lhs: callee, extra[rhs .. rhs + 2]: range of arguments
+//   FunctionExpression                lhs: body, extra[rhs .. rhs + 2]: range of parameters
+//   MatchExpression                   lhs: subject, extra[rhs .. rhs + 2]: range of cases,
+//                                     each made of 3 entries: range of patterns, value.
+//                                     Default patterns are `none`
+//   ObjectExpression                  lhs, rhs: range of members, each made of 2 entries:
+//                                     key identifier, value
+//   SubscriptExpression               lhs: subscripted, rhs: index or `none`
+//   TernaryExpression                 lhs: condition, extra[rhs .. rhs + 2]: consequent, alternate
+//   UnaryExpression                   op, lhs: operand
+//   UpdateExpression                  op, lhs: operand, rhs: 1 if prefix
+//   ExpressionStatement               lhs: expression
+//   IfStatement                       lhs: condition, extra[rhs .. rhs + 2]: consequent,
+//                                     alternate or `none`
+//   ReturnStatement                   lhs: value
+//   WhileStatement                    lhs: condition, rhs: body
+//   VariableDeclaration               op: VariableFlags, lhs: name identifier, rhs: value
+struct FlatAST
+{
+	using Index = uint32_t;
+	static constexpr Index none = UINT32_MAX;
+
+	using Kind = AST::Kind;
+
+	enum VariableFlags : uint8_t {
+		Constant = 1 << 0,
+		Static = 1 << 1,
+	};
+
+	std::vector<Kind> kinds;
+	// Values of the nodes' `Operators` enums, or flags
+	std::vector<uint8_t> operators;
+	std::vector<Index> lhs;
+	std::vector<Index> rhs;
+	// Lists and extra operands
+	std::vector<Index> extra;
+	// Payloads of literals and identifiers, they refer to the same storage as
+	// the tree they come from
+	std::vector<std::string_view> strings;
+	std::vector<double> numbers;
+
+	size_t size() const { return kinds.size(); }
+	bool empty() const { return kinds.empty(); }
+	Index root() const { return static_cast<Index>(size() - 1); }
+
+	std::span<const Index> list(Index begin, Index end) const { return { extra.data() + begin, extra.data() + end }; }
+	// List at `extra[at .. at + 2]`
+	std::span<const Index> list(Index at) const { return list(extra[at], extra[at + 1]); }
+
+	bool operator==(const FlatAST&) const = default;
+
+	void clear();
+
+	// Flattens `root` and every node under it, which must not be null
+	static FlatAST from_tree(Ptr<const AST::Node> root);
+	// Rebuilds the tree in `nodes`
+	Ptr<AST::Node> to_tree(Arena& nodes) const;
+
+private:
+	Index push(Kind kind, uint8_t op, Index l, Index r);
+	Index push_list(std::span<const Index> items);
+	// Pushes `node`, whose children are already pushed at `children`
+	Index flatten(const AST::Node& node, std::span<const Index> children);
+
+	Ptr<AST::Node> rebuild(Arena& nodes, const std::vector<Ptr<AST::Node>>& built, Index i) const;
+};
+
+}
@@ -9,16 +9,26 @@
 // -----------------------------------------------------------------------------
 
 #include "Bax/Compiler/Token.hpp"
+#include "Bax/Compiler/TokenStream.hpp"
 #include "Common/GenericLexer.hpp"
 #include <algorithm>
-#include <map>
-#include <unordered_map>
+#include <string>
 
 // -----------------------------------------------------------------------------
 
 namespace Bax
 {
 
+// Replacement of `removed` bytes at `offset` by `inserted`
+struct Edit
+{
+	size_t offset = 0;
+	size_t removed = 0;
+	std::string_view inserted;
+};
+
+// -----------------------------------------------------------------------------
+
 class Lexer : public GenericLexer
 {
 private:
@@ -26,55 +36,77 @@ private:
 	static constexpr const char* block_comment_start  = "/*";
 	static constexpr const char* block_comment_end    = "*/";
 
-	static constexpr auto is_identifier_start = [] (char c) { return isalpha(c) || c == '_'; };
-	static constexpr auto is_identifier_body  = [] (char c) { return isalnum(c) || c == '_'; };
-
-	static const std::unordered_map<std::string_view, Token::Type> keywords;
+	// ASCII identifier characters, well-formed UTF-8 sequences are accepted too
+	static constexpr auto is_identifier_start = [] (char c) { return has_char_class(c, CharClass::Alpha | CharClass::Underscore); };
+	static constexpr auto is_identifier_body  = [] (char c) { return has_char_class(c, CharClass::Alnum | CharClass::Underscore); };
 
-	struct OperatorTreeNode {
-		Token::Type type;
-		std::map<char, OperatorTreeNode> children;
-	};
-	static const OperatorTreeNode operator_tree_root;
+	// Start of the last returned token, kept buffered while streaming
+	size_t m_last_token_offset = 0;
+	// Value of the last Number token
+	double m_number = 0;
+	// Threads of `tokenize_all`, all available cores if 0
+	size_t m_thread_count = 0;
 
 public:
+	static constexpr size_t default_chunk_size = 64 * 1024;
+	// Smallest share of the input lexed by each thread in `tokenize_all`
+	static constexpr size_t parallel_chunk_size = 1024 * 1024;
+	// Bytes past its end that a token may depend on (longest match, UTF-8)
+	static constexpr size_t max_lookahead = 4;
+
 	Lexer(const std::string_view& source);
+	// Streaming mode, memory is bounded by the chunk size and the largest token
+	Lexer(std::istream& stream, size_t chunk_size = default_chunk_size);
 	~Lexer();
 
 	Token next();
+	// Value of the last Number token returned by `next`
+	double number() const { return m_number; }
+	// Lexes the whole (non-streamed) input up to, and including, Eof.
+	// Large inputs are lexed concurrently, on `thread_count` threads
+	TokenStream tokenize_all();
+	// Same, with the input split after the first newline following every
+	// `chunk_size` bytes, and chunks lexed on `thread_count` threads.
+	// The result is always identical to the sequential one
+	TokenStream tokenize_all(size_t chunk_size, size_t thread_count);
+	// Updates `tokens`, lexed from the source before `edit`, to this lexer's
+	// input (the source after it). Only the tokens around the edit are lexed
+	// again, the following ones are shifted. Returns the number of new tokens
+	size_t relex(TokenStream& tokens, const Edit& edit);
+
+	// Threads of `tokenize_all`, all available cores if 0. Lexers that already
+	// run on a thread of their own, one per input, should use 1
+	void set_thread_count(size_t count) { m_thread_count = count; }
+
+	// Human-readable token, with its text and position, for diagnostics
+	std::string describe(const Token&) const;
 
 private:
-	template <typename L>
-	Token make_token(Token::Type type, L consumer)
+	// Token spanning from `start` to the current index
+	Token make_token(Token::Type type, size_t start) const
 	{
 		Token t;
+		t.offset = m_base + start;
+		t.length = tell() - start;
 		t.type = type;
-		t.start = position();
-		t.trivia = consumer();
-		t.end = position();
 		return t;
 	}
 
-	template <typename L>
-	Token make_token(L consumer) {
-		Token t;
-		t.start = position();
-
-		std::pair<Token::Type, std::string_view> res = consumer();
-		t.type = res.first;
-		t.trivia = res.second;
-		t.end = position();
-		return t;
-	}
-
-	Token make_token(Token::Type type) {
-		return make_token(type, [this] () { return consume(1); });
+	Token make_token(Token::Type type)
+	{
+		size_t start = tell();
+		ignore(1);
+		return make_token(type, start);
 	}
 
-	std::pair<Token::Type, std::string_view> descend_operator_tree(const OperatorTreeNode& node, size_t level = 0);
-
+	Token lex();
+	// Lexes from the current index, until a token ending at or after `limit`
+	// is lexed, so that the next one would start from `limit` or past it
+	void lex_until(size_t limit, TokenStream& tokens);
 	Token lex_glyph();
+	Token lex_identifier();
 	Token lex_number();
+	Token lex_operator();
 	Token lex_string();
 };
 
@@ -9,9 +9,14 @@
 // -----------------------------------------------------------------------------
 
 #include "Bax/Compiler/AST.hpp"
+#include "Bax/Compiler/Diagnostic.hpp"
 #include "Bax/Compiler/Lexer.hpp"
+#include "Common/Arena.hpp"
+#include "Common/StringPool.hpp"
+#include "Common/SymbolTable.hpp"
+#include "fmt/format.h"
 #include <array>
-#include <functional>
+#include <cstdint>
 #include <string_view>
 #include <vector>
 
@@ -24,6 +29,7 @@ class Parser
 {
 public:
 	enum class Precedence {
+		None,        // Not an operator
 		Lowest,
 		Assigns,     // = += -= *= **= /= |= &= ^= <<= >>= ??=
 		Ternary,     // ?
@@ -49,37 +55,100 @@ public:
 		Right,
 	};
 
+	using PrefixParser = Ptr<AST::Expression> (Parser::*)(const Token&);
+	using InfixParser = Ptr<AST::Expression> (Parser::*)(const Token&, Ptr<AST::Expression>);
+	using OperatorBuilder = Ptr<AST::Expression> (Parser::*)(const Token&, Ptr<AST::Expression>, Ptr<AST::Expression>);
+
 	struct GrammarRule {
-		Precedence precedence;
-		Associativity associativity;
-		std::function<Ptr<AST::Expression>(Parser*, const Token&)> prefix;
-		std::function<Ptr<AST::Expression>(Parser*, const Token&, Ptr<AST::Expression>)> infix;
+		Precedence precedence = Precedence::None;
+		Associativity associativity = Associativity::Left;
+		// Operators of the nodes built by `prefix` and `infix`, as values of
+		// their `Operators` enums
+		PrefixParser prefix = nullptr;
+		uint8_t prefix_operator = 0;
+		InfixParser infix = nullptr;
+		uint8_t infix_operator = 0;
+		// Binary and assignment operators are parsed by `expression` on an
+		// explicit stack, instead of `infix`. This builds their node once both
+		// operands are known.
+		OperatorBuilder build = nullptr;
 	};
 
+	static constexpr size_t default_max_depth = 1024;
+
+	using GrammarRules = std::array<GrammarRule, Token::type_count>;
+
 private:
-	static const std::unordered_map<Token::Type, GrammarRule> grammar_rules;
+	// Indexed by token type
+	static const GrammarRules grammar_rules;
 	static const std::array<Token::Type, 4> declaration_tokens;
 	static const std::array<Token::Type, 6> statement_tokens;
+	// Where statements that failed to parse are skipped to
+	static const std::array<Token::Type, 6> synchronization_tokens;
 
 	Lexer m_lexer;
+	// Unescaped (or streamed) string literals, names and the nodes, owned by
+	// the compilation
+	StringPool& m_strings;
+	SymbolTable& m_symbols;
+	Arena& m_nodes;
+	// Whole inputs are tokenized up front, streamed ones are pulled lazily
+	TokenStream m_tokens;
+	size_t m_cursor = 0;
+	size_t m_number_cursor = 0;
 	Token m_current_token;
+	// Values of the current and last consumed tokens, if they are Numbers
+	double m_current_number = 0;
+	double m_consumed_number = 0;
+
+	// Operators whose right operand is being parsed, with their left one.
+	// Shared by the nested calls of `expression`, each one owns its top part.
+	struct PendingOperator {
+		Token token;
+		const GrammarRule* rule;
+		Ptr<AST::Expression> lhs;
+	};
+	std::vector<PendingOperator> m_pending_operators;
+	// Nesting of expressions and statements, bounded to keep the stack safe
+	size_t m_depth = 0;
+	size_t m_max_depth = default_max_depth;
+	// Braces consumed and not closed yet
+	size_t m_open_braces = 0;
+	Diagnostics m_diagnostics;
 
 public:
-	Parser(Lexer lexer);
+	Parser(Lexer lexer, StringPool& strings, SymbolTable& symbols, Arena& nodes);
 	~Parser();
 
+	// Null if any error was found. Statements that fail to parse are skipped,
+	// so that every error of the input is in `diagnostics`
 	Ptr<AST::Node> run();
+	const Diagnostics& diagnostics() const { return m_diagnostics; }
+
+	// Deeper code is reported as an error, instead of overflowing the stack
+	void set_max_depth(size_t depth) { m_max_depth = depth; }
 
 private:
+	Token next_token();
+
 	const Token& peek() const;
 	bool peek(Token::Type) const;
 	Token consume();
 	bool consume(Token::Type);
 	bool must_consume(Token::Type);
 
+	template <typename S, typename... Args>
+	void error(const S& format, Args&&... args) { report(fmt::vformat(format, fmt::make_args_checked<Args...>(format, args...))); }
+	void report(std::string message);
+	// Skips the rest of the statement that failed from `start`, the offset of
+	// its first token, when `open_braces` braces were open
+	void synchronize(size_t start, size_t open_braces);
+
 	Ptr<AST::Declaration> declaration();
 	Ptr<AST::Statement> statement();
 	Ptr<AST::Expression> expression(Precedence = Precedence::Lowest);
+	Ptr<AST::Expression> operand();
+	bool check_depth();
 
 	Ptr<AST::Null> null(const Token&);
 	Ptr<AST::Boolean> boolean(const Token&);
@@ -88,8 +157,8 @@ private:
 	Ptr<AST::String> string(const Token&);
 
 	Ptr<AST::ArrayExpression> array(const Token&);
-	Ptr<AST::AssignmentExpression> assignment(const Token&, Ptr<AST::Expression>);
-	Ptr<AST::BinaryExpression> binary(const Token&, Ptr<AST::Expression>);
+	Ptr<AST::Expression> assignment(const Token&, Ptr<AST::Expression>, Ptr<AST::Expression>);
+	Ptr<AST::Expression> binary(const Token&, Ptr<AST::Expression>, Ptr<AST::Expression>);
 	Ptr<AST::CallExpression> call(const Token&, Ptr<AST::Expression>);
 	Ptr<AST::FunctionExpression> function(const Token&);
 	Ptr<AST::Expression> group(const Token&);
@@ -110,7 +179,14 @@ private:
 
 	Ptr<AST::VariableDeclaration> variable_declaration(const Token&);
 
-	uint32_t parse_escape_sequence(std::string_view::const_iterator&);
+	static constexpr GrammarRules make_grammar_rules();
+	static const GrammarRule& grammar_rule(Token::Type type) { return grammar_rules[static_cast<size_t>(type)]; }
+
+	// Adapt the parsing functions of each node to the types of the grammar rules
+	template <auto Parse> Ptr<AST::Expression> prefix(const Token&);
+	template <auto Parse> Ptr<AST::Expression> infix(const Token&, Ptr<AST::Expression>);
+
+	uint32_t parse_escape_sequence(std::string_view::const_iterator&, std::string_view::const_iterator end);
 	bool parse_argument_list(std::vector<Ptr<AST::Expression>>&, Token::Type stop);
 	bool parse_parameter_list(std::vector<Ptr<AST::Expression>>&, Token::Type stop);
 };
@@ -12,6 +12,8 @@
 #include "Bax/VM/Value.hpp"
 #include "Common/GenericLexer.hpp"
 #include "fmt/format.h"
+#include <cstddef>
+#include <cstdint>
 #include <ostream>
 
 // -----------------------------------------------------------------------------
@@ -21,18 +23,30 @@ namespace Bax
 
 struct Token : public GenericToken
 {
-	enum class Type {
+	enum class Type : uint8_t {
 #define __ENUMERATE(T) T,
 		__ENUMERATE_TOKEN_TYPES
 #undef __ENUMERATE
 	};
 
+	enum Flags : uint8_t {
+		Verbatim = 1 << 0, // String literal without escape sequences
+	};
+
+	// Number of token types, to index tables by type
+#define __ENUMERATE(T) + 1
+	static constexpr size_t type_count = 0 __ENUMERATE_TOKEN_TYPES;
+#undef __ENUMERATE
+
 	Type type { Type::Unknown };
+	uint8_t flags = 0;
 
 	static const char* type_to_string(Token::Type);
 	const char* type_to_string() const { return type_to_string(type); }
 };
 
+static_assert(sizeof(Token) <= 12, "Tokens should stay compact");
+
 }
 
 template <>
@@ -42,6 +56,6 @@ struct fmt::formatter<Bax::Token> {
 	}
 	template <typename FormatContext>
 	auto format(const Bax::Token& t, FormatContext& ctx) {
-		return format_to(ctx.out(), "{}(\"{}\")[{}->{}]", t.type_to_string(), t.trivia, t.start, t.end);
+		return format_to(ctx.out(), "{}[{}+{}]", t.type_to_string(), t.offset, t.length);
 	}
 };
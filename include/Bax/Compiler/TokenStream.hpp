@@ -0,0 +1,131 @@
+/*
+** Bax, 2021
+** Benoit Lormeau <blormeau@outlook.com>
+** TokenStream.hpp
+*/
+
+#pragma once
+
+// -----------------------------------------------------------------------------
+
+#include "Bax/Compiler/Token.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+// -----------------------------------------------------------------------------
+
+namespace Bax
+{
+
+// Tokens of a whole input, as parallel arrays. Always ends with an Eof token.
+struct TokenStream
+{
+	std::vector<Token::Type> types;
+	std::vector<uint32_t> offsets;
+	std::vector<uint32_t> lengths;
+	std::vector<uint8_t> flags;
+	// Values of the Number tokens only, in order
+	std::vector<double> numbers;
+
+	size_t size() const { return types.size(); }
+	bool empty() const { return types.empty(); }
+
+	Token operator[](size_t i) const
+	{
+		Token t;
+		t.offset = offsets[i];
+		t.length = lengths[i];
+		t.type = types[i];
+		t.flags = flags[i];
+		return t;
+	}
+
+	void reserve(size_t count)
+	{
+		types.reserve(count);
+		offsets.reserve(count);
+		lengths.reserve(count);
+		flags.reserve(count);
+	}
+
+	// `number` is only kept for Number tokens
+	void push_back(const Token& t, double number)
+	{
+		types.push_back(t.type);
+		offsets.push_back(t.offset);
+		lengths.push_back(t.length);
+		flags.push_back(t.flags);
+		if (t.type == Token::Type::Number)
+			numbers.push_back(number);
+	}
+
+	// Number of tokens of the given type in [`from`, `to`)
+	size_t count(Token::Type type, size_t from, size_t to) const
+	{
+		return std::count(types.begin() + from, types.begin() + to, type);
+	}
+
+	// Appends tokens [`from`, `other.size()`) of `other`
+	void append(const TokenStream& other, size_t from)
+	{
+		size_t number_from = other.count(Token::Type::Number, 0, from);
+		types.insert(types.end(), other.types.begin() + from, other.types.end());
+		offsets.insert(offsets.end(), other.offsets.begin() + from, other.offsets.end());
+		lengths.insert(lengths.end(), other.lengths.begin() + from, other.lengths.end());
+		flags.insert(flags.end(), other.flags.begin() + from, other.flags.end());
+		numbers.insert(numbers.end(), other.numbers.begin() + number_from, other.numbers.end());
+	}
+
+	// Moves tokens [`from`, `size()`) by `delta` bytes (wrapping, to go back)
+	void shift(size_t from, uint32_t delta)
+	{
+		uint32_t* data = offsets.data();
+		size_t i = from;
+		// Fixed-size blocks are vectorized even without -O3
+		for (; i + 8 <= offsets.size(); i += 8)
+			for (size_t j = 0; j < 8; ++j)
+				data[i + j] += delta;
+		for (; i < offsets.size(); ++i)
+			data[i] += delta;
+	}
+
+	// Replaces tokens [`from`, `to`) by those of `other`
+	void replace(size_t from, size_t to, const TokenStream& other)
+	{
+		auto splice = [] (auto& target, size_t from, size_t to, const auto& source) {
+			size_t common = std::min(to - from, source.size());
+			std::copy_n(source.begin(), common, target.begin() + from);
+			if (common < source.size())
+				target.insert(target.begin() + from + common, source.begin() + common, source.end());
+			else
+				target.erase(target.begin() + from + common, target.begin() + to);
+		};
+
+		// Number values are only located when some are replaced
+		size_t replaced_numbers = count(Token::Type::Number, from, to);
+		if (replaced_numbers > 0 || !other.numbers.empty()) {
+			// Counting from the closest end of the stream
+			size_t number_from = from < size() - to
+				? count(Token::Type::Number, 0, from)
+				: numbers.size() - replaced_numbers - count(Token::Type::Number, to, size());
+			splice(numbers, number_from, number_from + replaced_numbers, other.numbers);
+		}
+
+		splice(types, from, to, other.types);
+		splice(offsets, from, to, other.offsets);
+		splice(lengths, from, to, other.lengths);
+		splice(flags, from, to, other.flags);
+	}
+
+	void clear()
+	{
+		types.clear();
+		offsets.clear();
+		lengths.clear();
+		flags.clear();
+		numbers.clear();
+	}
+};
+
+}
@@ -0,0 +1,155 @@
+/*
+** Bax, 2021
+** Benoit Lormeau <blormeau@outlook.com>
+** Bytecode.hpp
+*/
+
+#pragma once
+
+// -----------------------------------------------------------------------------
+
+#include "Bax/VM/Object.hpp"
+#include "Bax/VM/Value.hpp"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// -----------------------------------------------------------------------------
+
+// Instructions are 32 bits: an 8-bit opcode, then either three 8-bit operands
+// A, B and C, or A and a 16-bit Bx, or a signed 24-bit jump offset sJ.
+// R[x] is a register of the running function, K[x] one of its constants, U[x]
+// one of its upvalues, G[x] a global and S[x] a static variable.
+//
+// Tests are always followed by a Jump, which they take if their condition is
+// equal to the flag A, and skip otherwise. The VM runs both at once.
+#define __ENUMERATE_OPCODES                                                   \
+	__ENUMERATE(Move)          /* A B    R[A] = R[B]                      */ \
+	__ENUMERATE(LoadNull)      /* A      R[A] = null                      */ \
+	__ENUMERATE(LoadBool)      /* A B    R[A] = B != 0                    */ \
+	__ENUMERATE(LoadInt)       /* A sBx  R[A] = sBx                       */ \
+	__ENUMERATE(LoadConstant)  /* A Bx   R[A] = K[Bx]                     */ \
+	__ENUMERATE(GetUpvalue)    /* A B    R[A] = U[B]                      */ \
+	__ENUMERATE(SetUpvalue)    /* A B    U[B] = R[A]                      */ \
+	__ENUMERATE(GetGlobal)     /* A Bx   R[A] = G[Bx]                     */ \
+	__ENUMERATE(GetStatic)     /* A Bx   R[A] = S[Bx]                     */ \
+	__ENUMERATE(SetStatic)     /* A Bx   S[Bx] = R[A]                     */ \
+	__ENUMERATE(IfStatic)      /* Bx     Jump if S[Bx] is initialized     */ \
+	__ENUMERATE(NewArray)      /* A Bx   R[A] = [], room for Bx elements  */ \
+	__ENUMERATE(NewTable)      /* A Bx   R[A] = {}, room for Bx fields    */ \
+	__ENUMERATE(Push)          /* A B    R[A][] = R[B]                    */ \
+	__ENUMERATE(GetField)      /* A B C  R[A] = R[B].K[C]                 */ \
+	__ENUMERATE(SetField)      /* A B C  R[A].K[B] = R[C]                 */ \
+	__ENUMERATE(GetIndex)      /* A B C  R[A] = R[B][R[C]]                */ \
+	__ENUMERATE(SetIndex)      /* A B C  R[A][R[B]] = R[C]                */ \
+	__ENUMERATE(Method)        /* A B C  R[A + 1] = R[B], R[A] = its K[C] */ \
+	__ENUMERATE(Add)           /* A B C  R[A] = R[B] + R[C]               */ \
+	__ENUMERATE(AddInt)        /* A B sC R[A] = R[B] + sC                 */ \
+	__ENUMERATE(Substract)     /* A B C  R[A] = R[B] - R[C]               */ \
+	__ENUMERATE(SubstractInt)  /* A B sC R[A] = R[B] - sC                 */ \
+	__ENUMERATE(Multiply)      /* A B C  R[A] = R[B] * R[C]               */ \
+	__ENUMERATE(Divide)        /* A B C  R[A] = R[B] / R[C]               */ \
+	__ENUMERATE(Modulo)        /* A B C  R[A] = R[B] % R[C]               */ \
+	__ENUMERATE(Power)         /* A B C  R[A] = R[B] ** R[C]              */ \
+	__ENUMERATE(BitwiseAnd)    /* A B C  R[A] = R[B] & R[C]               */ \
+	__ENUMERATE(BitwiseOr)     /* A B C  R[A] = R[B] | R[C]               */ \
+	__ENUMERATE(BitwiseXor)    /* A B C  R[A] = R[B] ^ R[C]               */ \
+	__ENUMERATE(LeftShift)     /* A B C  R[A] = R[B] << R[C]              */ \
+	__ENUMERATE(RightShift)    /* A B C  R[A] = R[B] >> R[C]              */ \
+	__ENUMERATE(Negate)        /* A B    R[A] = -R[B]                     */ \
+	__ENUMERATE(Positive)      /* A B    R[A] = +R[B], a number           */ \
+	__ENUMERATE(BitwiseNot)    /* A B    R[A] = ~R[B]                     */ \
+	__ENUMERATE(Not)           /* A B    R[A] = !R[B]                     */ \
+	__ENUMERATE(Equal)         /* A B C  R[A] = R[B] == R[C]              */ \
+	__ENUMERATE(NotEqual)      /* A B C  R[A] = R[B] != R[C]              */ \
+	__ENUMERATE(Less)          /* A B C  R[A] = R[B] < R[C]               */ \
+	__ENUMERATE(LessEqual)     /* A B C  R[A] = R[B] <= R[C]              */ \
+	__ENUMERATE(Test)          /* A B    Jump if truthy(R[B]) == A        */ \
+	__ENUMERATE(TestNull)      /* A B    Jump if (R[B] == null) == A      */ \
+	__ENUMERATE(TestEqual)     /* A B C  Jump if (R[B] == R[C]) == A      */ \
+	__ENUMERATE(TestLess)      /* A B C  Jump if (R[B] < R[C]) == A       */ \
+	__ENUMERATE(TestLessEqual) /* A B C  Jump if (R[B] <= R[C]) == A      */ \
+	__ENUMERATE(Jump)          /* sJ     Skip sJ instructions             */ \
+	__ENUMERATE(Closure)       /* A Bx   R[A] = closure of function Bx    */ \
+	__ENUMERATE(Close)         /* A      Close upvalues of R[A] and above */ \
+	__ENUMERATE(Call)          /* A B    R[A] = R[A](R[A + 1 .. A + B])   */ \
+	__ENUMERATE(Return)        /* A      Return R[A]                      */ \
+	__ENUMERATE(ReturnNull)    /*        Return null                      */
+
+// -----------------------------------------------------------------------------
+
+namespace Bax
+{
+
+enum class Opcode : uint8_t
+{
+#define __ENUMERATE(T) T,
+	__ENUMERATE_OPCODES
+#undef __ENUMERATE
+};
+
+#define __ENUMERATE(T) + 1
+static constexpr size_t opcode_count = 0 __ENUMERATE_OPCODES;
+#undef __ENUMERATE
+
+const char* opcode_name(Opcode);
+
+struct Instruction
+{
+	uint32_t bits;
+
+	static constexpr Instruction abc(Opcode op, uint8_t a, uint8_t b = 0, uint8_t c = 0) {
+		return { static_cast<uint32_t>(op) | a << 8 | b << 16 | static_cast<uint32_t>(c) << 24 };
+	}
+	static constexpr Instruction abx(Opcode op, uint8_t a, uint16_t bx) {
+		return { static_cast<uint32_t>(op) | a << 8 | static_cast<uint32_t>(bx) << 16 };
+	}
+	static constexpr Instruction sj(Opcode op, int32_t offset) {
+		return { static_cast<uint32_t>(op) | static_cast<uint32_t>(offset) << 8 };
+	}
+
+	Opcode op() const { return static_cast<Opcode>(bits & 0xFF); }
+	uint8_t a() const { return bits >> 8; }
+	uint8_t b() const { return bits >> 16; }
+	uint8_t c() const { return bits >> 24; }
+	int8_t sc() const { return static_cast<int8_t>(bits >> 24); }
+	uint16_t bx() const { return bits >> 16; }
+	int16_t sbx() const { return static_cast<int16_t>(bits >> 16); }
+	int32_t sj() const { return static_cast<int32_t>(bits) >> 8; }
+};
+
+static constexpr int32_t max_jump = (1 << 23) - 1;
+
+// The code of a function, shared by its closures
+struct Function
+{
+	// Where a closure finds each of its upvalues, when it is created
+	struct UpvalueSource {
+		// A register of the enclosing function, or one of its upvalues
+		bool is_register;
+		uint8_t index;
+	};
+
+	std::string name;
+	std::vector<Instruction> code;
+	std::vector<Value> constants;
+	// Functions defined in this one, by `Closure`
+	std::vector<std::unique_ptr<Function>> functions;
+	std::vector<UpvalueSource> upvalues;
+	uint8_t parameter_count = 0;
+	uint8_t register_count = 0;
+};
+
+// Output of the compiler, input of the VM
+struct Program
+{
+	std::unique_ptr<Function> main;
+	// Strings of the constants
+	std::vector<std::unique_ptr<String>> strings;
+	// Names of the globals, bound by the VM before running
+	std::vector<std::string> globals;
+	size_t static_count = 0;
+};
+
+}
@@ -0,0 +1,156 @@
+/*
+** Bax, 2021
+** Benoit Lormeau <blormeau@outlook.com>
+** Object.hpp
+*/
+
+#pragma once
+
+// -----------------------------------------------------------------------------
+
+#include "Bax/VM/Value.hpp"
+#include "Common/SymbolTable.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// -----------------------------------------------------------------------------
+
+namespace Bax
+{
+
+class VM;
+struct Function;
+
+// Values that live on the heap, of the VM or of a compiled program
+struct Object
+{
+	enum class Type : uint8_t {
+		Array,
+		Closure,
+		Native,
+		String,
+		Table,
+		Upvalue,
+	};
+
+	const Type type;
+
+	virtual ~Object() = default;
+
+protected:
+	Object(Type t)
+	: type(t)
+	{}
+};
+
+// `value` as a `T`, or null if it is not one
+template <typename T>
+T* as(Value value)
+{
+	if (!value.is_object() || value.to_object()->type != T::object_type)
+		return nullptr;
+	return static_cast<T*>(value.to_object());
+}
+
+// Immutable, hashed once
+struct String final : public Object
+{
+	static constexpr Type object_type = Type::String;
+
+	const std::string value;
+	const uint32_t hash;
+
+	String(std::string v)
+	: Object(object_type)
+	, value(std::move(v))
+	, hash(SymbolTable::hash(value))
+	{}
+
+	// Strings as keys, compared by content
+	struct Hash { size_t operator()(const String* s) const { return s->hash; } };
+	struct Equals { bool operator()(const String* l, const String* r) const { return l->hash == r->hash && l->value == r->value; } };
+};
+
+struct Array final : public Object
+{
+	static constexpr Type object_type = Type::Array;
+
+	std::vector<Value> elements;
+
+	Array()
+	: Object(object_type)
+	{}
+};
+
+// Objects of the language, `{ key: value }`, keyed by strings
+struct Table final : public Object
+{
+	static constexpr Type object_type = Type::Table;
+
+	std::unordered_map<const String*, Value, String::Hash, String::Equals> fields;
+
+	Table()
+	: Object(object_type)
+	{}
+
+	// Null if there is no such field
+	const Value* get(const String* key) const
+	{
+		auto it = fields.find(key);
+		return it == fields.end() ? nullptr : &it->second;
+	}
+};
+
+// A variable of an enclosing function, captured by a closure. Points into the
+// registers while the function runs, then holds the variable itself.
+struct Upvalue final : public Object
+{
+	static constexpr Type object_type = Type::Upvalue;
+
+	Value* location;
+	Value closed;
+	// Next open upvalue, lower in the stack
+	Upvalue* next = nullptr;
+
+	Upvalue(Value* slot)
+	: Object(object_type)
+	, location(slot)
+	{}
+};
+
+struct Closure final : public Object
+{
+	static constexpr Type object_type = Type::Closure;
+
+	const Function* function;
+	std::vector<Upvalue*> upvalues;
+
+	Closure(const Function* f)
+	: Object(object_type)
+	, function(f)
+	{}
+};
+
+// Built-in functions and methods, methods get their object as first argument.
+// Errors are reported with `VM::error`, which returns false.
+using NativeFunction = bool (*)(VM& vm, Value* arguments, size_t count, Value& result);
+
+struct Native final : public Object
+{
+	static constexpr Type object_type = Type::Native;
+
+	const std::string name;
+	const NativeFunction function;
+
+	Native(std::string n, NativeFunction f)
+	: Object(object_type)
+	, name(std::move(n))
+	, function(f)
+	{}
+};
+
+}
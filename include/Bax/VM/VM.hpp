@@ -8,8 +8,16 @@
 
 // -----------------------------------------------------------------------------
 
-#include <unordered_map>
+#include "Bax/VM/Bytecode.hpp"
+#include "Bax/VM/Object.hpp"
+#include "Bax/VM/Value.hpp"
+#include "fmt/format.h"
+#include <array>
+#include <cstdio>
+#include <memory>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 // -----------------------------------------------------------------------------
 
@@ -18,6 +26,44 @@ namespace Bax
 
 class VM
 {
+public:
+	// Registers of every running function, and the deepest chain of calls
+	static constexpr size_t stack_size = 1 << 18;
+	static constexpr size_t max_frames = 1 << 14;
+	// Frames logged with a runtime error
+	static constexpr size_t max_traceback = 16;
+
+private:
+	struct Frame
+	{
+		Closure* closure;
+		// Next instruction, only up to date while another frame runs
+		const Instruction* pc;
+		// First register
+		Value* base;
+	};
+
+	std::unordered_map<std::string, std::string> m_environment;
+	// Objects are owned by the VM until it is destroyed, there is no collector
+	// yet
+	std::vector<std::unique_ptr<Object>> m_objects;
+	std::unordered_map<std::string, Value> m_globals;
+	// Globals of the running program, by index
+	std::vector<Value> m_program_globals;
+	// Methods of the values that are not tables, by `Value::Type`, and of
+	// each type of object
+	std::array<Table*, 5> m_value_methods {};
+	std::array<Table*, 6> m_object_methods {};
+
+	std::unique_ptr<Value[]> m_stack;
+	std::vector<Frame> m_frames;
+	Upvalue* m_open_upvalues = nullptr;
+	std::vector<Value> m_statics;
+	std::vector<bool> m_statics_initialized;
+	Value m_result;
+	std::string m_error;
+	FILE* m_output = stdout;
+
 public:
 	VM();
 	VM(char** environment);
@@ -25,8 +71,41 @@ public:
 
 	const std::unordered_map<std::string, std::string>& environment() const { return m_environment; }
 
+	// Runs the main function of `program`, with `args` as the `args` global.
+	// Fails on runtime errors, which are logged.
+	bool run(const Program& program, const std::vector<std::string>& args = {});
+	// Value returned by the main function of the last run
+	Value result() const { return m_result; }
+	// Message of the last runtime error
+	const std::string& error_message() const { return m_error; }
+
+	// Where `print` and `println` write
+	void set_output(FILE* output) { m_output = output; }
+	FILE* output() const { return m_output; }
+
+	String* make_string(std::string value);
+	Array* make_array();
+	Table* make_table();
+	Native* make_native(std::string name, NativeFunction function);
+	void define_global(const std::string& name, Value value) { m_globals[name] = value; }
+
+	std::string to_string(Value value) const;
+	const char* type_name(Value value) const;
+
+	// Records a runtime error and returns false, for natives to return it
+	template <typename S, typename... Args>
+	bool error(const S& format, Args&&... args) { return report(fmt::vformat(format, fmt::make_args_checked<Args...>(format, args...))); }
+
 private:
-	std::unordered_map<std::string, std::string> m_environment;
+	template <typename T, typename... Args>
+	T* make(Args&&... args);
+
+	bool report(std::string message);
+	void define_builtins();
+	bool execute();
+	Upvalue* capture(Value* slot);
+	void close_upvalues(Value* last);
+	const Value* method(Value object, const String* name) const;
 };
 
 }
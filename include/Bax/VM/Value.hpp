@@ -8,21 +8,122 @@
 
 // -----------------------------------------------------------------------------
 
+#include <bit>
+#include <cstdint>
+
+#ifdef BAX_CHECK_VALUES
+# include "Common/Assertions.hpp"
+# define BAX_CHECK_VALUE(x) ASSERT(x)
+#else
+# define BAX_CHECK_VALUE(x) ((void)0)
+#endif
+
+// -----------------------------------------------------------------------------
+
 namespace Bax
 {
 
+struct Object;
+
+// Registers, constants and the elements of arrays and objects. Values are only
+// built and read through these functions, the layout is private to them.
+//
+// A value is NaN-boxed in 64 bits. Doubles are stored as they are, except for
+// NaNs which are all made the same positive quiet NaN. Every other type lives
+// in the negative quiet NaNs that are left, its tag in the 16 upper bits and
+// its payload in the 48 lower ones:
+//
+//   0xFFF9 0000 iiii iiii  integers
+//   0xFFFA 0000 0000 0000  null
+//   0xFFFB 0000 0000 000b  booleans
+//   0xFFFC 0000 gggg gggg  glyphs
+//   0xFFFD pppp pppp pppp  objects, whose pointers fit in 48 bits
+//
+// Numbers are either doubles or 32-bit integers, which the VM computes with
+// integer instructions as long as they do not overflow. Both are the same
+// type to the language: whichever way a number is stored is an optimization.
+//
+// Build with BAX_CHECK_VALUES (the default for debug builds) to check that
+// values are only read as the type they hold, and pointers are boxed intact.
 struct Value
 {
 	enum class Type {
+		Number,
 		Null,
 		Bool,
-		Number,
-	} type { Type::Null };
+		Glyph,
+		Object,
+	};
+
+private:
+	static constexpr uint64_t tag_shift = 48;
+	static constexpr uint64_t tag_mask = 0xFFFFull << tag_shift;
+	static constexpr uint64_t payload_mask = ~tag_mask;
+	static constexpr uint64_t canonical_nan = 0x7FF8ull << tag_shift;
+
+	// A tag minus `integer_tag` is its type, below it every value is a double
+	static constexpr uint64_t integer_tag = 0xFFF9ull << tag_shift;
+	static constexpr uint64_t null_tag = 0xFFFAull << tag_shift;
+	static constexpr uint64_t bool_tag = 0xFFFBull << tag_shift;
+	static constexpr uint64_t glyph_tag = 0xFFFCull << tag_shift;
+	static constexpr uint64_t object_tag = 0xFFFDull << tag_shift;
 
-	union {
-		double number;
-		void* object;
-	} as { 0.0 };
+	static constexpr uint64_t null_bits = null_tag;
+	static constexpr uint64_t false_bits = bool_tag;
+	static constexpr uint64_t true_bits = bool_tag | 1;
+
+	uint64_t m_bits = null_bits;
+
+	static constexpr Value box(uint64_t bits) { Value v; v.m_bits = bits; return v; }
+
+public:
+	static constexpr Value null() { return {}; }
+	static constexpr Value from_bool(bool b) { return box(b ? true_bits : false_bits); }
+	static constexpr Value from_glyph(uint32_t g) { return box(glyph_tag | g); }
+	// Stays an integer if it fits in 32 bits, becomes a double otherwise
+	static constexpr Value from_integer(int64_t i)
+	{
+		if (i != static_cast<int32_t>(i))
+			return from_number(static_cast<double>(i));
+		return box(integer_tag | static_cast<uint32_t>(i));
+	}
+	static constexpr Value from_number(double n)
+	{
+		// Other NaNs could look like tagged values
+		return box(n == n ? std::bit_cast<uint64_t>(n) : canonical_nan);
+	}
+	static Value from_object(Bax::Object* o)
+	{
+		auto address = reinterpret_cast<uintptr_t>(o);
+		BAX_CHECK_VALUE((address & tag_mask) == 0);
+		return box(object_tag | address);
+	}
+
+	Type type() const { return is_double() ? Type::Number : static_cast<Type>((m_bits - integer_tag) >> tag_shift); }
+
+	bool is_null() const { return m_bits == null_bits; }
+	bool is_bool() const { return (m_bits & ~1ull) == false_bits; }
+	bool is_glyph() const { return (m_bits & tag_mask) == glyph_tag; }
+	// Either a double or an integer
+	bool is_number() const { return m_bits < null_tag; }
+	bool is_integer() const { return (m_bits & tag_mask) == integer_tag; }
+	bool is_double() const { return m_bits < integer_tag; }
+	bool is_object() const { return (m_bits & tag_mask) == object_tag; }
+
+	bool to_bool() const { BAX_CHECK_VALUE(is_bool()); return m_bits & 1; }
+	uint32_t to_glyph() const { BAX_CHECK_VALUE(is_glyph()); return static_cast<uint32_t>(m_bits); }
+	// Converts integers
+	double to_number() const { BAX_CHECK_VALUE(is_number()); return is_integer() ? to_integer() : std::bit_cast<double>(m_bits); }
+	int32_t to_integer() const { BAX_CHECK_VALUE(is_integer()); return static_cast<int32_t>(m_bits); }
+	Bax::Object* to_object() const { BAX_CHECK_VALUE(is_object()); return reinterpret_cast<Bax::Object*>(m_bits & payload_mask); }
+
+	// Only null and false are false
+	bool truthy() const { return m_bits != null_bits && m_bits != false_bits; }
+	// Same type and payload, which for numbers tells 0 from -0, 1 from 1.0, and
+	// finds NaN equal to itself
+	bool is_same(Value other) const { return m_bits == other.m_bits; }
 };
 
+static_assert(sizeof(Value) == 8);
+
 }
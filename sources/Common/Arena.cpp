@@ -0,0 +1,72 @@
+/*
+** Bax, 2021
+** Benoît Lormeau <blormeau@outlook.com>
+** Common / Arena.cpp
+*/
+
+#include "Arena.hpp"
+#include <algorithm>
+#include <cstdint>
+
+// -----------------------------------------------------------------------------
+
+Arena::Arena(Arena&& other) noexcept
+: m_blocks(std::move(other.m_blocks))
+, m_cursor(std::exchange(other.m_cursor, nullptr))
+, m_remaining(std::exchange(other.m_remaining, 0))
+, m_used(std::exchange(other.m_used, 0))
+, m_finalizers(std::exchange(other.m_finalizers, nullptr))
+{}
+
+Arena::~Arena()
+{
+	clear();
+}
+
+Arena& Arena::operator=(Arena&& other) noexcept
+{
+	if (this != &other) {
+		clear();
+		m_blocks = std::move(other.m_blocks);
+		m_cursor = std::exchange(other.m_cursor, nullptr);
+		m_remaining = std::exchange(other.m_remaining, 0);
+		m_used = std::exchange(other.m_used, 0);
+		m_finalizers = std::exchange(other.m_finalizers, nullptr);
+	}
+	return *this;
+}
+
+void* Arena::allocate(size_t size, size_t alignment)
+{
+	size_t padding = -reinterpret_cast<uintptr_t>(m_cursor) & (alignment - 1);
+	if (padding + size > m_remaining) {
+		// Blocks come from operator new[], aligned for any fundamental type
+		size_t block_size = std::max(size, default_block_size);
+		m_blocks.push_back(std::make_unique_for_overwrite<std::byte[]>(block_size));
+		m_cursor = m_blocks.back().get();
+		m_remaining = block_size;
+		padding = 0;
+	}
+
+	void* memory = m_cursor + padding;
+	m_cursor += padding + size;
+	m_remaining -= padding + size;
+	m_used += padding + size;
+	return memory;
+}
+
+void Arena::clear()
+{
+	for (auto* entry = m_finalizers; entry;) {
+		// The entry dies with its object
+		auto* next = entry->next;
+		entry->destroy(entry);
+		entry = next;
+	}
+	m_finalizers = nullptr;
+
+	m_blocks.clear();
+	m_cursor = nullptr;
+	m_remaining = 0;
+	m_used = 0;
+}
@@ -0,0 +1,84 @@
+/*
+** Bax, 2021
+** Benoît Lormeau <blormeau@outlook.com>
+** Common / Arena.hpp
+*/
+
+#pragma once
+
+// -----------------------------------------------------------------------------
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// -----------------------------------------------------------------------------
+
+// Bump allocator for objects that all die together, such as the nodes of a
+// tree. Objects are never moved, and are destroyed in reverse order of creation
+// along with the arena.
+class Arena
+{
+	// Precedes objects that have a destructor to run
+	struct Finalizer
+	{
+		void (*destroy)(Finalizer*);
+		Finalizer* next;
+	};
+
+	template <typename T>
+	struct Finalized : Finalizer
+	{
+		T object;
+	};
+
+	std::vector<std::unique_ptr<std::byte[]>> m_blocks;
+	std::byte* m_cursor = nullptr;
+	size_t m_remaining = 0;
+	size_t m_used = 0;
+	Finalizer* m_finalizers = nullptr;
+
+public:
+	static constexpr size_t default_block_size = 64 * 1024;
+
+	Arena() = default;
+	Arena(const Arena&) = delete;
+	Arena(Arena&&) noexcept;
+	~Arena();
+
+	Arena& operator=(const Arena&) = delete;
+	Arena& operator=(Arena&&) noexcept;
+
+	template <typename T, typename... Args>
+	T* make(Args&&... args)
+	{
+		if constexpr (std::is_trivially_destructible_v<T>) {
+			return new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+		}
+		else {
+			void* memory = allocate(sizeof(Finalized<T>), alignof(Finalized<T>));
+			auto* entry = new (memory) Finalized<T> { { &destroy<T>, m_finalizers }, T(std::forward<Args>(args)...) };
+			m_finalizers = entry;
+			return &entry->object;
+		}
+	}
+
+	// Uninitialized, suitably aligned space for `size` bytes
+	void* allocate(size_t size, size_t alignment);
+
+	// Bytes handed out so far, padding included
+	size_t used() const { return m_used; }
+
+	// Destroys every object and frees every block
+	void clear();
+
+private:
+	template <typename T>
+	static void destroy(Finalizer* entry)
+	{
+		static_cast<Finalized<T>*>(entry)->object.~T();
+	}
+};
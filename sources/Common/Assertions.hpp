@@ -10,6 +10,7 @@
 
 #include "TTYEscapeSequences.hpp"
 #include <cstdio>
+#include <cstdlib>
 
 // -----------------------------------------------------------------------------
 
@@ -0,0 +1,55 @@
+/*
+** Bax, 2021
+** Benoît Lormeau <blormeau@outlook.com>
+** Common / ConcurrentSymbolTable.cpp
+*/
+
+#include "Assertions.hpp"
+#include "ConcurrentSymbolTable.hpp"
+
+// -----------------------------------------------------------------------------
+
+ConcurrentSymbolTable::~ConcurrentSymbolTable()
+{
+	for (auto& chunk : m_chunks)
+		delete[] chunk.load(std::memory_order_relaxed);
+}
+
+Symbol ConcurrentSymbolTable::intern(std::string_view name)
+{
+	auto& shard = this->shard(name);
+	std::lock_guard lock(shard.lock);
+
+	Symbol local = shard.names.intern(name);
+	if (local < shard.symbols.size())
+		return shard.symbols[local];
+
+	Symbol symbol = m_size.fetch_add(1, std::memory_order_relaxed);
+	ASSERT((symbol >> chunk_bits) < max_chunks);
+
+	// Threads whose symbols start a chunk race to allocate it, one of them wins
+	auto& slot = m_chunks[symbol >> chunk_bits];
+	auto* chunk = slot.load(std::memory_order_acquire);
+	if (!chunk) {
+		auto* allocated = new std::string_view[chunk_size];
+		if (slot.compare_exchange_strong(chunk, allocated, std::memory_order_acq_rel))
+			chunk = allocated;
+		else
+			delete[] allocated;
+	}
+
+	// Published to other threads by the shard lock, or the symbol they got
+	// through it
+	chunk[symbol & (chunk_size - 1)] = shard.names.name(local);
+	shard.symbols.push_back(symbol);
+	return symbol;
+}
+
+Symbol ConcurrentSymbolTable::find(std::string_view name) const
+{
+	auto& shard = this->shard(name);
+	std::lock_guard lock(shard.lock);
+
+	Symbol local = shard.names.find(name);
+	return local == SymbolTable::empty_slot ? local : shard.symbols[local];
+}
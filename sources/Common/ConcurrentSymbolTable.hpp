@@ -0,0 +1,73 @@
+/*
+** Bax, 2021
+** Benoît Lormeau <blormeau@outlook.com>
+** Common / ConcurrentSymbolTable.hpp
+*/
+
+#pragma once
+
+// -----------------------------------------------------------------------------
+
+#include "SymbolTable.hpp"
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <string_view>
+#include <vector>
+
+// -----------------------------------------------------------------------------
+
+// Symbols shared by a whole compilation, interned from several threads at once.
+// Names are spread over shards by hash, each one locked on its own, and names
+// of known symbols are read without locking. Ids stay dense, but their order
+// depends on the threads' timing.
+//
+// Parsers intern through a SymbolTable in front of it, which remembers the
+// symbols it has seen: only their first occurrence reaches the shards.
+class ConcurrentSymbolTable
+{
+	static constexpr size_t shard_bits = 6;
+	static constexpr size_t shard_count = size_t(1) << shard_bits;
+	static constexpr size_t chunk_bits = 16;
+	static constexpr size_t chunk_size = size_t(1) << chunk_bits;
+	static constexpr size_t max_chunks = 4096;
+
+	struct alignas(64) Shard
+	{
+		std::mutex lock;
+		// Ids local to the shard, and their symbols
+		SymbolTable names;
+		std::vector<Symbol> symbols;
+	};
+
+	// Locked by `find` too
+	mutable std::array<Shard, shard_count> m_shards;
+	std::atomic<Symbol> m_size = 0;
+	// Names by symbol, in chunks which are never moved once allocated
+	std::array<std::atomic<std::string_view*>, max_chunks> m_chunks {};
+
+public:
+	ConcurrentSymbolTable() = default;
+	ConcurrentSymbolTable(const ConcurrentSymbolTable&) = delete;
+	~ConcurrentSymbolTable();
+
+	ConcurrentSymbolTable& operator=(const ConcurrentSymbolTable&) = delete;
+
+	// The symbol of `name`, added if it is new
+	Symbol intern(std::string_view name);
+	// The symbol of `name`, or `SymbolTable::empty_slot` if it was never interned
+	Symbol find(std::string_view name) const;
+
+	// `symbol` must come from this table
+	std::string_view name(Symbol symbol) const
+	{
+		return m_chunks[symbol >> chunk_bits].load(std::memory_order_acquire)[symbol & (chunk_size - 1)];
+	}
+	size_t size() const { return m_size.load(std::memory_order_relaxed); }
+
+private:
+	// Shards are picked by the high bits of the hash, the low ones are used by
+	// their own slots
+	Shard& shard(std::string_view name) const { return m_shards[SymbolTable::hash(name) >> (32 - shard_bits)]; }
+};
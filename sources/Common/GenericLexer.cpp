@@ -5,6 +5,19 @@
 */
 
 #include "GenericLexer.hpp"
+#include "Scanner.hpp"
+
+// -----------------------------------------------------------------------------
+
+GenericLexer::Position GenericLexer::position_of(size_t offset) const
+{
+	offset = std::max(offset, m_base);
+	auto position = m_lines.position_of(m_input, offset - m_base);
+	if (position.line == 1)
+		position.column = offset - m_base_line_start + 1;
+	position.line += m_base_line;
+	return position;
+}
 
 // -----------------------------------------------------------------------------
 
@@ -81,7 +94,6 @@ std::string_view GenericLexer::consume_quoted_string(char escape_char)
 	if (!next_is(is_quote))
 		return {};
 
-	auto start_position = position();
 	char quote_char = consume();
 	size_t start = tell();
 
@@ -95,7 +107,6 @@ std::string_view GenericLexer::consume_quoted_string(char escape_char)
 	if (peek() != quote_char) {
 		// Restore the index in case the string is unterminated
 		m_index = start - 1;
-		m_position = start_position;
 		return {};
 	}
 
@@ -105,6 +116,40 @@ std::string_view GenericLexer::consume_quoted_string(char escape_char)
 	return m_input.substr(start, length);
 }
 
+// Skip whitespaces in bulk, see `Scanner::skip_whitespace`
+void GenericLexer::ignore_whitespace()
+{
+	advance_to(Scanner::skip_whitespace(m_input, m_index));
+}
+
+// Ignore characters until `stop` is found, `stop` included
+void GenericLexer::ignore_until(char stop)
+{
+	advance_to(Scanner::find(m_input, m_index, stop));
+	ignore(1);
+}
+
+// Ignore characters until the string `stop` is found, `stop` included
+void GenericLexer::ignore_until(const char* stop)
+{
+	size_t length = __builtin_strlen(stop);
+	if (length < 2) {
+		if (length == 1)
+			ignore_until(stop[0]);
+		return;
+	}
+
+	size_t index = m_index;
+	while (true) {
+		index = Scanner::find(m_input, index, stop[0], stop[1]);
+		if (index >= m_input.length() || m_input.substr(index).starts_with(stop))
+			break;
+		++index;
+	}
+	advance_to(index);
+	ignore(length);
+}
+
 std::string GenericLexer::consume_and_unescape_string(char escape_char)
 {
 	auto view = consume_quoted_string(escape_char);
@@ -117,3 +162,51 @@ std::string GenericLexer::consume_and_unescape_string(char escape_char)
 	str.shrink_to_fit();
 	return str;
 }
+
+// -----------------------------------------------------------------------------
+
+// Move forward to `index` in one go
+void GenericLexer::advance_to(size_t index)
+{
+	if (index >= m_input.length()) {
+		index = m_input.length();
+		m_hit_end = true;
+	}
+	m_index = std::max(m_index, index);
+}
+
+// Drop the streamed input before `keep_from` (an offset in the whole stream),
+// then read at least one more chunk. Returns false if the stream is exhausted.
+bool GenericLexer::refill(size_t keep_from)
+{
+	if (!m_stream || m_stream_done)
+		return false;
+
+	keep_from = std::clamp(keep_from, m_base, m_base + m_index);
+	size_t drop = keep_from - m_base;
+	if (drop > 0) {
+		std::string_view dropped(m_buffer.data(), drop);
+		size_t newlines = Scanner::count(dropped, 0, drop, '\n');
+		if (newlines > 0) {
+			m_base_line += newlines;
+			m_base_line_start = m_base + dropped.rfind('\n') + 1;
+		}
+		m_buffer.erase(m_buffer.begin(), m_buffer.begin() + drop);
+		m_base += drop;
+		m_index -= drop;
+	}
+
+	// Grow geometrically, so that long tokens are not re-read quadratically
+	size_t size = m_buffer.size();
+	size_t wanted = std::max(m_chunk_size, size);
+	m_buffer.resize(size + wanted);
+	m_stream->read(m_buffer.data() + size, wanted);
+	size_t got = m_stream->gcount();
+	m_buffer.resize(size + got);
+	if (got < wanted)
+		m_stream_done = true;
+
+	m_input = std::string_view(m_buffer.data(), m_buffer.size());
+	m_lines.reset();
+	return true;
+}
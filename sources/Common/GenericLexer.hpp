@@ -9,46 +9,151 @@
 // -----------------------------------------------------------------------------
 
 #include "Assertions.hpp"
+#include "LineTable.hpp"
 #include "fmt/format.h"
 #include <algorithm>
+#include <array>
+#include <cstdint>
 #include <functional>
+#include <istream>
 #include <optional>
 #include <ostream>
 #include <string_view>
+#include <vector>
 
 // -----------------------------------------------------------------------------
 
+// Character classes, regardless of the current locale, see `char_classes`
+namespace CharClass
+{
+enum : uint8_t {
+	Whitespace  = 1 << 0, // Space, \t, \n, \v, \f and \r
+	Digit       = 1 << 1,
+	HexDigit    = 1 << 2, // 0-9, a-f and A-F
+	Upper       = 1 << 3,
+	Lower       = 1 << 4,
+	Underscore  = 1 << 5,
+	Punctuation = 1 << 6, // Printable ASCII, except alphanumerics and space
+	NonAscii    = 1 << 7, // Bytes of multi-byte UTF-8 sequences
+
+	Alpha = Upper | Lower,
+	Alnum = Alpha | Digit,
+};
+}
+
+constexpr std::array<uint8_t, 256> char_classes = [] {
+	std::array<uint8_t, 256> classes {};
+	for (int c = 0; c < 256; ++c) {
+		uint8_t& cls = classes[c];
+		if (c == ' ' || (c >= '\t' && c <= '\r'))
+			cls |= CharClass::Whitespace;
+		if (c >= '0' && c <= '9')
+			cls |= CharClass::Digit | CharClass::HexDigit;
+		if (c >= 'A' && c <= 'Z')
+			cls |= CharClass::Upper | (c <= 'F' ? CharClass::HexDigit : 0);
+		if (c >= 'a' && c <= 'z')
+			cls |= CharClass::Lower | (c <= 'f' ? CharClass::HexDigit : 0);
+		if (c == '_')
+			cls |= CharClass::Underscore;
+		if (c > ' ' && c < 0x7F && !(cls & (CharClass::Alnum)))
+			cls |= CharClass::Punctuation;
+		if (c >= 0x80)
+			cls |= CharClass::NonAscii;
+	}
+	return classes;
+}();
+
+constexpr bool has_char_class(char c, uint8_t classes)
+{
+	return char_classes[(uint8_t)c] & classes;
+}
+
+// -----------------------------------------------------------------------------
+
+struct GenericToken;
+
 class GenericLexer
 {
 public:
-	struct Position {
-		size_t column = 1;
-		size_t line = 1;
-	};
+	using Position = LineTable::Position;
 
 protected:
 	std::string_view m_input;
 	size_t m_index = 0;
-	Position m_position;
+	mutable LineTable m_lines;
+
+	// Streaming mode: `m_input` is a window over `m_buffer`, which is refilled
+	// from `m_stream` by chunks, see `refill`
+	std::istream* m_stream = nullptr;
+	std::vector<char> m_buffer;
+	size_t m_chunk_size = 0;
+	size_t m_base = 0;            // Offset of `m_input[0]` in the whole stream
+	size_t m_base_line = 0;       // Lines dropped before `m_base`
+	size_t m_base_line_start = 0; // Offset of the line containing `m_base`
+	bool m_stream_done = false;
+	mutable bool m_hit_end = false; // Set when reading past the end of `m_input`
 
 public:
-	constexpr explicit GenericLexer(std::string_view input)
+	explicit GenericLexer(std::string_view input)
 	: m_input(input)
+	{
+		ASSERT_MSG(input.length() <= UINT32_MAX, "Inputs are limited to 4GiB");
+	}
+
+	GenericLexer(std::istream& stream, size_t chunk_size)
+	: m_stream(&stream)
+	, m_chunk_size(std::max<size_t>(chunk_size, 1))
 	{}
 
 	constexpr size_t tell() const { return m_index; }
 	constexpr size_t tell_remaining() const { return m_input.length() - m_index; }
+	constexpr std::string_view input() const { return m_input; }
 	std::string_view remaining() const { return m_input.substr(m_index); }
-	const Position& position() const { return m_position; }
+	constexpr bool is_streaming() const { return m_stream != nullptr; }
+
+	// Line and column are only computed on demand, from a lazily built index
+	Position position() const { return position_of(m_base + m_index); }
+	Position position_of(size_t offset) const;
+
+	std::string_view text(const GenericToken&) const;
+
+	static constexpr auto is_whitespace   = [] (char c) { return has_char_class(c, CharClass::Whitespace); };
+	static constexpr auto is_digit        = [] (char c) { return has_char_class(c, CharClass::Digit); };
+	static constexpr auto is_hex_digit    = [] (char c) { return has_char_class(c, CharClass::HexDigit); };
+	static constexpr auto is_alpha        = [] (char c) { return has_char_class(c, CharClass::Alpha); };
+	static constexpr auto is_alnum        = [] (char c) { return has_char_class(c, CharClass::Alnum); };
+	static constexpr auto is_punctuation  = [] (char c) { return has_char_class(c, CharClass::Punctuation); };
+	static constexpr auto is_non_ascii    = [] (char c) { return has_char_class(c, CharClass::NonAscii); };
+
+	static constexpr char to_lower(char c)
+	{
+		return has_char_class(c, CharClass::Upper) ? c + ('a' - 'A') : c;
+	}
+
+	// Value of `c` as a digit in bases up to 36, or 36 if it is not one
+	static constexpr uint8_t digit_value(char c)
+	{
+		if (is_digit(c))
+			return c - '0';
+		if (is_alpha(c))
+			return to_lower(c) - 'a' + 10;
+		return 36;
+	}
 
 	constexpr bool is_eof() const
 	{
-		return m_index >= m_input.length();
+		if (m_index < m_input.length())
+			return false;
+		m_hit_end = true;
+		return true;
 	}
 
 	constexpr char peek(size_t offset = 0) const
 	{
-		return (m_index + offset < m_input.length()) ? m_input[m_index + offset] : '\0';
+		if (m_index + offset < m_input.length())
+			return m_input[m_index + offset];
+		m_hit_end = true;
+		return '\0';
 	}
 
 	constexpr char consume()
@@ -62,7 +167,7 @@ public:
 	constexpr void retreat()
 	{
 		ASSERT(tell() > 0);
-		advance(1, false);
+		--m_index;
 	}
 
 	constexpr bool next_is(char expected) const
@@ -109,6 +214,30 @@ public:
 		return c;
 	}
 
+	// Length of the well-formed, multi-byte UTF-8 sequence at `offset` from
+	// the current index, or 0 if there is none
+	constexpr size_t peek_utf8_sequence(size_t offset = 0) const
+	{
+		auto byte = [&] (size_t i) { return (uint8_t)peek(offset + i); };
+		auto in = [] (uint8_t b, uint8_t low, uint8_t high) { return b >= low && b <= high; };
+
+		uint8_t lead = byte(0);
+		if (lead < 0xC2 || lead > 0xF4)
+			return 0;
+		size_t length = lead < 0xE0 ? 2 : lead < 0xF0 ? 3 : 4;
+
+		// Second bytes are restricted so as to exclude overlong encodings,
+		// surrogates and code points above U+10FFFF
+		uint8_t low = lead == 0xE0 ? 0xA0 : lead == 0xF0 ? 0x90 : 0x80;
+		uint8_t high = lead == 0xED ? 0x9F : lead == 0xF4 ? 0x8F : 0xBF;
+		if (!in(byte(1), low, high))
+			return 0;
+		for (size_t i = 2; i < length; ++i)
+			if (!in(byte(i), 0x80, 0xBF))
+				return 0;
+		return length;
+	}
+
 	template<typename T>
 	constexpr bool consume_specific(const T& next)
 	{
@@ -153,26 +282,14 @@ public:
 		advance(count);
 	}
 
-	constexpr void ignore_line()
+	void ignore_line()
 	{
 		ignore_until('\n');
 	}
 
-	constexpr void ignore_until(char stop)
-	{
-		while (!is_eof() && !next_is(stop)) {
-			advance(1);
-		}
-		ignore(1);
-	}
-
-	constexpr void ignore_until(const char* stop)
-	{
-		while (!is_eof() && !next_is(stop)) {
-			advance(1);
-		}
-		ignore(__builtin_strlen(stop));
-	}
+	void ignore_whitespace();
+	void ignore_until(char stop);
+	void ignore_until(const char* stop);
 
 	template<typename TPredicate>
 	constexpr void ignore_while(TPredicate pred)
@@ -189,50 +306,33 @@ public:
 	}
 
 protected:
-	constexpr void advance(size_t count, bool forward = true)
-	{
-		if (count == 0)
-			return;
+	void advance_to(size_t index);
+	bool refill(size_t keep_from);
 
-		if (forward)
-			ASSERT(count <= tell_remaining());
-		else
-			ASSERT(count <= m_index);
-
-		while (count--) {
-			if (forward) {
-				if (m_input[m_index++] == '\n') {
-					m_position.line++;
-					m_position.column = 1;
-				}
-				else {
-					m_position.column++;
-				}
-			}
-			else {
-				if (m_input[--m_index] == '\n') {
-					m_position.line--;
-					m_position.column = 1;
-					// Iterate backwards to the beginning of the line
-					for (size_t i = 0; i < m_index && m_input[m_index - i - 1] != '\n'; ++i)
-						m_position.column++;
-				}
-				else {
-					m_position.column--;
-				}
-			}
-		}
+	constexpr void advance(size_t count)
+	{
+		ASSERT(count <= tell_remaining());
+		m_index += count;
 	}
 };
 
 // -----------------------------------------------------------------------------
 
+// Tokens only reference their source, see `GenericLexer::text`
 struct GenericToken
 {
-	std::string_view trivia;
-	GenericLexer::Position start, end;
+	uint32_t offset = 0;
+	uint32_t length = 0;
+
+	constexpr uint32_t end() const { return offset + length; }
 };
 
+inline std::string_view GenericLexer::text(const GenericToken& token) const
+{
+	// Offsets wrap around past 4GiB of streamed input, so does this difference
+	return m_input.substr(uint32_t(token.offset - uint32_t(m_base)), token.length);
+}
+
 // -----------------------------------------------------------------------------
 
 constexpr auto is_any_of(const std::string_view& values)
@@ -263,6 +363,6 @@ struct fmt::formatter<GenericToken> {
 	}
 	template <typename FormatContext>
 	auto format(const GenericToken& t, FormatContext& ctx) {
-		return format_to(ctx.out(), "{}>{}:\"{}\"", t.start, t.end, t.trivia);
+		return format_to(ctx.out(), "{}+{}", t.offset, t.length);
 	}
 };
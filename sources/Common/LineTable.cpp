@@ -0,0 +1,41 @@
+/*
+** Bax, 2021
+** Benoît Lormeau <blormeau@outlook.com>
+** Common / LineTable.cpp
+*/
+
+#include "Assertions.hpp"
+#include "LineTable.hpp"
+#include "Scanner.hpp"
+#include <algorithm>
+
+// -----------------------------------------------------------------------------
+
+void LineTable::build(std::string_view input)
+{
+	ASSERT(input.length() <= UINT32_MAX);
+
+	m_line_starts.clear();
+	m_line_starts.reserve(Scanner::count(input, 0, input.length(), '\n') + 1);
+	m_line_starts.push_back(0);
+	for (size_t i = Scanner::find(input, 0, '\n'); i < input.length(); i = Scanner::find(input, i + 1, '\n'))
+		m_line_starts.push_back(i + 1);
+	m_built = true;
+}
+
+void LineTable::reset()
+{
+	m_line_starts.clear();
+	m_built = false;
+}
+
+LineTable::Position LineTable::position_of(std::string_view input, size_t offset)
+{
+	if (!m_built)
+		build(input);
+
+	offset = std::min(offset, input.length());
+	auto it = std::upper_bound(m_line_starts.begin(), m_line_starts.end(), offset);
+	size_t line = it - m_line_starts.begin();
+	return { offset - *(it - 1) + 1, line };
+}
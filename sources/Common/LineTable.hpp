@@ -0,0 +1,41 @@
+/*
+** Bax, 2021
+** Benoît Lormeau <blormeau@outlook.com>
+** Common / LineTable.hpp
+*/
+
+#pragma once
+
+// -----------------------------------------------------------------------------
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+// -----------------------------------------------------------------------------
+
+// Index of the line starts of an input, to turn byte offsets into positions.
+// It is only built on the first lookup, so that lexing never has to keep
+// track of lines and columns itself.
+class LineTable
+{
+public:
+	struct Position {
+		size_t column = 1;
+		size_t line = 1;
+	};
+
+private:
+	std::vector<uint32_t> m_line_starts;
+	bool m_built = false;
+
+public:
+	bool is_built() const { return m_built; }
+	size_t line_count() const { return m_line_starts.size(); }
+
+	void build(std::string_view input);
+	void reset();
+
+	Position position_of(std::string_view input, size_t offset);
+};
@@ -13,6 +13,7 @@
 // -----------------------------------------------------------------------------
 
 Log::Level Log::s_level = Log::Level::Trace;
+FILE* Log::s_output = stdout;
 
 // -----------------------------------------------------------------------------
 
@@ -37,7 +38,7 @@ void Log::log(Level level, fmt::string_view format, fmt::format_args args)
 		return;
 
 	std::time_t t = std::time(nullptr);
-	fmt::print("{} {} {}\n",
+	fmt::print(s_output, "{} {} {}\n",
 		fmt::format(fmt::emphasis::faint, "{:%Y-%m-%d %H:%M:%S}", fmt::localtime(t)),
 		fmt::format(levels[level].style, "{}", levels[level].name),
 		fmt::vformat(format, args)
@@ -9,6 +9,7 @@
 // -----------------------------------------------------------------------------
 
 #include "fmt/format.h"
+#include <cstdio>
 #include <iostream>
 
 // -----------------------------------------------------------------------------
@@ -42,10 +43,13 @@ public:
 
 	static Level level() { return s_level; }
 	static void set_level(Level level) { s_level = level; }
+	// stdout by default
+	static void set_output(FILE* output) { s_output = output; }
 
 private:
 	static void log(Level level, fmt::string_view format, fmt::format_args args);
 
 private:
 	static Level s_level;
+	static FILE* s_output;
 };
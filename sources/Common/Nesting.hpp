@@ -0,0 +1,26 @@
+/*
+** Bax, 2021
+** Benoît Lormeau <blormeau@outlook.com>
+** Common / Nesting.hpp
+*/
+
+#pragma once
+
+// -----------------------------------------------------------------------------
+
+#include <cstddef>
+
+// -----------------------------------------------------------------------------
+
+// Counts a level of nesting for as long as it lives
+class Nesting
+{
+	size_t& m_depth;
+
+public:
+	explicit Nesting(size_t& depth)
+	: m_depth(++depth)
+	{}
+
+	~Nesting() { --m_depth; }
+};
@@ -0,0 +1,103 @@
+/*
+** Bax, 2021
+** Benoît Lormeau <blormeau@outlook.com>
+** Common / ParallelFor.hpp
+*/
+
+#pragma once
+
+// -----------------------------------------------------------------------------
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// -----------------------------------------------------------------------------
+
+// Calls `work(index, worker)` for every index in [0, count), on up to
+// `thread_count` threads, the calling one included. `worker`, in
+// [0, thread_count), tells which thread runs it, eg. to use its own allocator.
+//
+// Each worker starts with an even, contiguous share of the indices. Once done
+// with its own, it steals the upper half of the largest share left, so that
+// uneven work items stay balanced without a shared queue.
+template <typename Work>
+void parallel_for(size_t count, size_t thread_count, Work&& work)
+{
+	thread_count = std::clamp<size_t>(thread_count, 1, std::max<size_t>(count, 1));
+	if (thread_count == 1) {
+		for (size_t i = 0; i < count; ++i)
+			work(i, size_t(0));
+		return;
+	}
+
+	struct alignas(64) Share
+	{
+		std::mutex lock;
+		size_t begin = 0;
+		size_t end = 0;
+	};
+
+	auto shares = std::make_unique<Share[]>(thread_count);
+	for (size_t w = 0; w < thread_count; ++w) {
+		shares[w].begin = count * w / thread_count;
+		shares[w].end = count * (w + 1) / thread_count;
+	}
+
+	// Moves half of the largest other share to `thief`, false once all are empty
+	auto steal = [&] (size_t thief) {
+		while (1) {
+			size_t victim = thief, largest = 0;
+			for (size_t w = 0; w < thread_count; ++w) {
+				std::lock_guard lock(shares[w].lock);
+				if (shares[w].end - shares[w].begin > largest) {
+					largest = shares[w].end - shares[w].begin;
+					victim = w;
+				}
+			}
+			if (largest == 0)
+				return false;
+
+			size_t begin, end;
+			{
+				std::lock_guard lock(shares[victim].lock);
+				// Taken in the meantime, look again
+				if (shares[victim].begin == shares[victim].end)
+					continue;
+				end = shares[victim].end;
+				begin = shares[victim].begin + (end - shares[victim].begin) / 2;
+				shares[victim].end = begin;
+			}
+
+			std::lock_guard lock(shares[thief].lock);
+			shares[thief].begin = begin;
+			shares[thief].end = end;
+			return true;
+		}
+	};
+
+	auto run = [&] (size_t worker) {
+		auto& own = shares[worker];
+		while (1) {
+			size_t i;
+			{
+				std::lock_guard lock(own.lock);
+				i = own.begin < own.end ? own.begin++ : count;
+			}
+			if (i < count)
+				work(i, worker);
+			else if (!steal(worker))
+				return;
+		}
+	};
+
+	std::vector<std::thread> threads;
+	for (size_t w = 1; w < thread_count; ++w)
+		threads.emplace_back(run, w);
+	run(0);
+	for (auto& thread : threads)
+		thread.join();
+}
@@ -0,0 +1,309 @@
+/*
+** Bax, 2021
+** Benoît Lormeau <blormeau@outlook.com>
+** Common / Scanner.cpp
+*/
+
+#include "Scanner.hpp"
+#include <algorithm>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+	#define SCANNER_HAS_X86 1
+	#include <immintrin.h>
+#endif
+
+// -----------------------------------------------------------------------------
+
+namespace
+{
+
+constexpr bool is_whitespace(char c)
+{
+	return c == ' ' || (unsigned char)(c - '\t') <= '\r' - '\t';
+}
+
+/// Scalar ---------------------------------------------------------------------
+
+size_t skip_whitespace_scalar(const char* s, size_t i, size_t n)
+{
+	while (i < n && is_whitespace(s[i]))
+		++i;
+	return i;
+}
+
+size_t find_scalar(const char* s, size_t i, size_t n, char c)
+{
+	while (i < n && s[i] != c)
+		++i;
+	return i;
+}
+
+size_t find_pair_scalar(const char* s, size_t i, size_t n, char c1, char c2)
+{
+	for (; i + 1 < n; ++i)
+		if (s[i] == c1 && s[i + 1] == c2)
+			return i;
+	return n;
+}
+
+size_t find_either_scalar(const char* s, size_t i, size_t n, char c1, char c2)
+{
+	while (i < n && s[i] != c1 && s[i] != c2)
+		++i;
+	return i;
+}
+
+size_t count_scalar(const char* s, size_t i, size_t n, char c)
+{
+	size_t total = 0;
+	for (; i < n; ++i)
+		total += s[i] == c;
+	return total;
+}
+
+#ifdef SCANNER_HAS_X86
+
+/// SSE2 -----------------------------------------------------------------------
+
+__attribute__((target("sse2")))
+size_t skip_whitespace_sse2(const char* s, size_t i, size_t n)
+{
+	const __m128i space = _mm_set1_epi8(' ');
+	const __m128i tab = _mm_set1_epi8('\t');
+	const __m128i range = _mm_set1_epi8('\r' - '\t');
+
+	for (; i + 16 <= n; i += 16) {
+		__m128i c = _mm_loadu_si128((const __m128i*)(s + i));
+		__m128i t = _mm_sub_epi8(c, tab);
+		__m128i ws = _mm_or_si128(_mm_cmpeq_epi8(c, space), _mm_cmpeq_epi8(_mm_min_epu8(t, range), t));
+		unsigned mask = ~(unsigned)_mm_movemask_epi8(ws) & 0xFFFF;
+		if (mask != 0)
+			return i + __builtin_ctz(mask);
+	}
+	return skip_whitespace_scalar(s, i, n);
+}
+
+__attribute__((target("sse2")))
+size_t find_sse2(const char* s, size_t i, size_t n, char c)
+{
+	const __m128i needle = _mm_set1_epi8(c);
+
+	for (; i + 16 <= n; i += 16) {
+		__m128i b = _mm_loadu_si128((const __m128i*)(s + i));
+		unsigned mask = _mm_movemask_epi8(_mm_cmpeq_epi8(b, needle));
+		if (mask != 0)
+			return i + __builtin_ctz(mask);
+	}
+	return find_scalar(s, i, n, c);
+}
+
+__attribute__((target("sse2")))
+size_t find_pair_sse2(const char* s, size_t i, size_t n, char c1, char c2)
+{
+	const __m128i first = _mm_set1_epi8(c1);
+	const __m128i second = _mm_set1_epi8(c2);
+
+	for (; i + 17 <= n; i += 16) {
+		__m128i b1 = _mm_loadu_si128((const __m128i*)(s + i));
+		__m128i b2 = _mm_loadu_si128((const __m128i*)(s + i + 1));
+		unsigned mask = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(b1, first), _mm_cmpeq_epi8(b2, second)));
+		if (mask != 0)
+			return i + __builtin_ctz(mask);
+	}
+	return find_pair_scalar(s, i, n, c1, c2);
+}
+
+__attribute__((target("sse2")))
+size_t find_either_sse2(const char* s, size_t i, size_t n, char c1, char c2)
+{
+	const __m128i first = _mm_set1_epi8(c1);
+	const __m128i second = _mm_set1_epi8(c2);
+
+	for (; i + 16 <= n; i += 16) {
+		__m128i b = _mm_loadu_si128((const __m128i*)(s + i));
+		unsigned mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(b, first), _mm_cmpeq_epi8(b, second)));
+		if (mask != 0)
+			return i + __builtin_ctz(mask);
+	}
+	return find_either_scalar(s, i, n, c1, c2);
+}
+
+__attribute__((target("sse2,popcnt")))
+size_t count_sse2(const char* s, size_t i, size_t n, char c)
+{
+	const __m128i needle = _mm_set1_epi8(c);
+	size_t total = 0;
+
+	for (; i + 16 <= n; i += 16) {
+		__m128i b = _mm_loadu_si128((const __m128i*)(s + i));
+		total += __builtin_popcount(_mm_movemask_epi8(_mm_cmpeq_epi8(b, needle)));
+	}
+	return total + count_scalar(s, i, n, c);
+}
+
+/// AVX2 -----------------------------------------------------------------------
+
+// The remaining bytes are left to the SSE2 versions, whose legacy encoded
+// instructions are slowed down while the upper halves of the ymm registers
+// are in use. The compiler does not always clear them before tail calls.
+__attribute__((target("avx")))
+inline void leave_avx()
+{
+	_mm256_zeroupper();
+}
+
+__attribute__((target("avx2")))
+size_t skip_whitespace_avx2(const char* s, size_t i, size_t n)
+{
+	const __m256i space = _mm256_set1_epi8(' ');
+	const __m256i tab = _mm256_set1_epi8('\t');
+	const __m256i range = _mm256_set1_epi8('\r' - '\t');
+
+	for (; i + 32 <= n; i += 32) {
+		__m256i c = _mm256_loadu_si256((const __m256i*)(s + i));
+		__m256i t = _mm256_sub_epi8(c, tab);
+		__m256i ws = _mm256_or_si256(_mm256_cmpeq_epi8(c, space), _mm256_cmpeq_epi8(_mm256_min_epu8(t, range), t));
+		uint32_t mask = ~(uint32_t)_mm256_movemask_epi8(ws);
+		if (mask != 0)
+			return i + __builtin_ctz(mask);
+	}
+	leave_avx();
+	return skip_whitespace_sse2(s, i, n);
+}
+
+__attribute__((target("avx2")))
+size_t find_avx2(const char* s, size_t i, size_t n, char c)
+{
+	const __m256i needle = _mm256_set1_epi8(c);
+
+	for (; i + 32 <= n; i += 32) {
+		__m256i b = _mm256_loadu_si256((const __m256i*)(s + i));
+		uint32_t mask = _mm256_movemask_epi8(_mm256_cmpeq_epi8(b, needle));
+		if (mask != 0)
+			return i + __builtin_ctz(mask);
+	}
+	leave_avx();
+	return find_sse2(s, i, n, c);
+}
+
+__attribute__((target("avx2")))
+size_t find_pair_avx2(const char* s, size_t i, size_t n, char c1, char c2)
+{
+	const __m256i first = _mm256_set1_epi8(c1);
+	const __m256i second = _mm256_set1_epi8(c2);
+
+	for (; i + 33 <= n; i += 32) {
+		__m256i b1 = _mm256_loadu_si256((const __m256i*)(s + i));
+		__m256i b2 = _mm256_loadu_si256((const __m256i*)(s + i + 1));
+		uint32_t mask = _mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(b1, first), _mm256_cmpeq_epi8(b2, second)));
+		if (mask != 0)
+			return i + __builtin_ctz(mask);
+	}
+	leave_avx();
+	return find_pair_sse2(s, i, n, c1, c2);
+}
+
+__attribute__((target("avx2")))
+size_t find_either_avx2(const char* s, size_t i, size_t n, char c1, char c2)
+{
+	const __m256i first = _mm256_set1_epi8(c1);
+	const __m256i second = _mm256_set1_epi8(c2);
+
+	for (; i + 32 <= n; i += 32) {
+		__m256i b = _mm256_loadu_si256((const __m256i*)(s + i));
+		uint32_t mask = _mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(b, first), _mm256_cmpeq_epi8(b, second)));
+		if (mask != 0)
+			return i + __builtin_ctz(mask);
+	}
+	leave_avx();
+	return find_either_sse2(s, i, n, c1, c2);
+}
+
+__attribute__((target("avx2,popcnt")))
+size_t count_avx2(const char* s, size_t i, size_t n, char c)
+{
+	const __m256i needle = _mm256_set1_epi8(c);
+	size_t total = 0;
+
+	for (; i + 32 <= n; i += 32) {
+		__m256i b = _mm256_loadu_si256((const __m256i*)(s + i));
+		total += __builtin_popcount(_mm256_movemask_epi8(_mm256_cmpeq_epi8(b, needle)));
+	}
+	leave_avx();
+	return total + count_sse2(s, i, n, c);
+}
+
+#endif
+
+/// Dispatch -------------------------------------------------------------------
+
+struct Implementation
+{
+	const char* name;
+	size_t (*skip_whitespace)(const char*, size_t, size_t);
+	size_t (*find)(const char*, size_t, size_t, char);
+	size_t (*find_pair)(const char*, size_t, size_t, char, char);
+	size_t (*find_either)(const char*, size_t, size_t, char, char);
+	size_t (*count)(const char*, size_t, size_t, char);
+};
+
+const Implementation& select_implementation()
+{
+	static const Implementation implementation = [] () -> Implementation {
+#ifdef SCANNER_HAS_X86
+		__builtin_cpu_init();
+		if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt"))
+			return { "avx2", skip_whitespace_avx2, find_avx2, find_pair_avx2, find_either_avx2, count_avx2 };
+		if (__builtin_cpu_supports("sse2") && __builtin_cpu_supports("popcnt"))
+			return { "sse2", skip_whitespace_sse2, find_sse2, find_pair_sse2, find_either_sse2, count_sse2 };
+#endif
+		return { "scalar", skip_whitespace_scalar, find_scalar, find_pair_scalar, find_either_scalar, count_scalar };
+	}();
+	return implementation;
+}
+
+}
+
+// -----------------------------------------------------------------------------
+
+size_t Scanner::skip_whitespace(std::string_view input, size_t from)
+{
+	if (from >= input.length())
+		return input.length();
+	return select_implementation().skip_whitespace(input.data(), from, input.length());
+}
+
+size_t Scanner::find(std::string_view input, size_t from, char c)
+{
+	if (from >= input.length())
+		return input.length();
+	return select_implementation().find(input.data(), from, input.length(), c);
+}
+
+size_t Scanner::find(std::string_view input, size_t from, char c1, char c2)
+{
+	if (from >= input.length())
+		return input.length();
+	return select_implementation().find_pair(input.data(), from, input.length(), c1, c2);
+}
+
+size_t Scanner::find_first_of(std::string_view input, size_t from, char c1, char c2)
+{
+	if (from >= input.length())
+		return input.length();
+	return select_implementation().find_either(input.data(), from, input.length(), c1, c2);
+}
+
+size_t Scanner::count(std::string_view input, size_t from, size_t to, char c)
+{
+	to = std::min(to, input.length());
+	if (from >= to)
+		return 0;
+	return select_implementation().count(input.data(), from, to, c);
+}
+
+const char* Scanner::implementation()
+{
+	return select_implementation().name;
+}
@@ -0,0 +1,42 @@
+/*
+** Bax, 2021
+** Benoît Lormeau <blormeau@outlook.com>
+** Common / Scanner.hpp
+*/
+
+#pragma once
+
+// -----------------------------------------------------------------------------
+
+#include <cstddef>
+#include <string_view>
+
+// -----------------------------------------------------------------------------
+
+// Bulk byte scanning primitives used by the lexers to skip over trivia.
+// The implementation (AVX2, SSE2 or scalar) is selected once at runtime,
+// depending on what the host CPU supports.
+// Every function returns an index into `input`, or `input.length()` when the
+// searched byte(s) could not be found.
+class Scanner
+{
+public:
+	// Index of the first byte at or after `from` that is not a whitespace,
+	// using the same set of characters as `isspace` in the "C" locale
+	static size_t skip_whitespace(std::string_view input, size_t from);
+
+	// Index of the first occurrence of `c` at or after `from`
+	static size_t find(std::string_view input, size_t from, char c);
+
+	// Index of the first occurrence of the pair `c1c2` at or after `from`
+	static size_t find(std::string_view input, size_t from, char c1, char c2);
+
+	// Index of the first occurrence of either `c1` or `c2` at or after `from`
+	static size_t find_first_of(std::string_view input, size_t from, char c1, char c2);
+
+	// Number of occurrences of `c` in [`from`, `to`)
+	static size_t count(std::string_view input, size_t from, size_t to, char c);
+
+	// Name of the selected implementation, for debugging purposes
+	static const char* implementation();
+};
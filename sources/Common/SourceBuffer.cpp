@@ -0,0 +1,115 @@
+/*
+** Bax, 2021
+** Benoît Lormeau <blormeau@outlook.com>
+** Common / SourceBuffer.cpp
+*/
+
+#include "Log.hpp"
+#include "SourceBuffer.hpp"
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utility>
+
+// -----------------------------------------------------------------------------
+
+SourceBuffer::SourceBuffer(std::string owned)
+: m_owned(std::move(owned))
+{}
+
+SourceBuffer::SourceBuffer(SourceBuffer&& other)
+: m_owned(std::move(other.m_owned))
+, m_mapping(std::exchange(other.m_mapping, nullptr))
+, m_mapping_size(std::exchange(other.m_mapping_size, 0))
+{}
+
+SourceBuffer::~SourceBuffer()
+{
+	release();
+}
+
+SourceBuffer& SourceBuffer::operator=(SourceBuffer&& other)
+{
+	if (this != &other) {
+		release();
+		m_owned = std::move(other.m_owned);
+		m_mapping = std::exchange(other.m_mapping, nullptr);
+		m_mapping_size = std::exchange(other.m_mapping_size, 0);
+	}
+	return *this;
+}
+
+// -----------------------------------------------------------------------------
+
+std::optional<SourceBuffer> SourceBuffer::open(const std::string& path, std::string* error)
+{
+	auto fail = [&] (const char* action) -> std::optional<SourceBuffer> {
+		auto message = fmt::format("Could not {} {}: {}", action, path, strerror(errno));
+		if (error)
+			*error = std::move(message);
+		else
+			Log::error("{}", message);
+		return std::nullopt;
+	};
+
+	int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+		return fail("open");
+
+	struct stat st;
+	if (fstat(fd, &st) < 0) {
+		auto failure = fail("stat");
+		close(fd);
+		return failure;
+	}
+
+	SourceBuffer buffer;
+
+	if (S_ISREG(st.st_mode) && st.st_size > 0) {
+		void* mapping = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (mapping != MAP_FAILED) {
+			madvise(mapping, st.st_size, MADV_SEQUENTIAL);
+			buffer.m_mapping = static_cast<const char*>(mapping);
+			buffer.m_mapping_size = st.st_size;
+			close(fd);
+			return buffer;
+		}
+	}
+
+	// Pipes, character devices, empty files or failed mappings are read instead
+	char chunk[64 * 1024];
+	while (true) {
+		ssize_t n = read(fd, chunk, sizeof(chunk));
+		if (n == 0)
+			break;
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			auto failure = fail("read");
+			close(fd);
+			return failure;
+		}
+		buffer.m_owned.append(chunk, n);
+	}
+
+	close(fd);
+	return buffer;
+}
+
+std::string_view SourceBuffer::view() const
+{
+	if (m_mapping)
+		return { m_mapping, m_mapping_size };
+	return m_owned;
+}
+
+void SourceBuffer::release()
+{
+	if (m_mapping)
+		munmap(const_cast<char*>(m_mapping), m_mapping_size);
+	m_mapping = nullptr;
+	m_mapping_size = 0;
+}
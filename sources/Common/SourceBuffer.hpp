@@ -0,0 +1,44 @@
+/*
+** Bax, 2021
+** Benoît Lormeau <blormeau@outlook.com>
+** Common / SourceBuffer.hpp
+*/
+
+#pragma once
+
+// -----------------------------------------------------------------------------
+
+#include <optional>
+#include <string>
+#include <string_view>
+
+// -----------------------------------------------------------------------------
+
+// Read-only source code, either memory-mapped from a file or owned in memory.
+// Views obtained through `view()` stay valid as long as the buffer lives.
+class SourceBuffer
+{
+	std::string m_owned;
+	const char* m_mapping = nullptr;
+	size_t m_mapping_size = 0;
+
+public:
+	SourceBuffer() = default;
+	explicit SourceBuffer(std::string owned);
+	SourceBuffer(const SourceBuffer&) = delete;
+	SourceBuffer(SourceBuffer&&);
+	~SourceBuffer();
+
+	SourceBuffer& operator=(const SourceBuffer&) = delete;
+	SourceBuffer& operator=(SourceBuffer&&);
+
+	// Maps `path` in memory, falling back to reading it for non-regular files.
+	// Failures are logged, or stored in `error` if given
+	static std::optional<SourceBuffer> open(const std::string& path, std::string* error = nullptr);
+
+	bool is_mapped() const { return m_mapping != nullptr; }
+	std::string_view view() const;
+
+private:
+	void release();
+};
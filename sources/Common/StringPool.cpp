@@ -0,0 +1,57 @@
+/*
+** Bax, 2021
+** Benoît Lormeau <blormeau@outlook.com>
+** Common / StringPool.cpp
+*/
+
+#include "Assertions.hpp"
+#include "StringPool.hpp"
+#include <algorithm>
+#include <cstring>
+
+// -----------------------------------------------------------------------------
+
+void StringPool::reserve(size_t bytes)
+{
+	if (bytes <= m_remaining)
+		return;
+
+	m_blocks.push_back(std::make_unique_for_overwrite<char[]>(bytes));
+	m_cursor = m_blocks.back().get();
+	m_remaining = bytes;
+}
+
+char* StringPool::prepare(size_t capacity)
+{
+	if (capacity > m_remaining)
+		reserve(std::max(capacity, default_block_size));
+	m_prepared = capacity;
+	return m_cursor;
+}
+
+std::string_view StringPool::commit(size_t length)
+{
+	ASSERT(length <= m_prepared);
+	std::string_view view(m_cursor, length);
+	m_cursor += length;
+	m_remaining -= length;
+	m_prepared = 0;
+	return view;
+}
+
+std::string_view StringPool::store(std::string_view string)
+{
+	if (string.empty())
+		return {};
+	char* data = prepare(string.length());
+	std::memcpy(data, string.data(), string.length());
+	return commit(string.length());
+}
+
+void StringPool::clear()
+{
+	m_blocks.clear();
+	m_cursor = nullptr;
+	m_remaining = 0;
+	m_prepared = 0;
+}
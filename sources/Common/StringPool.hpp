@@ -0,0 +1,48 @@
+/*
+** Bax, 2021
+** Benoît Lormeau <blormeau@outlook.com>
+** Common / StringPool.hpp
+*/
+
+#pragma once
+
+// -----------------------------------------------------------------------------
+
+#include <memory>
+#include <string_view>
+#include <vector>
+
+// -----------------------------------------------------------------------------
+
+// Append-only storage for strings that outlive their source, such as unescaped
+// literals. Bytes are never moved, views stay valid as long as the pool lives.
+class StringPool
+{
+	std::vector<std::unique_ptr<char[]>> m_blocks;
+	char* m_cursor = nullptr;
+	size_t m_remaining = 0;
+	size_t m_prepared = 0;
+
+public:
+	static constexpr size_t default_block_size = 64 * 1024;
+
+	StringPool() = default;
+	StringPool(const StringPool&) = delete;
+	StringPool(StringPool&&) = default;
+
+	StringPool& operator=(const StringPool&) = delete;
+	StringPool& operator=(StringPool&&) = default;
+
+	// Makes the next `bytes` bytes fit in a single allocation
+	void reserve(size_t bytes);
+
+	// Space for up to `capacity` bytes, closed by `commit`
+	char* prepare(size_t capacity);
+	// Keeps the first `length` bytes of the last prepared space
+	std::string_view commit(size_t length);
+
+	std::string_view store(std::string_view);
+
+	// Frees every block, the views handed out so far dangle
+	void clear();
+};
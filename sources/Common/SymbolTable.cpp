@@ -0,0 +1,83 @@
+/*
+** Bax, 2021
+** Benoît Lormeau <blormeau@outlook.com>
+** Common / SymbolTable.cpp
+*/
+
+#include "ConcurrentSymbolTable.hpp"
+#include "SymbolTable.hpp"
+
+// -----------------------------------------------------------------------------
+
+Symbol SymbolTable::intern(std::string_view name)
+{
+	// Kept at most half full, so that probes stay short
+	if ((m_symbols.size() + 1) * 2 > m_slots.size())
+		grow();
+
+	uint32_t h = hash(name);
+	size_t slot = probe(name, h);
+	if (m_slots[slot] != empty_slot)
+		return m_shared ? m_shared_symbols[m_slots[slot]] : m_slots[slot];
+
+	Symbol symbol = static_cast<Symbol>(m_symbols.size());
+	if (m_shared) {
+		// The shared table keeps the name
+		Symbol shared = m_shared->intern(name);
+		m_symbols.push_back(m_shared->name(shared));
+		m_shared_symbols.push_back(shared);
+	}
+	else
+		m_symbols.push_back(m_names.store(name));
+	m_hashes.push_back(h);
+	m_slots[slot] = symbol;
+	return m_shared ? m_shared_symbols.back() : symbol;
+}
+
+Symbol SymbolTable::find(std::string_view name) const
+{
+	if (m_shared)
+		return m_shared->find(name);
+	if (m_slots.empty())
+		return empty_slot;
+	return m_slots[probe(name, hash(name))];
+}
+
+std::string_view SymbolTable::name(Symbol symbol) const
+{
+	return m_shared ? m_shared->name(symbol) : m_symbols[symbol];
+}
+
+uint32_t SymbolTable::hash(std::string_view name)
+{
+	// FNV-1a, names are short
+	uint32_t h = 2166136261u;
+	for (unsigned char c : name)
+		h = (h ^ c) * 16777619u;
+	return h;
+}
+
+size_t SymbolTable::probe(std::string_view name, uint32_t h) const
+{
+	size_t mask = m_slots.size() - 1;
+	for (size_t slot = h & mask;; slot = (slot + 1) & mask) {
+		Symbol symbol = m_slots[slot];
+		if (symbol == empty_slot || (m_hashes[symbol] == h && m_symbols[symbol] == name))
+			return slot;
+	}
+}
+
+void SymbolTable::grow()
+{
+	// Slots are rebuilt from the kept hashes, names are not read again
+	size_t capacity = m_slots.empty() ? 256 : m_slots.size() * 2;
+	m_slots.assign(capacity, empty_slot);
+
+	size_t mask = capacity - 1;
+	for (Symbol symbol = 0; symbol < m_symbols.size(); ++symbol) {
+		size_t slot = m_hashes[symbol] & mask;
+		while (m_slots[slot] != empty_slot)
+			slot = (slot + 1) & mask;
+		m_slots[slot] = symbol;
+	}
+}
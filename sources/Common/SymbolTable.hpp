@@ -0,0 +1,69 @@
+/*
+** Bax, 2021
+** Benoît Lormeau <blormeau@outlook.com>
+** Common / SymbolTable.hpp
+*/
+
+#pragma once
+
+// -----------------------------------------------------------------------------
+
+#include "StringPool.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+// -----------------------------------------------------------------------------
+
+class ConcurrentSymbolTable;
+
+// Dense id of an interned name, equal ids mean equal names
+using Symbol = uint32_t;
+
+// Interns names, such as identifiers, so that each distinct one is stored once
+// and compared, hashed or ordered as a 32-bit id. Ids are given in order of
+// first appearance, names stay valid as long as the table lives.
+class SymbolTable
+{
+	StringPool m_names;
+	// Indexed by symbol
+	std::vector<std::string_view> m_symbols;
+	std::vector<uint32_t> m_hashes;
+	// Open addressing with linear probing, `empty_slot` or symbols
+	std::vector<Symbol> m_slots;
+	// In front of a shared table, the symbols it gave, indexed by local ones
+	ConcurrentSymbolTable* m_shared = nullptr;
+	std::vector<Symbol> m_shared_symbols;
+
+public:
+	static constexpr Symbol empty_slot = UINT32_MAX;
+
+	SymbolTable() = default;
+	// Interns into `shared`, whose symbols are returned. Names already seen by
+	// this table are found without reaching it, nor its locks.
+	explicit SymbolTable(ConcurrentSymbolTable& shared)
+	: m_shared(&shared)
+	{}
+	SymbolTable(const SymbolTable&) = delete;
+	SymbolTable(SymbolTable&&) = default;
+
+	SymbolTable& operator=(const SymbolTable&) = delete;
+	SymbolTable& operator=(SymbolTable&&) = default;
+
+	// The symbol of `name`, added if it is new
+	Symbol intern(std::string_view name);
+	// The symbol of `name`, or `empty_slot` if it was never interned
+	Symbol find(std::string_view name) const;
+
+	std::string_view name(Symbol symbol) const;
+	// Names interned through this table
+	size_t size() const { return m_symbols.size(); }
+
+	static uint32_t hash(std::string_view name);
+
+private:
+	// Slot of `name`, or the empty one where it would go
+	size_t probe(std::string_view name, uint32_t hash) const;
+	void grow();
+};
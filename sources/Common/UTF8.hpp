@@ -0,0 +1,45 @@
+/*
+** Bax, 2021
+** Benoît Lormeau <blormeau@outlook.com>
+** Common / UTF8.hpp
+*/
+
+#pragma once
+
+// -----------------------------------------------------------------------------
+
+#include <cstddef>
+#include <cstdint>
+
+// -----------------------------------------------------------------------------
+
+constexpr bool is_high_surrogate(uint32_t c) { return c >= 0xD800 && c <= 0xDBFF; }
+constexpr bool is_low_surrogate(uint32_t c) { return c >= 0xDC00 && c <= 0xDFFF; }
+
+// Writes `code_point` as UTF-8 to `out`, returns the number of bytes written.
+// Lone surrogates are replaced by U+FFFD
+inline size_t encode_utf8(uint32_t code_point, char* out)
+{
+	if (code_point < 0x80) {
+		out[0] = code_point;
+		return 1;
+	}
+	if (code_point < 0x800) {
+		out[0] = 0xC0 | (code_point >> 6);
+		out[1] = 0x80 | (code_point & 0x3F);
+		return 2;
+	}
+	if (is_high_surrogate(code_point) || is_low_surrogate(code_point))
+		code_point = 0xFFFD;
+	if (code_point < 0x10000) {
+		out[0] = 0xE0 | (code_point >> 12);
+		out[1] = 0x80 | ((code_point >> 6) & 0x3F);
+		out[2] = 0x80 | (code_point & 0x3F);
+		return 3;
+	}
+	out[0] = 0xF0 | (code_point >> 18);
+	out[1] = 0x80 | ((code_point >> 12) & 0x3F);
+	out[2] = 0x80 | ((code_point >> 6) & 0x3F);
+	out[3] = 0x80 | (code_point & 0x3F);
+	return 4;
+}
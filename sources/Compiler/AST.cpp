@@ -11,12 +11,14 @@
 namespace Bax::AST
 {
 
-void FunctionExpression::dump(int i) const
+const char* kind_name(Kind kind)
 {
-	Expression::dump(i);
-	for (auto &param : parameters)
-		param->dump(i + 1);
-	body->dump(i + 1);
+	switch (kind) {
+#define __ENUMERATE(T) case Kind::T: return #T;
+		__ENUMERATE_AST_NODES
+#undef __ENUMERATE
+	}
+	return "Node";
 }
 
 }
@@ -0,0 +1,283 @@
+/*
+** Bax, 2021
+** Benoit Lormeau <blormeau@outlook.com>
+** ASTWriter.cpp
+*/
+
+#include "Bax/Compiler/ASTWriter.hpp"
+#include "Bax/Compiler/FlatAST.hpp"
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <iterator>
+#include <vector>
+
+// -----------------------------------------------------------------------------
+
+namespace Bax
+{
+
+std::unique_ptr<ASTWriter> ASTWriter::make(std::string_view format)
+{
+	if (format == "text")
+		return std::make_unique<TextASTWriter>();
+	if (format == "json")
+		return std::make_unique<JsonASTWriter>();
+	if (format == "binary")
+		return std::make_unique<BinaryASTWriter>();
+	return nullptr;
+}
+
+void ASTWriter::write(Ptr<const AST::Node> root)
+{
+	using namespace AST;
+
+	// Nodes to open, nodes to close once their children are done, and missing
+	// children, which have no node but a parent
+	struct Step
+	{
+		const Node* node;
+		const Node* parent;
+		size_t depth;
+		bool close;
+	};
+	std::vector<Step> steps = { { root, nullptr, 0, false } };
+
+	while (!steps.empty()) {
+		Step step = steps.back();
+		steps.pop_back();
+
+		if (!step.node) {
+			missing(*step.parent, step.depth);
+			continue;
+		}
+		if (step.close) {
+			close(*step.node, step.depth);
+			continue;
+		}
+
+		open(*step.node, step.depth);
+		steps.push_back({ step.node, step.parent, step.depth, true });
+
+		// Pushed in order, then reversed so that they are popped in order.
+		// Values of objects are indented under their key.
+		size_t first = steps.size();
+		bool is_object = step.node->kind == Kind::ObjectExpression;
+		for_each_child(*step.node, [&] (Ptr<const Node> child) {
+			bool is_value = is_object && (steps.size() - first) % 2 == 1;
+			steps.push_back({ child, step.node, step.depth + (is_value ? 2 : 1), false });
+		});
+		std::reverse(steps.begin() + first, steps.end());
+	}
+
+	end();
+}
+
+bool ASTWriter::flush(FILE* file)
+{
+	bool ok = std::fwrite(m_buffer.data(), 1, m_buffer.size(), file) == m_buffer.size();
+	m_buffer.clear();
+	return std::fflush(file) == 0 && ok;
+}
+
+// -----------------------------------------------------------------------------
+
+void TextASTWriter::open(const AST::Node& node, size_t depth)
+{
+	using namespace AST;
+
+	m_buffer.append(2 * depth, ' ');
+	auto out = std::back_inserter(m_buffer);
+	visit(node, [&] <typename T> (const T& n) {
+		if constexpr (std::is_same_v<T, Identifier>)
+			fmt::format_to(out, "{}({})\n", n.class_name(), n.name);
+		else if constexpr (std::is_same_v<T, AssignmentExpression> || std::is_same_v<T, BinaryExpression>
+		                || std::is_same_v<T, MemberExpression> || std::is_same_v<T, UnaryExpression>)
+			fmt::format_to(out, "{}({})\n", n.class_name(), (int)n.op);
+		else if constexpr (std::is_same_v<T, UpdateExpression>)
+			fmt::format_to(out, "{}{}({})\n", n.is_prefix_update ? "Pre" : "Post", n.class_name(), (int)n.op);
+		else if constexpr (std::is_same_v<T, Boolean>)
+			fmt::format_to(out, "{}({})\n", n.class_name(), n.value);
+		else if constexpr (std::is_same_v<T, Glyph>)
+			fmt::format_to(out, "{}({:c}|{:d})\n", n.class_name(), n.value, n.value);
+		else if constexpr (std::is_same_v<T, Number>)
+			fmt::format_to(out, "{}({:g})\n", n.class_name(), n.value);
+		else if constexpr (std::is_same_v<T, String>)
+			fmt::format_to(out, "{}({:s})\n", n.class_name(), n.value);
+		else if constexpr (std::is_same_v<T, VariableDeclaration>)
+			fmt::format_to(out, "{}({}, {})\n", n.class_name(), n.is_constant ? "const" : "let", n.is_static ? "static" : "scoped");
+		else {
+			m_buffer += n.class_name();
+			m_buffer += '\n';
+		}
+	});
+}
+
+void TextASTWriter::missing(const AST::Node& parent, size_t depth)
+{
+	// Missing else branches are not shown
+	if (parent.kind == AST::Kind::MatchExpression) {
+		m_buffer.append(2 * depth, ' ');
+		m_buffer += "default\n";
+	}
+	else if (parent.kind == AST::Kind::SubscriptExpression) {
+		m_buffer.append(2 * depth, ' ');
+		m_buffer += "(empty subscript)\n";
+	}
+}
+
+// -----------------------------------------------------------------------------
+
+void JsonASTWriter::open(const AST::Node& node, size_t)
+{
+	using namespace AST;
+
+	if (!m_first)
+		m_buffer += ',';
+	m_buffer += "{\"kind\":\"";
+	m_buffer += node.class_name();
+	m_buffer += '"';
+
+	auto out = std::back_inserter(m_buffer);
+	visit(node, [&] <typename T> (const T& n) {
+		if constexpr (std::is_same_v<T, Identifier>) {
+			m_buffer += ",\"name\":";
+			write_string(n.name);
+		}
+		else if constexpr (std::is_same_v<T, AssignmentExpression> || std::is_same_v<T, BinaryExpression>
+		                || std::is_same_v<T, MemberExpression> || std::is_same_v<T, UnaryExpression>)
+			fmt::format_to(out, ",\"operator\":{}", (int)n.op);
+		else if constexpr (std::is_same_v<T, UpdateExpression>)
+			fmt::format_to(out, ",\"operator\":{},\"prefix\":{}", (int)n.op, n.is_prefix_update);
+		else if constexpr (std::is_same_v<T, Boolean> || std::is_same_v<T, Glyph>)
+			fmt::format_to(out, ",\"value\":{}", n.value);
+		else if constexpr (std::is_same_v<T, Number>) {
+			// Out of range literals are infinite, which JSON cannot represent
+			if (std::isfinite(n.value))
+				fmt::format_to(out, ",\"value\":{}", n.value);
+			else
+				m_buffer += ",\"value\":null";
+		}
+		else if constexpr (std::is_same_v<T, String>) {
+			m_buffer += ",\"value\":";
+			write_string(n.value);
+		}
+		else if constexpr (std::is_same_v<T, MatchExpression>) {
+			m_buffer += ",\"cases\":[";
+			for (size_t i = 0; i < n.cases.size(); ++i)
+				fmt::format_to(out, "{}{}", i ? "," : "", n.cases[i].first.size());
+			m_buffer += ']';
+		}
+		else if constexpr (std::is_same_v<T, VariableDeclaration>)
+			fmt::format_to(out, ",\"constant\":{},\"static\":{}", n.is_constant, n.is_static);
+	});
+
+	m_buffer += ",\"children\":[";
+	m_first = true;
+}
+
+void JsonASTWriter::close(const AST::Node&, size_t)
+{
+	m_buffer += "]}";
+	m_first = false;
+}
+
+void JsonASTWriter::missing(const AST::Node&, size_t)
+{
+	m_buffer += m_first ? "null" : ",null";
+	m_first = false;
+}
+
+void JsonASTWriter::end()
+{
+	m_buffer += '\n';
+	m_first = true;
+}
+
+void JsonASTWriter::write_string(std::string_view string)
+{
+	m_buffer += '"';
+	for (char c : string) {
+		switch (c) {
+			case '"':  m_buffer += "\\\""; break;
+			case '\\': m_buffer += "\\\\"; break;
+			case '\b': m_buffer += "\\b"; break;
+			case '\f': m_buffer += "\\f"; break;
+			case '\n': m_buffer += "\\n"; break;
+			case '\r': m_buffer += "\\r"; break;
+			case '\t': m_buffer += "\\t"; break;
+			default:
+				if (static_cast<unsigned char>(c) < 0x20)
+					fmt::format_to(std::back_inserter(m_buffer), "\\u{:04x}", static_cast<unsigned char>(c));
+				else
+					m_buffer += c;
+				break;
+		}
+	}
+	m_buffer += '"';
+}
+
+// -----------------------------------------------------------------------------
+
+void BinaryASTWriter::open(const AST::Node& node, size_t)
+{
+	using namespace AST;
+
+	write_byte(static_cast<uint8_t>(node.kind));
+	visit(node, [&] <typename T> (const T& n) {
+		if constexpr (std::is_same_v<T, Identifier>)
+			write_string(n.name);
+		else if constexpr (std::is_same_v<T, String>)
+			write_string(n.value);
+		else if constexpr (std::is_same_v<T, Number>) {
+			auto bits = std::bit_cast<uint64_t>(n.value);
+			for (size_t i = 0; i < 8; ++i)
+				write_byte(static_cast<uint8_t>(bits >> (8 * i)));
+		}
+		else if constexpr (std::is_same_v<T, Glyph>)
+			write_varint(n.value);
+		else if constexpr (std::is_same_v<T, Boolean>)
+			write_byte(n.value);
+		else if constexpr (std::is_same_v<T, AssignmentExpression> || std::is_same_v<T, BinaryExpression>
+		                || std::is_same_v<T, MemberExpression> || std::is_same_v<T, UnaryExpression>)
+			write_byte(static_cast<uint8_t>(n.op));
+		else if constexpr (std::is_same_v<T, UpdateExpression>) {
+			write_byte(static_cast<uint8_t>(n.op));
+			write_byte(n.is_prefix_update);
+		}
+		else if constexpr (std::is_same_v<T, VariableDeclaration>)
+			write_byte((n.is_constant ? FlatAST::Constant : 0) | (n.is_static ? FlatAST::Static : 0));
+		else if constexpr (std::is_same_v<T, ArrayExpression>) write_varint(n.elements.size());
+		else if constexpr (std::is_same_v<T, BlockStatement>) write_varint(n.statements.size());
+		else if constexpr (std::is_same_v<T, CallExpression>) write_varint(n.arguments.size());
+		else if constexpr (std::is_same_v<T, FunctionExpression>) write_varint(n.parameters.size());
+		else if constexpr (std::is_same_v<T, ObjectExpression>) write_varint(n.members.size());
+		else if constexpr (std::is_same_v<T, MatchExpression>) {
+			write_varint(n.cases.size());
+			for (auto& [patterns, value] : n.cases)
+				write_varint(patterns.size());
+		}
+	});
+}
+
+void BinaryASTWriter::missing(const AST::Node&, size_t)
+{
+	write_byte(missing_node);
+}
+
+void BinaryASTWriter::write_varint(uint64_t value)
+{
+	while (value >= 0x80) {
+		write_byte(static_cast<uint8_t>(value) | 0x80);
+		value >>= 7;
+	}
+	write_byte(static_cast<uint8_t>(value));
+}
+
+void BinaryASTWriter::write_string(std::string_view string)
+{
+	write_varint(string.size());
+	m_buffer += string;
+}
+
+}
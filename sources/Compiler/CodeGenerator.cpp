@@ -0,0 +1,1108 @@
+/*
+** Bax, 2021
+** Benoit Lormeau <blormeau@outlook.com>
+** CodeGenerator.cpp
+*/
+
+#include "Bax/Compiler/CodeGenerator.hpp"
+#include "Common/Nesting.hpp"
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <optional>
+
+// -----------------------------------------------------------------------------
+
+namespace Bax
+{
+
+namespace
+{
+
+using BinaryOperators = AST::BinaryExpression::Operators;
+using AssignmentOperators = AST::AssignmentExpression::Operators;
+
+bool is_logical(BinaryOperators op)
+{
+	return op == BinaryOperators::BooleanAnd || op == BinaryOperators::BooleanOr
+	    || op == BinaryOperators::Coalesce || op == BinaryOperators::Ternary;
+}
+
+// Instruction of a non-logical binary operator, and whether its operands are
+// swapped: `a > b` is `b < a`
+std::pair<Opcode, bool> binary_opcode(BinaryOperators op)
+{
+	switch (op) {
+		case BinaryOperators::Add:                 return { Opcode::Add, false };
+		case BinaryOperators::BitwiseAnd:          return { Opcode::BitwiseAnd, false };
+		case BinaryOperators::BitwiseLeftShift:    return { Opcode::LeftShift, false };
+		case BinaryOperators::BitwiseOr:           return { Opcode::BitwiseOr, false };
+		case BinaryOperators::BitwiseRightShift:   return { Opcode::RightShift, false };
+		case BinaryOperators::BitwiseXor:          return { Opcode::BitwiseXor, false };
+		case BinaryOperators::Divide:              return { Opcode::Divide, false };
+		case BinaryOperators::Equals:              return { Opcode::Equal, false };
+		case BinaryOperators::GreaterThan:         return { Opcode::Less, true };
+		case BinaryOperators::GreaterThanOrEquals: return { Opcode::LessEqual, true };
+		case BinaryOperators::Inequals:            return { Opcode::NotEqual, false };
+		case BinaryOperators::LessThan:            return { Opcode::Less, false };
+		case BinaryOperators::LessThanOrEquals:    return { Opcode::LessEqual, false };
+		case BinaryOperators::Modulo:              return { Opcode::Modulo, false };
+		case BinaryOperators::Multiply:            return { Opcode::Multiply, false };
+		case BinaryOperators::Power:               return { Opcode::Power, false };
+		case BinaryOperators::Substract:           return { Opcode::Substract, false };
+		default:                                   return { Opcode::Move, false };
+	}
+}
+
+// Instruction of the arithmetic part of a compound assignment, `Move` for the
+// logical ones
+Opcode assignment_opcode(AssignmentOperators op)
+{
+	switch (op) {
+		case AssignmentOperators::Add:               return Opcode::Add;
+		case AssignmentOperators::BitwiseAnd:        return Opcode::BitwiseAnd;
+		case AssignmentOperators::BitwiseLeftShift:  return Opcode::LeftShift;
+		case AssignmentOperators::BitwiseOr:         return Opcode::BitwiseOr;
+		case AssignmentOperators::BitwiseRightShift: return Opcode::RightShift;
+		case AssignmentOperators::BitwiseXor:        return Opcode::BitwiseXor;
+		case AssignmentOperators::Divide:            return Opcode::Divide;
+		case AssignmentOperators::Modulo:            return Opcode::Modulo;
+		case AssignmentOperators::Multiply:          return Opcode::Multiply;
+		case AssignmentOperators::Power:             return Opcode::Power;
+		case AssignmentOperators::Substract:         return Opcode::Substract;
+		default:                                     return Opcode::Move;
+	}
+}
+
+// The opcode computing `op` with an immediate right operand, for `x + 1` or
+// `x - 1`, if any
+std::optional<Opcode> immediate_opcode(Opcode op)
+{
+	switch (op) {
+		case Opcode::Add:       return Opcode::AddInt;
+		case Opcode::Substract: return Opcode::SubstractInt;
+		default:                return std::nullopt;
+	}
+}
+
+// `expr` as the immediate of `AddInt` or `SubstractInt`
+std::optional<int8_t> small_integer(Ptr<const AST::Expression> expr)
+{
+	auto number = AST::as<AST::Number>(expr);
+	if (!number)
+		return std::nullopt;
+	double value = number->value;
+	if (value != std::trunc(value) || value < INT8_MIN || value > INT8_MAX)
+		return std::nullopt;
+	return static_cast<int8_t>(value);
+}
+
+// Whether evaluating `expr` into a register only writes it once, after reading
+// everything else: `x = x + 1` can then be evaluated into `x` itself
+bool writes_once(Ptr<const AST::Expression> expr)
+{
+	switch (expr->kind) {
+		case AST::Kind::BinaryExpression:
+			return !is_logical(static_cast<const AST::BinaryExpression*>(expr)->op);
+		case AST::Kind::Identifier:
+		case AST::Kind::CallExpression:
+		case AST::Kind::FunctionExpression:
+		case AST::Kind::MemberExpression:
+		case AST::Kind::SubscriptExpression:
+		case AST::Kind::UnaryExpression:
+		case AST::Kind::Null:
+		case AST::Kind::Boolean:
+		case AST::Kind::Glyph:
+		case AST::Kind::Number:
+		case AST::Kind::String:
+			return true;
+		default:
+			return false;
+	}
+}
+
+}
+
+// -----------------------------------------------------------------------------
+
+CodeGenerator::CodeGenerator()
+{}
+
+CodeGenerator::~CodeGenerator()
+{}
+
+std::unique_ptr<Program> CodeGenerator::run(Ptr<const AST::Node> root)
+{
+	m_program = std::make_unique<Program>();
+	m_globals.clear();
+	m_strings.clear();
+	m_depth = 0;
+	m_diagnostics.clear();
+
+	auto main = std::make_unique<Function>();
+	main->name = "main";
+	FunctionState state { main.get(), nullptr };
+	m_function = &state;
+
+	// Parsers only ever return statements
+	statement(static_cast<Ptr<const AST::Statement>>(root));
+	emit(Instruction::abc(Opcode::ReturnNull, 0));
+
+	m_function = nullptr;
+	m_program->main = std::move(main);
+	if (!m_diagnostics.empty())
+		return nullptr;
+	return std::move(m_program);
+}
+
+void CodeGenerator::report(std::string message)
+{
+	m_diagnostics.push_back({ 0, std::move(message), {} });
+}
+
+bool CodeGenerator::check_depth()
+{
+	if (m_depth <= m_max_depth)
+		return true;
+	// Reported once, by the deepest node
+	if (m_depth == m_max_depth + 1)
+		error("Code nested deeper than {} levels", m_max_depth);
+	return false;
+}
+
+// -----------------------------------------------------------------------------
+
+void CodeGenerator::function(Function& function, const AST::FunctionExpression& node)
+{
+	FunctionState state { &function, m_function };
+	m_function = &state;
+	begin_scope();
+
+	// Parameters are the first registers, `name = value` gives them a default
+	std::vector<std::pair<Register, Ptr<const AST::Expression>>> defaults;
+	for (auto& parameter : node.parameters) {
+		auto name = AST::as<AST::Identifier>(parameter);
+		Ptr<const AST::Expression> value = nullptr;
+		if (auto assignment = AST::as<AST::AssignmentExpression>(parameter); assignment && assignment->op == AssignmentOperators::Assign) {
+			name = AST::as<AST::Identifier>(assignment->lhs);
+			value = assignment->rhs;
+		}
+		if (!name) {
+			error("Parameters of '{}' must be identifiers, with an optional default value", function.name);
+			continue;
+		}
+		Register r = allocate();
+		declare(*name, false, false, r);
+		if (value)
+			defaults.emplace_back(r, value);
+	}
+	function.parameter_count = static_cast<uint8_t>(state.top);
+
+	for (auto [r, value] : defaults) {
+		emit(Instruction::abc(Opcode::TestNull, 0, r));
+		size_t skip = emit_jump();
+		expression(value, r);
+		free_to(state.locals_top);
+		patch_here(skip);
+	}
+
+	block(*node.body);
+	emit(Instruction::abc(Opcode::ReturnNull, 0));
+
+	m_function = state.enclosing;
+}
+
+// -----------------------------------------------------------------------------
+
+void CodeGenerator::statement(Ptr<const AST::Statement> node)
+{
+	Nesting nesting(m_depth);
+	if (!check_depth())
+		return;
+
+	using namespace AST;
+	visit(static_cast<const Node&>(*node), [&] <typename T> (const T& n) {
+		if constexpr (std::is_same_v<T, BlockStatement>)
+			block(n);
+		else if constexpr (std::is_same_v<T, ExpressionStatement>)
+			effect(n.expression);
+		else if constexpr (std::is_same_v<T, IfStatement>)
+			if_statement(n);
+		else if constexpr (std::is_same_v<T, ReturnStatement>)
+			emit(Instruction::abc(Opcode::Return, expression(n.value)));
+		else if constexpr (std::is_same_v<T, WhileStatement>)
+			while_statement(n);
+		else if constexpr (std::is_same_v<T, VariableDeclaration>)
+			declaration(n);
+		else
+			error("Expected a statement, found {}", n.class_name());
+	});
+
+	// Temporaries do not outlive their statement
+	free_to(m_function->locals_top);
+}
+
+void CodeGenerator::block(const AST::BlockStatement& node)
+{
+	begin_scope();
+	for (auto& statement : node.statements)
+		this->statement(statement);
+	end_scope();
+}
+
+void CodeGenerator::declaration(const AST::VariableDeclaration& node)
+{
+	auto& name = *node.name;
+
+	// Initialized the first time they are reached only
+	if (node.is_static) {
+		uint32_t index = m_program->static_count++;
+		if (index > UINT16_MAX)
+			error("Too many static variables, at '{}'", name.name);
+		emit(Instruction::abx(Opcode::IfStatic, 0, index));
+		size_t skip = emit_jump();
+		emit(Instruction::abx(Opcode::SetStatic, expression(node.value), index));
+		patch_here(skip);
+		declare(name, true, node.is_constant, index);
+		return;
+	}
+
+	// Functions can refer to themselves
+	Register r = allocate();
+	bool is_function = AST::is<AST::FunctionExpression>(node.value);
+	if (is_function)
+		declare(name, false, node.is_constant, r);
+
+	if (auto function = AST::as<AST::FunctionExpression>(node.value))
+		closure(*function, name.name, r);
+	else
+		expression(node.value, r);
+
+	if (!is_function)
+		declare(name, false, node.is_constant, r);
+}
+
+void CodeGenerator::if_statement(const AST::IfStatement& node)
+{
+	auto skip_consequent = jump_if(node.condition, false);
+	statement(node.consequent);
+	if (!node.alternate) {
+		patch_here(skip_consequent);
+		return;
+	}
+
+	size_t skip_alternate = emit_jump();
+	patch_here(skip_consequent);
+	statement(node.alternate);
+	patch_here(skip_alternate);
+}
+
+void CodeGenerator::while_statement(const AST::WhileStatement& node)
+{
+	// The condition is tested at the bottom, so that each iteration only runs
+	// one test and its jump
+	size_t to_condition = emit_jump();
+	size_t body = m_function->function->code.size();
+	statement(node.body);
+	patch_here(to_condition);
+	for (size_t jump : jump_if(node.condition, true))
+		patch(jump, body);
+}
+
+// -----------------------------------------------------------------------------
+
+CodeGenerator::Register CodeGenerator::expression(Ptr<const AST::Expression> expr, int target)
+{
+	Nesting nesting(m_depth);
+	if (!check_depth())
+		return destination(target);
+
+	using namespace AST;
+	return visit(static_cast<const Node&>(*expr), [&] <typename T> (const T& n) -> Register {
+		if constexpr (std::is_same_v<T, Identifier>) {
+			auto variable = resolve(n);
+			// Read in place
+			if (variable.kind == Variable::Kind::Register && target == any_register)
+				return variable.index;
+			Register d = destination(target);
+			read(variable, d);
+			return d;
+		}
+		else if constexpr (std::is_same_v<T, Null>) {
+			Register d = destination(target);
+			emit(Instruction::abc(Opcode::LoadNull, d));
+			return d;
+		}
+		else if constexpr (std::is_same_v<T, Boolean>) {
+			Register d = destination(target);
+			emit(Instruction::abc(Opcode::LoadBool, d, n.value));
+			return d;
+		}
+		else if constexpr (std::is_same_v<T, Glyph>)
+			return literal(Value::from_glyph(n.value), target);
+		else if constexpr (std::is_same_v<T, Number>)
+			return literal(Value::from_number(n.value), target);
+		else if constexpr (std::is_same_v<T, AST::String>) {
+			Register d = destination(target);
+			emit(Instruction::abx(Opcode::LoadConstant, d, string_constant(n.value)));
+			return d;
+		}
+		else if constexpr (std::is_same_v<T, ArrayExpression>) {
+			Register d = destination(target);
+			size_t top = m_function->top;
+			emit(Instruction::abx(Opcode::NewArray, d, std::min<size_t>(n.elements.size(), UINT16_MAX)));
+			for (auto& element : n.elements) {
+				emit(Instruction::abc(Opcode::Push, d, expression(element)));
+				free_to(top);
+			}
+			return d;
+		}
+		else if constexpr (std::is_same_v<T, ObjectExpression>) {
+			Register d = destination(target);
+			size_t top = m_function->top;
+			emit(Instruction::abx(Opcode::NewTable, d, std::min<size_t>(n.members.size(), UINT16_MAX)));
+			for (auto& [key, value] : n.members) {
+				Register r = expression(value);
+				emit(Instruction::abc(Opcode::SetField, d, name_constant(key->name), r));
+				free_to(top);
+			}
+			return d;
+		}
+		else if constexpr (std::is_same_v<T, FunctionExpression>)
+			return closure(n, "function", target);
+		else if constexpr (std::is_same_v<T, AssignmentExpression>)
+			return assignment(n, target);
+		else if constexpr (std::is_same_v<T, BinaryExpression>)
+			return is_logical(n.op) ? logical(n, target) : arithmetic(n, target);
+		else if constexpr (std::is_same_v<T, CallExpression>)
+			return call(n, target);
+		else if constexpr (std::is_same_v<T, MatchExpression>)
+			return match(n, target);
+		else if constexpr (std::is_same_v<T, MemberExpression>)
+			return member(n, target);
+		else if constexpr (std::is_same_v<T, SubscriptExpression>) {
+			if (!n.rhs) {
+				error("Empty subscripts can only be assigned to");
+				return destination(target);
+			}
+			size_t top = m_function->top;
+			Register object = expression(n.lhs);
+			Register key = expression(n.rhs);
+			free_to(top);
+			Register d = destination(target);
+			emit(Instruction::abc(Opcode::GetIndex, d, object, key));
+			return d;
+		}
+		else if constexpr (std::is_same_v<T, TernaryExpression>) {
+			Register d = destination(target);
+			size_t top = m_function->top;
+			auto skip_consequent = jump_if(n.condition, false);
+			expression(n.consequent, d);
+			free_to(top);
+			size_t skip_alternate = emit_jump();
+			patch_here(skip_consequent);
+			expression(n.alternate, d);
+			free_to(top);
+			patch_here(skip_alternate);
+			return d;
+		}
+		else if constexpr (std::is_same_v<T, UnaryExpression>) {
+			using Operators = UnaryExpression::Operators;
+			if (auto number = as<Number>(n.rhs); number && n.op == Operators::Negative)
+				return literal(Value::from_number(-number->value), target);
+
+			size_t top = m_function->top;
+			Register r = expression(n.rhs);
+			free_to(top);
+			Register d = destination(target);
+			switch (n.op) {
+				case Operators::BitwiseNot: emit(Instruction::abc(Opcode::BitwiseNot, d, r)); break;
+				case Operators::BooleanNot: emit(Instruction::abc(Opcode::Not, d, r)); break;
+				case Operators::Negative:   emit(Instruction::abc(Opcode::Negate, d, r)); break;
+				case Operators::Positive:   emit(Instruction::abc(Opcode::Positive, d, r)); break;
+			}
+			return d;
+		}
+		else if constexpr (std::is_same_v<T, UpdateExpression>)
+			return update(n, target, false);
+		else {
+			error("Expected an expression, found {}", n.class_name());
+			return destination(target);
+		}
+	});
+}
+
+void CodeGenerator::effect(Ptr<const AST::Expression> expr)
+{
+	// `i++;` does not need the previous value of `i`
+	if (auto update = AST::as<AST::UpdateExpression>(expr))
+		this->update(*update, any_register, true);
+	else
+		expression(expr);
+}
+
+std::vector<size_t> CodeGenerator::jump_if(Ptr<const AST::Expression> expr, bool when)
+{
+	Nesting nesting(m_depth);
+	if (!check_depth())
+		return {};
+
+	if (auto binary = AST::as<AST::BinaryExpression>(expr)) {
+		switch (binary->op) {
+			case BinaryOperators::BooleanAnd:
+			case BinaryOperators::BooleanOr: {
+				// Jumps out as soon as the result is known
+				bool is_and = binary->op == BinaryOperators::BooleanAnd;
+				if (is_and != when) {
+					auto jumps = jump_if(binary->lhs, when);
+					auto more = jump_if(binary->rhs, when);
+					jumps.insert(jumps.end(), more.begin(), more.end());
+					return jumps;
+				}
+				auto skip = jump_if(binary->lhs, !when);
+				auto jumps = jump_if(binary->rhs, when);
+				patch_here(skip);
+				return jumps;
+			}
+
+			case BinaryOperators::Equals:
+			case BinaryOperators::Inequals:
+			case BinaryOperators::LessThan:
+			case BinaryOperators::LessThanOrEquals:
+			case BinaryOperators::GreaterThan:
+			case BinaryOperators::GreaterThanOrEquals: {
+				size_t top = m_function->top;
+				Register l = expression(binary->lhs);
+				Register r = expression(binary->rhs);
+				free_to(top);
+
+				auto [op, swap] = binary_opcode(binary->op);
+				bool flag = when;
+				if (op == Opcode::Equal || op == Opcode::NotEqual) {
+					flag = (op == Opcode::Equal) == when;
+					op = Opcode::TestEqual;
+				}
+				else
+					op = op == Opcode::Less ? Opcode::TestLess : Opcode::TestLessEqual;
+				if (swap)
+					std::swap(l, r);
+				emit(Instruction::abc(op, flag, l, r));
+				return { emit_jump() };
+			}
+
+			default:
+				break;
+		}
+	}
+	else if (auto unary = AST::as<AST::UnaryExpression>(expr); unary && unary->op == AST::UnaryExpression::Operators::BooleanNot)
+		return jump_if(unary->rhs, !when);
+	else if (auto boolean = AST::as<AST::Boolean>(expr)) {
+		if (boolean->value != when)
+			return {};
+		return { emit_jump() };
+	}
+
+	size_t top = m_function->top;
+	Register r = expression(expr);
+	free_to(top);
+	emit(Instruction::abc(Opcode::Test, when, r));
+	return { emit_jump() };
+}
+
+// -----------------------------------------------------------------------------
+
+CodeGenerator::Register CodeGenerator::arithmetic(const AST::BinaryExpression& node, int target)
+{
+	// Left-associative chains are as deep as they are long, their left spine is
+	// walked without recursion
+	std::vector<const AST::BinaryExpression*> spine = { &node };
+	Ptr<const AST::Expression> left = node.lhs;
+	while (auto binary = AST::as<AST::BinaryExpression>(left)) {
+		if (is_logical(binary->op))
+			break;
+		spine.push_back(binary);
+		left = binary->lhs;
+	}
+
+	size_t top = m_function->top;
+	Register accumulator = expression(left);
+	for (size_t i = spine.size(); i-- > 0;) {
+		auto& binary = *spine[i];
+		auto [op, swap] = binary_opcode(binary.op);
+
+		auto immediate_op = immediate_opcode(op);
+		std::optional<int8_t> immediate;
+		if (immediate_op)
+			immediate = small_integer(binary.rhs);
+		Register r = immediate ? 0 : expression(binary.rhs);
+
+		// Operands are read before the result is written, their registers can
+		// be reused
+		free_to(top);
+		Register d = i == 0 ? destination(target) : allocate();
+		if (immediate)
+			emit(Instruction::abc(*immediate_op, d, accumulator, static_cast<uint8_t>(*immediate)));
+		else if (swap)
+			emit(Instruction::abc(op, d, r, accumulator));
+		else
+			emit(Instruction::abc(op, d, accumulator, r));
+		accumulator = d;
+	}
+	return accumulator;
+}
+
+CodeGenerator::Register CodeGenerator::logical(const AST::BinaryExpression& node, int target)
+{
+	// The result is the last operand evaluated, as in `a && b`, `a || b`,
+	// `a ?: b` and `a ?? b`
+	Register d = destination(target);
+	size_t top = m_function->top;
+	expression(node.lhs, d);
+	free_to(top);
+
+	switch (node.op) {
+		case BinaryOperators::BooleanAnd: emit(Instruction::abc(Opcode::Test, 0, d)); break;
+		case BinaryOperators::Coalesce:   emit(Instruction::abc(Opcode::TestNull, 0, d)); break;
+		default:                          emit(Instruction::abc(Opcode::Test, 1, d)); break;
+	}
+	size_t skip = emit_jump();
+	expression(node.rhs, d);
+	free_to(top);
+	patch_here(skip);
+	return d;
+}
+
+CodeGenerator::Register CodeGenerator::assignment(const AST::AssignmentExpression& node, int target)
+{
+	auto op = assignment_opcode(node.op);
+	bool is_logical = node.op == AssignmentOperators::BooleanAnd || node.op == AssignmentOperators::BooleanOr
+	               || node.op == AssignmentOperators::Coalesce;
+
+	// Reads the current value of the target in `current`, then writes `value`
+	// back with `store`. Logical assignments only evaluate the value when the
+	// current one is not enough.
+	auto assign = [&] (Register current, auto&& store) -> Register {
+		if (node.op == AssignmentOperators::Assign) {
+			Register r = expression(node.rhs);
+			store(r);
+			return r;
+		}
+		if (is_logical) {
+			switch (node.op) {
+				case AssignmentOperators::BooleanAnd: emit(Instruction::abc(Opcode::Test, 0, current)); break;
+				case AssignmentOperators::Coalesce:   emit(Instruction::abc(Opcode::TestNull, 0, current)); break;
+				default:                              emit(Instruction::abc(Opcode::Test, 1, current)); break;
+			}
+			size_t skip = emit_jump();
+			Register r = expression(node.rhs);
+			emit(Instruction::abc(Opcode::Move, current, r));
+			store(current);
+			patch_here(skip);
+			return current;
+		}
+		auto immediate_op = immediate_opcode(op);
+		if (auto immediate = immediate_op ? small_integer(node.rhs) : std::nullopt)
+			emit(Instruction::abc(*immediate_op, current, current, static_cast<uint8_t>(*immediate)));
+		else
+			emit(Instruction::abc(op, current, current, expression(node.rhs)));
+		store(current);
+		return current;
+	};
+
+	auto result = [&] (Register r) -> Register {
+		if (target == any_register || target == r)
+			return r;
+		emit(Instruction::abc(Opcode::Move, target, r));
+		return target;
+	};
+
+	if (auto identifier = AST::as<AST::Identifier>(node.lhs)) {
+		auto variable = resolve(*identifier);
+		if (variable.kind == Variable::Kind::Global) {
+			error("Cannot assign to '{}', which is not declared", identifier->name);
+			return destination(target);
+		}
+		if (variable.is_constant)
+			error("Cannot assign to constant '{}'", identifier->name);
+
+		if (variable.kind == Variable::Kind::Register) {
+			Register r = variable.index;
+			// Evaluated in place when that is safe
+			if (node.op == AssignmentOperators::Assign && writes_once(node.rhs))
+				expression(node.rhs, r);
+			else if (node.op == AssignmentOperators::Assign)
+				emit(Instruction::abc(Opcode::Move, r, expression(node.rhs)));
+			else
+				assign(r, [] (Register) {});
+			return result(r);
+		}
+
+		Register current = allocate();
+		if (node.op != AssignmentOperators::Assign)
+			read(variable, current);
+		return result(assign(current, [&] (Register r) { write(variable, r); }));
+	}
+
+	if (auto member = AST::as<AST::MemberExpression>(node.lhs)) {
+		if (member->op != AST::MemberExpression::Operators::Member) {
+			error("Only '.' member expressions can be assigned to");
+			return destination(target);
+		}
+		Register object = expression(member->lhs);
+		uint8_t name = name_constant(AST::as<AST::Identifier>(member->rhs)->name);
+		Register current = allocate();
+		if (node.op != AssignmentOperators::Assign)
+			emit(Instruction::abc(Opcode::GetField, current, object, name));
+		return result(assign(current, [&] (Register r) { emit(Instruction::abc(Opcode::SetField, object, name, r)); }));
+	}
+
+	if (auto subscript = AST::as<AST::SubscriptExpression>(node.lhs)) {
+		Register object = expression(subscript->lhs);
+		// `array[] = value` appends to it
+		if (!subscript->rhs) {
+			if (node.op != AssignmentOperators::Assign) {
+				error("Empty subscripts can only be assigned to with '='");
+				return destination(target);
+			}
+			Register r = expression(node.rhs);
+			emit(Instruction::abc(Opcode::Push, object, r));
+			return result(r);
+		}
+		Register key = expression(subscript->rhs);
+		Register current = allocate();
+		if (node.op != AssignmentOperators::Assign)
+			emit(Instruction::abc(Opcode::GetIndex, current, object, key));
+		return result(assign(current, [&] (Register r) { emit(Instruction::abc(Opcode::SetIndex, object, key, r)); }));
+	}
+
+	error("Cannot assign to {}", node.lhs->class_name());
+	return destination(target);
+}
+
+CodeGenerator::Register CodeGenerator::call(const AST::CallExpression& node, int target)
+{
+	// The callee and its arguments are in consecutive registers, the result
+	// replaces the callee
+	Register base = allocate();
+	size_t count = node.arguments.size();
+
+	// `object.method(...)` gets `object` as first argument
+	auto member = AST::as<AST::MemberExpression>(node.lhs);
+	if (member && member->op == AST::MemberExpression::Operators::Member) {
+		allocate();
+		size_t top = m_function->top;
+		Register object = expression(member->lhs);
+		free_to(top);
+		emit(Instruction::abc(Opcode::Method, base, object, name_constant(AST::as<AST::Identifier>(member->rhs)->name)));
+		++count;
+	}
+	else {
+		expression(node.lhs, base);
+		free_to(base + 1);
+	}
+
+	for (auto& argument : node.arguments) {
+		Register r = allocate();
+		expression(argument, r);
+		free_to(r + 1);
+	}
+	if (count > UINT8_MAX)
+		error("Too many arguments in a call, {} (the maximum is {})", count, UINT8_MAX);
+
+	emit(Instruction::abc(Opcode::Call, base, count));
+	free_to(base + 1);
+	if (target == any_register || target == base)
+		return base;
+	emit(Instruction::abc(Opcode::Move, target, base));
+	free_to(base);
+	return target;
+}
+
+CodeGenerator::Register CodeGenerator::match(const AST::MatchExpression& node, int target)
+{
+	// Cases are tested in order, the first pattern equal to the subject gives
+	// the result, `default` always does
+	Register d = destination(target);
+	size_t top = m_function->top;
+	Register subject = expression(node.subject);
+	size_t cases_top = m_function->top;
+
+	std::vector<size_t> to_end;
+	bool has_default = false;
+	for (auto& [patterns, value] : node.cases) {
+		std::vector<size_t> matched;
+		bool is_default = false;
+		for (auto& pattern : patterns) {
+			if (!pattern) {
+				is_default = true;
+				continue;
+			}
+			Register r = expression(pattern);
+			emit(Instruction::abc(Opcode::TestEqual, 1, subject, r));
+			matched.push_back(emit_jump());
+			free_to(cases_top);
+		}
+
+		size_t to_next = is_default ? 0 : emit_jump();
+		patch_here(matched);
+		expression(value, d);
+		free_to(cases_top);
+		to_end.push_back(emit_jump());
+		if (!is_default)
+			patch_here(to_next);
+		has_default |= is_default;
+	}
+	if (!has_default)
+		emit(Instruction::abc(Opcode::LoadNull, d));
+
+	patch_here(to_end);
+	free_to(top);
+	return d;
+}
+
+CodeGenerator::Register CodeGenerator::member(const AST::MemberExpression& node, int target)
+{
+	using Operators = AST::MemberExpression::Operators;
+	if (node.op == Operators::Namespace || node.op == Operators::Static) {
+		error("Static and namespace member expressions are not supported yet");
+		return destination(target);
+	}
+
+	size_t top = m_function->top;
+	Register object = expression(node.lhs);
+	uint8_t name = name_constant(AST::as<AST::Identifier>(node.rhs)->name);
+	free_to(top);
+	Register d = destination(target);
+
+	if (node.op == Operators::Member) {
+		emit(Instruction::abc(Opcode::GetField, d, object, name));
+		return d;
+	}
+
+	// `object?.name` is null if `object` is
+	emit(Instruction::abc(Opcode::TestNull, 1, object));
+	size_t if_null = emit_jump();
+	emit(Instruction::abc(Opcode::GetField, d, object, name));
+	size_t to_end = emit_jump();
+	patch_here(if_null);
+	emit(Instruction::abc(Opcode::LoadNull, d));
+	patch_here(to_end);
+	return d;
+}
+
+CodeGenerator::Register CodeGenerator::update(const AST::UpdateExpression& node, int target, bool discarded)
+{
+	auto op = node.op == AST::UpdateExpression::Operators::Increment ? Opcode::AddInt : Opcode::SubstractInt;
+	// Whether the result is the previous value
+	bool postfix = !node.is_prefix_update && !discarded;
+
+	auto result = [&] (Register r) -> Register {
+		if (target == any_register || target == r)
+			return r;
+		emit(Instruction::abc(Opcode::Move, target, r));
+		return target;
+	};
+
+	if (auto identifier = AST::as<AST::Identifier>(node.expr)) {
+		auto variable = resolve(*identifier);
+		if (variable.kind == Variable::Kind::Global) {
+			error("Cannot update '{}', which is not declared", identifier->name);
+			return destination(target);
+		}
+		if (variable.is_constant)
+			error("Cannot update constant '{}'", identifier->name);
+
+		if (variable.kind == Variable::Kind::Register) {
+			Register r = variable.index;
+			if (!postfix) {
+				emit(Instruction::abc(op, r, r, 1));
+				return result(r);
+			}
+			Register d = destination(target);
+			emit(Instruction::abc(Opcode::Move, d, r));
+			emit(Instruction::abc(op, r, r, 1));
+			return d;
+		}
+
+		Register current = allocate();
+		Register updated = allocate();
+		read(variable, current);
+		emit(Instruction::abc(op, updated, current, 1));
+		write(variable, updated);
+		return result(postfix ? current : updated);
+	}
+
+	auto member = AST::as<AST::MemberExpression>(node.expr);
+	if (member->op != AST::MemberExpression::Operators::Member) {
+		error("Only '.' member expressions can be updated");
+		return destination(target);
+	}
+	Register object = expression(member->lhs);
+	uint8_t name = name_constant(AST::as<AST::Identifier>(member->rhs)->name);
+	Register current = allocate();
+	Register updated = allocate();
+	emit(Instruction::abc(Opcode::GetField, current, object, name));
+	emit(Instruction::abc(op, updated, current, 1));
+	emit(Instruction::abc(Opcode::SetField, object, name, updated));
+	return result(postfix ? current : updated);
+}
+
+CodeGenerator::Register CodeGenerator::closure(const AST::FunctionExpression& node, std::string_view name, int target)
+{
+	Register d = destination(target);
+	auto compiled = std::make_unique<Function>();
+	compiled->name = name;
+	function(*compiled, node);
+
+	auto& functions = m_function->function->functions;
+	if (functions.size() > UINT16_MAX)
+		error("Too many functions in '{}'", m_function->function->name);
+	emit(Instruction::abx(Opcode::Closure, d, functions.size()));
+	functions.push_back(std::move(compiled));
+	return d;
+}
+
+CodeGenerator::Register CodeGenerator::literal(Value value, int target)
+{
+	Register d = destination(target);
+	if (value.is_number()) {
+		// Small integers are encoded in the instruction
+		double n = value.to_number();
+		if (n == std::trunc(n) && n >= INT16_MIN && n <= INT16_MAX && !(n == 0 && std::signbit(n))) {
+			emit(Instruction::abx(Opcode::LoadInt, d, static_cast<uint16_t>(static_cast<int16_t>(n))));
+			return d;
+		}
+		emit(Instruction::abx(Opcode::LoadConstant, d, number_constant(n)));
+		return d;
+	}
+	emit(Instruction::abx(Opcode::LoadConstant, d, glyph_constant(value.to_glyph())));
+	return d;
+}
+
+// -----------------------------------------------------------------------------
+
+CodeGenerator::Variable CodeGenerator::resolve(const AST::Identifier& identifier)
+{
+	return resolve(*m_function, identifier);
+}
+
+CodeGenerator::Variable CodeGenerator::resolve(FunctionState& state, const AST::Identifier& identifier)
+{
+	for (auto it = state.locals.rbegin(); it != state.locals.rend(); ++it) {
+		if (it->name == identifier.symbol)
+			return { it->is_static ? Variable::Kind::Static : Variable::Kind::Register, it->index, it->is_constant };
+	}
+	for (size_t i = 0; i < state.upvalues.size(); ++i) {
+		if (state.upvalues[i].name == identifier.symbol)
+			return { Variable::Kind::Upvalue, static_cast<uint32_t>(i), state.upvalues[i].is_constant };
+	}
+
+	// Undeclared names are bound by the VM, to its built-ins
+	if (!state.enclosing) {
+		auto [it, inserted] = m_globals.try_emplace(identifier.name, m_program->globals.size());
+		if (inserted) {
+			if (m_program->globals.size() > UINT16_MAX)
+				error("Too many globals, at '{}'", identifier.name);
+			m_program->globals.emplace_back(identifier.name);
+		}
+		return { Variable::Kind::Global, it->second, true };
+	}
+
+	// Static variables and globals are the same in every function
+	auto outer = resolve(*state.enclosing, identifier);
+	if (outer.kind == Variable::Kind::Static || outer.kind == Variable::Kind::Global)
+		return outer;
+
+	if (outer.kind == Variable::Kind::Register) {
+		for (auto it = state.enclosing->locals.rbegin(); it != state.enclosing->locals.rend(); ++it) {
+			if (it->name == identifier.symbol) {
+				it->is_captured = true;
+				break;
+			}
+		}
+	}
+
+	if (state.upvalues.size() > UINT8_MAX)
+		error("Too many variables captured by '{}', at '{}'", state.function->name, identifier.name);
+	Function::UpvalueSource source { outer.kind == Variable::Kind::Register, static_cast<uint8_t>(outer.index) };
+	state.upvalues.push_back({ identifier.symbol, outer.is_constant, source });
+	state.function->upvalues.push_back(source);
+	return { Variable::Kind::Upvalue, static_cast<uint32_t>(state.upvalues.size() - 1), outer.is_constant };
+}
+
+void CodeGenerator::read(const Variable& variable, Register target)
+{
+	switch (variable.kind) {
+		case Variable::Kind::Register:
+			if (variable.index != target)
+				emit(Instruction::abc(Opcode::Move, target, variable.index));
+			break;
+		case Variable::Kind::Upvalue: emit(Instruction::abc(Opcode::GetUpvalue, target, variable.index)); break;
+		case Variable::Kind::Static:  emit(Instruction::abx(Opcode::GetStatic, target, variable.index)); break;
+		case Variable::Kind::Global:  emit(Instruction::abx(Opcode::GetGlobal, target, variable.index)); break;
+	}
+}
+
+void CodeGenerator::write(const Variable& variable, Register source)
+{
+	switch (variable.kind) {
+		case Variable::Kind::Register:
+			if (variable.index != source)
+				emit(Instruction::abc(Opcode::Move, variable.index, source));
+			break;
+		case Variable::Kind::Upvalue: emit(Instruction::abc(Opcode::SetUpvalue, source, variable.index)); break;
+		case Variable::Kind::Static:  emit(Instruction::abx(Opcode::SetStatic, source, variable.index)); break;
+		case Variable::Kind::Global:  break;
+	}
+}
+
+CodeGenerator::Local* CodeGenerator::declare(const AST::Identifier& name, bool is_static, bool is_constant, uint32_t index)
+{
+	auto& state = *m_function;
+	for (auto it = state.locals.rbegin(); it != state.locals.rend() && it->scope == state.scope; ++it) {
+		if (it->name == name.symbol) {
+			error("'{}' is already declared in this block", name.name);
+			break;
+		}
+	}
+
+	state.locals.push_back({ name.symbol, is_static, is_constant, false, index, state.scope });
+	if (!is_static)
+		state.locals_top = index + 1;
+	return &state.locals.back();
+}
+
+void CodeGenerator::begin_scope()
+{
+	++m_function->scope;
+}
+
+void CodeGenerator::end_scope()
+{
+	auto& state = *m_function;
+	auto first = std::find_if(state.locals.begin(), state.locals.end(), [&] (const Local& local) {
+		return local.scope == state.scope;
+	});
+
+	// Closures that captured variables of this scope keep their own copy
+	auto captured = std::find_if(first, state.locals.end(), [] (const Local& local) {
+		return local.is_captured && !local.is_static;
+	});
+	if (captured != state.locals.end()) {
+		uint32_t lowest = captured->index;
+		for (auto it = captured; it != state.locals.end(); ++it) {
+			if (it->is_captured && !it->is_static)
+				lowest = std::min(lowest, it->index);
+		}
+		emit(Instruction::abc(Opcode::Close, lowest));
+	}
+
+	state.locals.erase(first, state.locals.end());
+	state.locals_top = 0;
+	for (auto it = state.locals.rbegin(); it != state.locals.rend(); ++it) {
+		if (!it->is_static) {
+			state.locals_top = it->index + 1;
+			break;
+		}
+	}
+	free_to(state.locals_top);
+	--state.scope;
+}
+
+// -----------------------------------------------------------------------------
+
+CodeGenerator::Register CodeGenerator::allocate()
+{
+	auto& state = *m_function;
+	if (state.top >= max_registers) {
+		if (state.top++ == max_registers)
+			error("Function '{}' needs more than {} registers", state.function->name, max_registers);
+		return max_registers - 1;
+	}
+	Register r = state.top++;
+	state.function->register_count = std::max<size_t>(state.function->register_count, state.top);
+	return r;
+}
+
+size_t CodeGenerator::emit(Instruction instruction)
+{
+	auto& code = m_function->function->code;
+	code.push_back(instruction);
+	return code.size() - 1;
+}
+
+size_t CodeGenerator::emit_jump()
+{
+	return emit(Instruction::sj(Opcode::Jump, 0));
+}
+
+void CodeGenerator::patch(size_t jump, size_t target)
+{
+	auto offset = static_cast<int64_t>(target) - static_cast<int64_t>(jump + 1);
+	if (offset > max_jump || offset < -max_jump)
+		error("Function '{}' is too long to jump across", m_function->function->name);
+	m_function->function->code[jump] = Instruction::sj(Opcode::Jump, static_cast<int32_t>(offset));
+}
+
+void CodeGenerator::patch_here(const std::vector<size_t>& jumps)
+{
+	for (size_t jump : jumps)
+		patch_here(jump);
+}
+
+// -----------------------------------------------------------------------------
+
+uint16_t CodeGenerator::constant(Value value)
+{
+	auto& constants = m_function->function->constants;
+	if (constants.size() > UINT16_MAX) {
+		error("Function '{}' has more than {} constants", m_function->function->name, UINT16_MAX + 1);
+		return 0;
+	}
+	constants.push_back(value);
+	return constants.size() - 1;
+}
+
+uint16_t CodeGenerator::number_constant(double number)
+{
+	auto [it, inserted] = m_function->numbers.try_emplace(std::bit_cast<uint64_t>(number), 0);
+	if (inserted) {
+		// Literals that are integers are computed as such
+		bool integer = number == std::trunc(number) && number >= INT32_MIN && number <= INT32_MAX && !(number == 0 && std::signbit(number));
+		it->second = constant(integer ? Value::from_integer(static_cast<int64_t>(number)) : Value::from_number(number));
+	}
+	return it->second;
+}
+
+uint16_t CodeGenerator::glyph_constant(uint32_t glyph)
+{
+	auto [it, inserted] = m_function->glyphs.try_emplace(glyph, 0);
+	if (inserted)
+		it->second = constant(Value::from_glyph(glyph));
+	return it->second;
+}
+
+uint16_t CodeGenerator::string_constant(std::string_view value)
+{
+	// Shared by every function of the program
+	auto [string, created] = m_strings.try_emplace(value, nullptr);
+	if (created) {
+		m_program->strings.push_back(std::make_unique<String>(std::string(value)));
+		string->second = m_program->strings.back().get();
+	}
+
+	auto [it, inserted] = m_function->strings.try_emplace(string->second->value, 0);
+	if (inserted)
+		it->second = constant(Value::from_object(string->second));
+	return it->second;
+}
+
+uint8_t CodeGenerator::name_constant(std::string_view name)
+{
+	uint16_t index = string_constant(name);
+	if (index > UINT8_MAX)
+		error("Function '{}' has too many constants to refer to member '{}'", m_function->function->name, name);
+	return index;
+}
+
+}
@@ -5,11 +5,15 @@
 */
 
 #include "Bax/Compiler/Compiler.hpp"
+#include "Bax/Compiler/CodeGenerator.hpp"
 #include "Bax/Compiler/Parser.hpp"
 #include "Common/Log.hpp"
-#include <fstream>
-#include <streambuf>
+#include "Common/ParallelFor.hpp"
+#include <algorithm>
+#include <filesystem>
 #include <string>
+#include <system_error>
+#include <thread>
 
 // -----------------------------------------------------------------------------
 
@@ -17,6 +21,7 @@ namespace Bax
 {
 
 Compiler::Compiler()
+: m_max_depth(Parser::default_max_depth)
 {}
 
 Compiler::~Compiler()
@@ -24,32 +29,146 @@ Compiler::~Compiler()
 
 bool Compiler::do_istream(std::istream& input)
 {
-	std::string source { std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>() };
-	return do_string(source);
+	// Streamed by chunks, instead of waiting for the whole input
+	return run(Lexer(input));
 }
 
 bool Compiler::do_file(const std::string& filename)
 {
 	Log::debug("do_file(\"{}\")", filename);
-	std::ifstream file(filename);
-	return do_istream(file);
+	auto source = SourceBuffer::open(filename);
+	if (!source)
+		return false;
+
+	m_source = std::move(*source);
+	return run(Lexer(m_source.view()));
 }
 
 bool Compiler::do_string(std::string_view source)
 {
 	Log::debug("do_string(\"{}\")", source);
-	return run(source);
+	// Nodes may refer to the source, which has to outlive them
+	m_source = SourceBuffer(std::string(source));
+	return run(Lexer(m_source.view()));
 }
 
-bool Compiler::run(std::string_view source)
+bool Compiler::do_files(const std::vector<std::string>& paths)
 {
-	auto parser = Parser(Lexer(source));
+	// Directories are walked up front, in name order, so that the order of
+	// the inputs does not depend on the file system
+	std::vector<std::string> files;
+	for (auto& path : paths) {
+		std::error_code error;
+		if (!std::filesystem::is_directory(path, error)) {
+			files.push_back(path);
+			continue;
+		}
+
+		size_t first = files.size();
+		std::filesystem::recursive_directory_iterator it(path, error), end;
+		for (; !error && it != end; it.increment(error)) {
+			if (it->path().extension() == ".bax" && it->is_regular_file(error))
+				files.push_back(it->path().string());
+		}
+		if (error) {
+			Log::error("Could not list {}: {}", path, error.message());
+			return false;
+		}
+		std::sort(files.begin() + first, files.end());
+	}
+
+	reset();
+	m_units.resize(files.size());
+	for (size_t i = 0; i < files.size(); ++i)
+		m_units[i].path = std::move(files[i]);
+
+	size_t thread_count = m_thread_count ? m_thread_count : std::thread::hardware_concurrency();
+	thread_count = std::clamp<size_t>(thread_count, 1, std::max<size_t>(m_units.size(), 1));
+	m_workers.reserve(thread_count);
+	for (size_t i = 0; i < thread_count; ++i)
+		m_workers.emplace_back(m_symbols);
+
+	// Nothing is logged from the workers, each unit keeps its own diagnostics
+	parallel_for(m_units.size(), thread_count, [&] (size_t i, size_t w) {
+		auto& unit = m_units[i];
+		auto& worker = m_workers[w];
+
+		std::string error;
+		auto source = SourceBuffer::open(unit.path, &error);
+		if (!source) {
+			unit.diagnostics.push_back({ 0, std::move(error) });
+			return;
+		}
+		unit.source = std::move(*source);
+
+		// Inputs are already lexed concurrently, each one on its worker alone
+		Lexer lexer(unit.source.view());
+		lexer.set_thread_count(1);
+		auto parser = Parser(std::move(lexer), worker.strings, worker.symbols, worker.nodes);
+		parser.set_max_depth(m_max_depth);
+		unit.ast = parser.run();
+		unit.diagnostics = parser.diagnostics();
+	});
+
+	// Merged in input order, whichever threads parsed them
+	bool ok = true;
+	for (auto& unit : m_units) {
+		for (auto& diagnostic : unit.diagnostics) {
+			Log::error("{}: {}", unit.path, diagnostic.message);
+			m_diagnostics.push_back(diagnostic);
+			m_diagnostics.back().file = unit.path;
+		}
+		if (!unit.ast) {
+			ok = false;
+			continue;
+		}
+		if (m_ast_writer)
+			m_ast_writer->write(unit.ast);
+	}
+	return ok;
+}
+
+bool Compiler::run(Lexer lexer)
+{
+	// The previous trees, if any, are not needed anymore
+	reset();
+
+	SymbolTable symbols(m_symbols);
+	lexer.set_thread_count(m_thread_count);
+	auto parser = Parser(std::move(lexer), m_strings, symbols, m_nodes);
+	parser.set_max_depth(m_max_depth);
 	m_ast = parser.run();
+	m_diagnostics = parser.diagnostics();
+	for (auto& diagnostic : m_diagnostics)
+		Log::error("{}", diagnostic.message);
 	if (!m_ast)
 		return false;
 
-	m_ast->dump();
-	return true;
+	if (m_ast_writer)
+		m_ast_writer->write(m_ast);
+	if (m_only_parse)
+		return true;
+
+	CodeGenerator generator;
+	generator.set_max_depth(m_max_depth);
+	m_program = generator.run(m_ast);
+	for (auto& diagnostic : generator.diagnostics()) {
+		Log::error("{}", diagnostic.message);
+		m_diagnostics.push_back(diagnostic);
+	}
+	return m_program != nullptr;
+}
+
+void Compiler::reset()
+{
+	m_ast = nullptr;
+	m_program.reset();
+	m_nodes.clear();
+	// Only once the tree that refers to them is gone
+	m_strings.clear();
+	m_units.clear();
+	m_workers.clear();
+	m_diagnostics.clear();
 }
 
 }
@@ -0,0 +1,346 @@
+/*
+** Bax, 2021
+** Benoit Lormeau <blormeau@outlook.com>
+** FlatAST.cpp
+*/
+
+#include "Bax/Compiler/FlatAST.hpp"
+#include "Common/Assertions.hpp"
+#include <algorithm>
+#include <type_traits>
+
+// -----------------------------------------------------------------------------
+
+namespace Bax
+{
+
+namespace
+{
+
+using Index = FlatAST::Index;
+
+template <typename T = AST::Expression>
+Ptr<T> node_at(const std::vector<Ptr<AST::Node>>& built, Index at)
+{
+	return at == FlatAST::none ? nullptr : static_cast<Ptr<T>>(built[at]);
+}
+
+template <typename T = AST::Expression>
+std::vector<Ptr<T>> nodes_at(const std::vector<Ptr<AST::Node>>& built, std::span<const Index> items)
+{
+	std::vector<Ptr<T>> nodes;
+	nodes.reserve(items.size());
+	for (Index at : items)
+		nodes.push_back(node_at<T>(built, at));
+	return nodes;
+}
+
+}
+
+void FlatAST::clear()
+{
+	kinds.clear();
+	operators.clear();
+	lhs.clear();
+	rhs.clear();
+	extra.clear();
+	strings.clear();
+	numbers.clear();
+}
+
+FlatAST::Index FlatAST::push(Kind kind, uint8_t op, Index l, Index r)
+{
+	kinds.push_back(kind);
+	operators.push_back(op);
+	lhs.push_back(l);
+	rhs.push_back(r);
+	return static_cast<Index>(kinds.size() - 1);
+}
+
+FlatAST::Index FlatAST::push_list(std::span<const Index> items)
+{
+	Index begin = static_cast<Index>(extra.size());
+	extra.insert(extra.end(), items.begin(), items.end());
+	return begin;
+}
+
+FlatAST FlatAST::from_tree(Ptr<const AST::Node> root)
+{
+	// Walked with a stack rather than recursively, right-associative chains
+	// are as deep as they are long
+	struct Step
+	{
+		Ptr<const AST::Node> node;
+		// Where its children start in `flattened`, once they are pushed
+		size_t first;
+		bool is_closing;
+	};
+
+	FlatAST flat;
+	std::vector<Step> steps = { { root, 0, false } };
+	// Nodes whose parent is not flattened yet, in source order
+	std::vector<Index> flattened;
+
+	while (!steps.empty()) {
+		Step step = steps.back();
+		steps.pop_back();
+
+		if (!step.node) {
+			flattened.push_back(none);
+			continue;
+		}
+
+		if (step.is_closing) {
+			std::span<const Index> children(flattened.begin() + step.first, flattened.end());
+			Index at = flat.flatten(*step.node, children);
+			flattened.resize(step.first);
+			flattened.push_back(at);
+			continue;
+		}
+
+		steps.push_back({ step.node, flattened.size(), true });
+
+		// Pushed in order, then reversed so that they are popped in order
+		size_t first = steps.size();
+		AST::for_each_child(*step.node, [&] (Ptr<const AST::Node> child) {
+			steps.push_back({ child, 0, false });
+		});
+		std::reverse(steps.begin() + first, steps.end());
+	}
+
+	return flat;
+}
+
+FlatAST::Index FlatAST::flatten(const AST::Node& node, std::span<const Index> children)
+{
+	using namespace AST;
+
+	// Children are taken in the order they were flattened
+	size_t next = 0;
+	auto child = [&] { return children[next++]; };
+	auto take = [&] (size_t count) {
+		auto items = children.subspan(next, count);
+		next += count;
+		return items;
+	};
+	// Range of `items` in `extra`, itself stored in `extra`
+	auto push_range = [this] (std::span<const Index> items) {
+		Index begin = push_list(items);
+		Index range[] = { begin, static_cast<Index>(begin + items.size()) };
+		return push_list(range);
+	};
+
+	return visit(node, [&] <typename T> (const T& n) -> Index {
+		if constexpr (std::is_same_v<T, Identifier>) {
+			strings.push_back(n.name);
+			return push(Kind::Identifier, 0, n.symbol, static_cast<Index>(strings.size() - 1));
+		}
+		else if constexpr (std::is_same_v<T, ArrayExpression>) {
+			auto items = take(n.elements.size());
+			Index begin = push_list(items);
+			return push(Kind::ArrayExpression, 0, begin, static_cast<Index>(begin + items.size()));
+		}
+		else if constexpr (std::is_same_v<T, AssignmentExpression>) {
+			Index l = child(), r = child();
+			return push(Kind::AssignmentExpression, static_cast<uint8_t>(n.op), l, r);
+		}
+		else if constexpr (std::is_same_v<T, BinaryExpression>) {
+			Index l = child(), r = child();
+			return push(Kind::BinaryExpression, static_cast<uint8_t>(n.op), l, r);
+		}
+		else if constexpr (std::is_same_v<T, CallExpression>) {
+			Index callee = child();
+			auto arguments = take(n.arguments.size());
+			return push(Kind::CallExpression, 0, callee, push_range(arguments));
+		}
+		else if constexpr (std::is_same_v<T, FunctionExpression>) {
+			auto parameters = take(n.parameters.size());
+			Index body = child();
+			return push(Kind::FunctionExpression, 0, body, push_range(parameters));
+		}
+		else if constexpr (std::is_same_v<T, MatchExpression>) {
+			Index subject = child();
+			std::vector<Index> cases;
+			cases.reserve(n.cases.size() * 3);
+			for (auto& [patterns, value] : n.cases) {
+				auto items = take(patterns.size());
+				Index begin = push_list(items);
+				cases.push_back(begin);
+				cases.push_back(static_cast<Index>(begin + items.size()));
+				cases.push_back(child());
+			}
+			return push(Kind::MatchExpression, 0, subject, push_range(cases));
+		}
+		else if constexpr (std::is_same_v<T, MemberExpression>) {
+			Index l = child(), r = child();
+			return push(Kind::MemberExpression, static_cast<uint8_t>(n.op), l, r);
+		}
+		else if constexpr (std::is_same_v<T, ObjectExpression>) {
+			// Each key, then its value
+			auto members = take(n.members.size() * 2);
+			Index begin = push_list(members);
+			return push(Kind::ObjectExpression, 0, begin, static_cast<Index>(begin + members.size()));
+		}
+		else if constexpr (std::is_same_v<T, SubscriptExpression>) {
+			Index l = child(), r = child();
+			return push(Kind::SubscriptExpression, 0, l, r);
+		}
+		else if constexpr (std::is_same_v<T, TernaryExpression>) {
+			Index condition = child();
+			auto branches = take(2);
+			return push(Kind::TernaryExpression, 0, condition, push_list(branches));
+		}
+		else if constexpr (std::is_same_v<T, UnaryExpression>) {
+			Index operand = child();
+			return push(Kind::UnaryExpression, static_cast<uint8_t>(n.op), operand, 0);
+		}
+		else if constexpr (std::is_same_v<T, UpdateExpression>) {
+			Index operand = child();
+			return push(Kind::UpdateExpression, static_cast<uint8_t>(n.op), operand, n.is_prefix_update);
+		}
+		else if constexpr (std::is_same_v<T, Null>) {
+			return push(Kind::Null, 0, 0, 0);
+		}
+		else if constexpr (std::is_same_v<T, Boolean>) {
+			return push(Kind::Boolean, n.value, 0, 0);
+		}
+		else if constexpr (std::is_same_v<T, Glyph>) {
+			return push(Kind::Glyph, 0, n.value, 0);
+		}
+		else if constexpr (std::is_same_v<T, Number>) {
+			numbers.push_back(n.value);
+			return push(Kind::Number, 0, static_cast<Index>(numbers.size() - 1), 0);
+		}
+		else if constexpr (std::is_same_v<T, String>) {
+			strings.push_back(n.value);
+			return push(Kind::String, 0, static_cast<Index>(strings.size() - 1), 0);
+		}
+		else if constexpr (std::is_same_v<T, BlockStatement>) {
+			auto items = take(n.statements.size());
+			Index begin = push_list(items);
+			return push(Kind::BlockStatement, 0, begin, static_cast<Index>(begin + items.size()));
+		}
+		else if constexpr (std::is_same_v<T, ExpressionStatement>) {
+			Index expression = child();
+			return push(Kind::ExpressionStatement, 0, expression, 0);
+		}
+		else if constexpr (std::is_same_v<T, IfStatement>) {
+			Index condition = child();
+			auto branches = take(2);
+			return push(Kind::IfStatement, 0, condition, push_list(branches));
+		}
+		else if constexpr (std::is_same_v<T, ReturnStatement>) {
+			Index value = child();
+			return push(Kind::ReturnStatement, 0, value, 0);
+		}
+		else if constexpr (std::is_same_v<T, WhileStatement>) {
+			Index condition = child(), body = child();
+			return push(Kind::WhileStatement, 0, condition, body);
+		}
+		else if constexpr (std::is_same_v<T, VariableDeclaration>) {
+			Index name = child(), value = child();
+			uint8_t flags = (n.is_constant ? Constant : 0) | (n.is_static ? Static : 0);
+			return push(Kind::VariableDeclaration, flags, name, value);
+		}
+	});
+}
+
+// -----------------------------------------------------------------------------
+
+Ptr<AST::Node> FlatAST::to_tree(Arena& nodes) const
+{
+	if (empty())
+		return nullptr;
+
+	// Children come first, so every node is built from already built ones
+	std::vector<Ptr<AST::Node>> built(size());
+	for (Index i = 0; i < size(); ++i)
+		built[i] = rebuild(nodes, built, i);
+	return built[root()];
+}
+
+Ptr<AST::Node> FlatAST::rebuild(Arena& nodes, const std::vector<Ptr<AST::Node>>& built, Index i) const
+{
+	using namespace AST;
+
+	auto node = [&] (Index at) { return node_at(built, at); };
+	auto nodes_of = [&] (std::span<const Index> items) { return nodes_at(built, items); };
+
+	uint8_t op = operators[i];
+	Index l = lhs[i], r = rhs[i];
+
+	switch (kinds[i]) {
+		case Kind::Identifier:
+			return nodes.make<Identifier>(l, strings[r]);
+		case Kind::ArrayExpression:
+			return nodes.make<ArrayExpression>(nodes_of(list(l, r)));
+		case Kind::AssignmentExpression:
+			return nodes.make<AssignmentExpression>(static_cast<AssignmentExpression::Operators>(op), node(l), node(r));
+		case Kind::BinaryExpression:
+			return nodes.make<BinaryExpression>(static_cast<BinaryExpression::Operators>(op), node(l), node(r));
+		case Kind::CallExpression:
+			return nodes.make<CallExpression>(node(l), nodes_of(list(r)));
+		case Kind::FunctionExpression:
+			return nodes.make<FunctionExpression>(nodes_of(list(r)), node_at<BlockStatement>(built, l));
+		case Kind::MatchExpression: {
+			MatchExpression::CasesType cases;
+			auto items = list(r);
+			for (size_t c = 0; c < items.size(); c += 3)
+				cases.emplace_back(nodes_of(list(items[c], items[c + 1])), node(items[c + 2]));
+			return nodes.make<MatchExpression>(node(l), std::move(cases));
+		}
+		case Kind::MemberExpression:
+			return nodes.make<MemberExpression>(static_cast<MemberExpression::Operators>(op), node(l), node(r));
+		case Kind::ObjectExpression: {
+			ObjectExpression::MembersType members;
+			auto items = list(l, r);
+			members.reserve(items.size() / 2);
+			for (size_t m = 0; m < items.size(); m += 2)
+				members.emplace_back(node_at<Identifier>(built, items[m]), node(items[m + 1]));
+			return nodes.make<ObjectExpression>(std::move(members));
+		}
+		case Kind::SubscriptExpression:
+			return nodes.make<SubscriptExpression>(node(l), node(r));
+		case Kind::TernaryExpression:
+			return nodes.make<TernaryExpression>(node(l), node(extra[r]), node(extra[r + 1]));
+		case Kind::UnaryExpression:
+			return nodes.make<UnaryExpression>(static_cast<UnaryExpression::Operators>(op), node(l));
+		case Kind::UpdateExpression:
+			return nodes.make<UpdateExpression>(static_cast<UpdateExpression::Operators>(op), node(l), r != 0);
+		case Kind::Null:
+			return nodes.make<Null>();
+		case Kind::Boolean:
+			return nodes.make<Boolean>(op != 0);
+		case Kind::Glyph:
+			return nodes.make<Glyph>(l);
+		case Kind::Number:
+			return nodes.make<Number>(numbers[l]);
+		case Kind::String:
+			return nodes.make<String>(strings[l]);
+		case Kind::BlockStatement:
+			return nodes.make<BlockStatement>(nodes_at<Statement>(built, list(l, r)));
+		case Kind::ExpressionStatement:
+			return nodes.make<ExpressionStatement>(node(l));
+		case Kind::IfStatement:
+			return nodes.make<IfStatement>(
+				node(l),
+				node_at<Statement>(built, extra[r]),
+				node_at<Statement>(built, extra[r + 1])
+			);
+		case Kind::ReturnStatement:
+			return nodes.make<ReturnStatement>(node(l));
+		case Kind::WhileStatement:
+			return nodes.make<WhileStatement>(node(l), node_at<Statement>(built, r));
+		case Kind::VariableDeclaration:
+			return nodes.make<VariableDeclaration>(
+				node_at<Identifier>(built, l),
+				node(r),
+				(op & Constant) != 0,
+				(op & Static) != 0
+			);
+	}
+
+	ASSERT_NOT_REACHED();
+}
+
+}
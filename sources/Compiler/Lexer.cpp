@@ -5,18 +5,163 @@
 */
 
 #include "Bax/Compiler/Lexer.hpp"
+#include "Common/Assertions.hpp"
 #include "Common/Log.hpp"
-#include <cctype>
+#include "Common/Scanner.hpp"
+#include <array>
+#include <atomic>
+#include <charconv>
+#include <cmath>
+#include <cstdint>
 #include <cstdlib>
-#include <cstring>
 #include <functional>
+#include <thread>
 
 // -----------------------------------------------------------------------------
 
 namespace Bax
 {
 
-const std::unordered_map<std::string_view, Token::Type> Lexer::keywords = {
+namespace
+{
+
+/// Operators ------------------------------------------------------------------
+
+struct Operator
+{
+	std::string_view text;
+	Token::Type type;
+};
+
+constexpr Operator operators[] = {
+	{ "!",   Token::Type::Exclamation              },
+	{ "!=",  Token::Type::ExclamationEquals        },
+	{ "%",   Token::Type::Percent                  },
+	{ "%=",  Token::Type::PercentEquals            },
+	{ "&",   Token::Type::Ampersand                },
+	{ "&&",  Token::Type::AmpersandAmpersand       },
+	{ "&&=", Token::Type::AmpersandAmpersandEquals },
+	{ "&=",  Token::Type::AmpersandEquals          },
+	{ "(",   Token::Type::LeftParenthesis          },
+	{ ")",   Token::Type::RightParenthesis         },
+	{ "*",   Token::Type::Asterisk                 },
+	{ "**",  Token::Type::AsteriskAsterisk         },
+	{ "**=", Token::Type::AsteriskAsteriskEquals   },
+	{ "*=",  Token::Type::AsteriskEquals           },
+	{ "+",   Token::Type::Plus                     },
+	{ "++",  Token::Type::PlusPlus                 },
+	{ "+=",  Token::Type::PlusEquals               },
+	{ ",",   Token::Type::Comma                    },
+	{ "-",   Token::Type::Minus                    },
+	{ "--",  Token::Type::MinusMinus               },
+	{ "-=",  Token::Type::MinusEquals              },
+	{ ".",   Token::Type::Dot                      },
+	{ "/",   Token::Type::Slash                    },
+	{ "/=",  Token::Type::SlashEquals              },
+	{ ":",   Token::Type::Colon                    },
+	{ "::",  Token::Type::ColonColon               },
+	{ ";",   Token::Type::Semicolon                },
+	{ "<",   Token::Type::Less                     },
+	{ "<<",  Token::Type::LessLess                 },
+	{ "<<=", Token::Type::LessLessEquals           },
+	{ "<=",  Token::Type::LessEquals               },
+	{ "=",   Token::Type::Equals                   },
+	{ "==",  Token::Type::EqualsEquals             },
+	{ "=>",  Token::Type::EqualsGreater            },
+	{ ">",   Token::Type::Greater                  },
+	{ ">=",  Token::Type::GreaterEquals            },
+	{ ">>",  Token::Type::GreaterGreater           },
+	{ ">>=", Token::Type::GreaterGreaterEquals     },
+	{ "?",   Token::Type::Question                 },
+	{ "?.",  Token::Type::QuestionDot              },
+	{ "?:",  Token::Type::QuestionColon            },
+	{ "??",  Token::Type::QuestionQuestion         },
+	{ "?\?=", Token::Type::QuestionQuestionEquals   },
+	{ "[",   Token::Type::LeftBracket              },
+	{ "\\",  Token::Type::Backslash                },
+	{ "]",   Token::Type::RightBracket             },
+	{ "^",   Token::Type::Caret                    },
+	{ "^=",  Token::Type::CaretEquals              },
+	{ "{",   Token::Type::LeftBrace                },
+	{ "|",   Token::Type::Pipe                     },
+	{ "|=",  Token::Type::PipeEquals               },
+	{ "||",  Token::Type::PipePipe                 },
+	{ "||=", Token::Type::PipePipeEquals           },
+	{ "}",   Token::Type::RightBrace               },
+	{ "~",   Token::Type::Tilde                    },
+};
+
+constexpr size_t operator_count = sizeof(operators) / sizeof(*operators);
+
+// Flat DFA recognizing the longest operator at the current position.
+// State 0 is the dead state, state `i + 1` accepts `operators[i]`.
+// The first byte is dispatched through a 256-wide table, the few following
+// bytes through the (contiguous) outgoing edges of the current state.
+struct OperatorTable
+{
+	struct State {
+		Token::Type type = Token::Type::Unknown;
+		uint8_t first_edge = 0;
+		uint8_t edge_count = 0;
+	};
+
+	struct Edge {
+		char c = 0;
+		uint8_t target = 0;
+	};
+
+	std::array<uint8_t, 256> roots {};
+	std::array<State, operator_count + 1> states {};
+	std::array<Edge, operator_count> edges {};
+};
+
+constexpr OperatorTable build_operator_table()
+{
+	static_assert(operator_count < 256, "Too many operators for 8-bit states");
+
+	auto find_state = [] (std::string_view text) -> uint8_t {
+		for (size_t i = 0; i < operator_count; ++i)
+			if (operators[i].text == text)
+				return i + 1;
+		return 0;
+	};
+
+	OperatorTable table;
+	size_t edge_count = 0;
+
+	for (size_t i = 0; i < operator_count; ++i) {
+		auto text = operators[i].text;
+		auto& state = table.states[i + 1];
+		state.type = operators[i].type;
+
+		if (text.length() == 1)
+			table.roots[(uint8_t)text[0]] = i + 1;
+		else if (find_state(text.substr(0, text.length() - 1)) == 0)
+			throw "Operators must be reachable through their prefixes";
+
+		state.first_edge = edge_count;
+		for (size_t j = 0; j < operator_count; ++j) {
+			auto child = operators[j].text;
+			if (child.length() == text.length() + 1 && child.starts_with(text))
+				table.edges[edge_count++] = { child.back(), uint8_t(j + 1) };
+		}
+		state.edge_count = edge_count - state.first_edge;
+	}
+
+	return table;
+}
+
+constexpr OperatorTable operator_table = build_operator_table();
+
+/// Keywords -------------------------------------------------------------------
+
+struct Keyword
+{
+	std::string_view text;
+	Token::Type type = Token::Type::Identifier;
+};
+
+constexpr Keyword keywords[] = {
 	{ "class",      Token::Type::Class      },
 	{ "const",      Token::Type::Const      },
 	{ "default",    Token::Type::Default    },
@@ -39,100 +184,333 @@ const std::unordered_map<std::string_view, Token::Type> Lexer::keywords = {
 	{ "while",      Token::Type::While      },
 };
 
-const Lexer::OperatorTreeNode Lexer::operator_tree_root = {
-	Token::Type::Unknown, {
-		{'!', { Token::Type::Exclamation, {
-			{'=', { Token::Type::ExclamationEquals, {} }}
-		} }},
-		{'%', { Token::Type::Percent, {
-			{'=', { Token::Type::PercentEquals, {} }}
-		} }},
-		{'&', { Token::Type::Ampersand, {
-			{'&', { Token::Type::AmpersandAmpersand, {
-				{'=', { Token::Type::AmpersandAmpersandEquals, {} }}
-			} }},
-			{'=', { Token::Type::AmpersandEquals, {} }}
-		} }},
-		{'(', { Token::Type::LeftParenthesis, {} }},
-		{')', { Token::Type::RightParenthesis, {} }},
-		{'*', { Token::Type::Asterisk, {
-			{'*', { Token::Type::AsteriskAsterisk, {
-				{'=', { Token::Type::AsteriskAsteriskEquals, {} }}
-			} }},
-			{'=', { Token::Type::AsteriskEquals, {} }}
-		} }},
-		{'+', { Token::Type::Plus, {
-			{'+', { Token::Type::PlusPlus, {} }},
-			{'=', { Token::Type::PlusEquals, {} }}
-		} }},
-		{',', { Token::Type::Comma, {} }},
-		{'-', { Token::Type::Minus, {
-			{'-', { Token::Type::MinusMinus, {} }},
-			{'=', { Token::Type::MinusEquals, {} }}
-		} }},
-		{'.', { Token::Type::Dot, {} }},
-		{'/', { Token::Type::Slash, {
-			{'=', { Token::Type::SlashEquals, {} }}
-		} }},
-		{':', { Token::Type::Colon, {
-			{':', { Token::Type::ColonColon, {} }},
-		} }},
-		{';', { Token::Type::Semicolon, {} }},
-		{'<', { Token::Type::Less, {
-			{'<', { Token::Type::LessLess, {
-				{'=', { Token::Type::LessLessEquals, {} }}
-			} }},
-			{'=', { Token::Type::LessEquals, {} }}
-		} }},
-		{'=', { Token::Type::Equals, {
-			{'=', { Token::Type::EqualsEquals, {} }},
-			{'>', { Token::Type::EqualsGreater, {} }}
-		} }},
-		{'>', { Token::Type::Greater, {
-			{'>', { Token::Type::GreaterGreater, {
-				{'=', { Token::Type::GreaterGreaterEquals, {} }}
-			} }},
-			{'=', { Token::Type::GreaterEquals, {} }}
-		} }},
-		{'?', { Token::Type::Question, {
-			{'.', { Token::Type::QuestionDot, {} }},
-			{':', { Token::Type::QuestionColon, {} }},
-			{'?', { Token::Type::QuestionQuestion, {
-				{'=', { Token::Type::QuestionQuestionEquals, {} }}
-			} }},
-		} }},
-		{'[', { Token::Type::LeftBracket, {} }},
-		{'\\', { Token::Type::Backslash, {} }},
-		{']', { Token::Type::RightBracket, {} }},
-		{'^', { Token::Type::Caret, {
-			{'=', { Token::Type::CaretEquals, {} }}
-		} }},
-		{'{', { Token::Type::LeftBrace, {} }},
-		{'|', { Token::Type::Pipe, {
-			{'|', { Token::Type::PipePipe, {
-				{'=', { Token::Type::PipePipeEquals, {} }}
-			} }},
-			{'=', { Token::Type::PipeEquals, {} }}
-		} }},
-		{'}', { Token::Type::RightBrace, {} }},
-		{'~', { Token::Type::Tilde, {} }},
+// Perfect hash of the keywords, on their length, first and last characters.
+// The multipliers are searched at compile time, so that editing the keyword
+// list above is enough to regenerate a collision-free table.
+struct KeywordTable
+{
+	static constexpr size_t size = 64;
+
+	uint8_t first_multiplier = 0;
+	uint8_t last_multiplier = 0;
+	size_t min_length = SIZE_MAX;
+	size_t max_length = 0;
+	std::array<Keyword, size> slots {};
+
+	constexpr size_t hash(std::string_view s) const
+	{
+		return (s.length() + (uint8_t)s.front() * first_multiplier + (uint8_t)s.back() * last_multiplier) % size;
 	}
 };
 
+constexpr KeywordTable build_keyword_table()
+{
+	for (uint8_t first = 1; first < 64; ++first) {
+		for (uint8_t last = 0; last < 64; ++last) {
+			KeywordTable table;
+			table.first_multiplier = first;
+			table.last_multiplier = last;
+
+			bool collides = false;
+			for (auto& keyword : keywords) {
+				auto& slot = table.slots[table.hash(keyword.text)];
+				if (!slot.text.empty()) {
+					collides = true;
+					break;
+				}
+				slot = keyword;
+				table.min_length = std::min(table.min_length, keyword.text.length());
+				table.max_length = std::max(table.max_length, keyword.text.length());
+			}
+
+			if (!collides)
+				return table;
+		}
+	}
+	throw "No perfect hash found for the keywords";
+}
+
+constexpr KeywordTable keyword_table = build_keyword_table();
+
+constexpr Token::Type keyword_or_identifier(std::string_view s)
+{
+	if (s.length() < keyword_table.min_length || s.length() > keyword_table.max_length)
+		return Token::Type::Identifier;
+
+	auto& slot = keyword_table.slots[keyword_table.hash(s)];
+	if (slot.text != s)
+		return Token::Type::Identifier;
+	return slot.type;
+}
+
+static_assert(keyword_or_identifier("implements") == Token::Type::Implements);
+static_assert(keyword_or_identifier("implement") == Token::Type::Identifier);
+
+/// Numbers --------------------------------------------------------------------
+
+// Decimal exponent of the first significant digit of a literal, saturated
+int64_t decimal_magnitude(std::string_view text)
+{
+	constexpr int64_t limit = 1'000'000'000;
+	int64_t magnitude = 0;
+	bool significant = false;
+	size_t i = 0;
+
+	for (; i < text.length() && GenericLexer::is_digit(text[i]); ++i) {
+		significant |= text[i] != '0';
+		magnitude += significant && magnitude < limit;
+	}
+	if (i < text.length() && text[i] == '.') {
+		for (++i; i < text.length() && GenericLexer::is_digit(text[i]); ++i) {
+			significant |= text[i] != '0';
+			magnitude -= !significant && magnitude > -limit;
+		}
+	}
+	if (i < text.length() && GenericLexer::to_lower(text[i]) == 'e') {
+		bool negative = ++i < text.length() && text[i] == '-';
+		if (i < text.length() && (text[i] == '-' || text[i] == '+'))
+			++i;
+		int64_t exponent = 0;
+		for (; i < text.length() && GenericLexer::is_digit(text[i]); ++i)
+			exponent = std::min(exponent * 10 + (text[i] - '0'), limit);
+		magnitude += negative ? -exponent : exponent;
+	}
+	return magnitude;
+}
+
+// Correctly rounded value of a decimal literal. Exponents without digits
+// are left out of the parsed prefix, as they should
+double decimal_value(std::string_view text)
+{
+	double value = 0;
+	auto result = std::from_chars(text.data(), text.data() + text.length(), value);
+	if (result.ec != std::errc::result_out_of_range)
+		return value;
+	// Out of range values are left untouched. Some standard libraries also
+	// report subnormals as such, which strtod rounds correctly
+	if (decimal_magnitude(text) > 0)
+		return HUGE_VAL;
+	return std::strtod(std::string(text.data(), result.ptr).c_str(), nullptr);
+}
+
+}
+
 // -----------------------------------------------------------------------------
 
 Lexer::Lexer(const std::string_view& source)
 : GenericLexer(source)
 {}
 
+Lexer::Lexer(std::istream& stream, size_t chunk_size)
+: GenericLexer(stream, chunk_size)
+{}
+
 Lexer::~Lexer()
 {}
 
 Token Lexer::next()
+{
+	if (!is_streaming())
+		return lex();
+
+	// Tokens (and the trivia before them) are lexed again from their start
+	// whenever they run into the end of the buffered input, after a refill
+	while (true) {
+		size_t start = m_base + m_index;
+		m_hit_end = false;
+
+		auto token = lex();
+		if (!m_hit_end || m_stream_done) {
+			m_last_token_offset = m_base + m_index - token.length;
+			return token;
+		}
+
+		m_index = start - m_base;
+		refill(std::min(start, m_last_token_offset));
+	}
+}
+
+TokenStream Lexer::tokenize_all()
+{
+	size_t thread_count = m_thread_count ? m_thread_count : std::thread::hardware_concurrency();
+	size_t remaining = tell_remaining();
+	if (thread_count < 2 || remaining < 2 * parallel_chunk_size) {
+		ASSERT(!is_streaming());
+
+		TokenStream tokens;
+		// Dense sources average a token every 3 bytes, avoid regrowing for those
+		tokens.reserve(remaining / 3 + 1);
+		lex_until(SIZE_MAX, tokens);
+		return tokens;
+	}
+
+	// A few chunks per thread, to balance uneven ones
+	size_t chunk_size = std::max(parallel_chunk_size, remaining / (thread_count * 4));
+	return tokenize_all(chunk_size, thread_count);
+}
+
+TokenStream Lexer::tokenize_all(size_t chunk_size, size_t thread_count)
+{
+	ASSERT(!is_streaming());
+
+	// Chunks start at line starts, where tokens most likely start too. They
+	// are lexed speculatively, as they may still begin within a string, a
+	// glyph or a block comment. Since lexing only depends on the index it
+	// starts from, a chunk is correct from the first token that the correct
+	// stream lexes from the same index on, see the stitching below.
+	struct Chunk
+	{
+		size_t start;
+		size_t limit;
+		TokenStream tokens;
+	};
+
+	std::vector<Chunk> chunks;
+	for (size_t start = tell(); start < m_input.length();) {
+		size_t next = Scanner::find(m_input, start + std::max<size_t>(chunk_size, 1), '\n') + 1;
+		chunks.push_back({start, next < m_input.length() ? next : SIZE_MAX, {}});
+		start = next;
+	}
+	if (chunks.size() < 2) {
+		TokenStream tokens;
+		lex_until(SIZE_MAX, tokens);
+		return tokens;
+	}
+
+	std::atomic<size_t> next_chunk = 0;
+	auto work = [&] {
+		for (size_t i; (i = next_chunk.fetch_add(1)) < chunks.size();) {
+			Lexer lexer(m_input);
+			lexer.advance_to(chunks[i].start);
+			lexer.lex_until(chunks[i].limit, chunks[i].tokens);
+		}
+	};
+
+	std::vector<std::thread> threads;
+	for (size_t i = 1; i < std::min(thread_count, chunks.size()); ++i)
+		threads.emplace_back(work);
+	work();
+	for (auto& thread : threads)
+		thread.join();
+
+	// Index of the token of `chunk` lexed from `index`, or its size if none
+	auto resume_point = [] (const Chunk& chunk, size_t index) -> size_t {
+		if (index == chunk.start)
+			return 0;
+		// Every token but the first is lexed from the end of the previous one
+		size_t low = 0, high = chunk.tokens.size() - 1;
+		while (low < high) {
+			size_t mid = (low + high) / 2;
+			size_t end = chunk.tokens.offsets[mid] + chunk.tokens.lengths[mid];
+			if (end < index)
+				low = mid + 1;
+			else
+				high = mid;
+		}
+		bool found = low < chunk.tokens.size() - 1 && chunk.tokens.offsets[low] + chunk.tokens.lengths[low] == index;
+		return found ? low + 1 : chunk.tokens.size();
+	};
+
+	TokenStream tokens;
+	size_t total = 0;
+	for (auto& chunk : chunks)
+		total += chunk.tokens.size();
+	tokens.reserve(total);
+
+	// Lexes the correct stream sequentially, until it joins a chunk's stream
+	Lexer lexer(m_input);
+	size_t index = tell();
+	bool done = false;
+	for (size_t i = 0; i < chunks.size() && !done; ++i) {
+		auto& chunk = chunks[i];
+		while (index < chunk.limit) {
+			size_t resume = resume_point(chunk, index);
+			if (resume < chunk.tokens.size()) {
+				tokens.append(chunk.tokens, resume);
+				index = chunk.tokens.offsets.back() + chunk.tokens.lengths.back();
+				done = chunk.tokens.types.back() == Token::Type::Eof;
+				break;
+			}
+
+			lexer.advance_to(index);
+			auto token = lexer.lex();
+			tokens.push_back(token, lexer.number());
+			index = token.end();
+			if (token.type == Token::Type::Eof) {
+				done = true;
+				break;
+			}
+		}
+		chunk.tokens = {};
+	}
+
+	advance_to(m_input.length());
+	return tokens;
+}
+
+size_t Lexer::relex(TokenStream& tokens, const Edit& edit)
+{
+	ASSERT(!is_streaming());
+	ASSERT(!tokens.empty() && tokens.types.back() == Token::Type::Eof);
+	ASSERT(edit.offset + edit.inserted.length() <= m_input.length());
+
+	int64_t delta = (int64_t)edit.inserted.length() - (int64_t)edit.removed;
+	size_t edit_end = edit.offset + edit.removed;
+	auto end_of = [&] (size_t i) -> size_t { return tokens.offsets[i] + tokens.lengths[i]; };
+	// Index the old token `i` was lexed from
+	auto entry_of = [&] (size_t i) -> size_t { return i == 0 ? 0 : end_of(i - 1); };
+
+	// Tokens ending far enough before the edit are kept as is
+	size_t low = 0, high = tokens.size() - 1;
+	while (low < high) {
+		size_t mid = (low + high) / 2;
+		if (end_of(mid) + max_lookahead <= edit.offset)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+	size_t first = low;
+
+	// Lex again until the new stream reaches the index an old token past the
+	// edit was lexed from, since the following tokens are then unchanged
+	TokenStream fresh;
+	size_t old = first;
+	advance_to(entry_of(first));
+	while (true) {
+		while (old < tokens.size() && (int64_t)entry_of(old) + delta < (int64_t)tell())
+			++old;
+		if (old < tokens.size() && entry_of(old) >= edit_end && (int64_t)entry_of(old) + delta == (int64_t)tell())
+			break;
+
+		auto token = lex();
+		fresh.push_back(token, m_number);
+		if (token.type == Token::Type::Eof) {
+			old = tokens.size();
+			break;
+		}
+	}
+
+	if (delta != 0)
+		tokens.shift(old, (uint32_t)delta);
+	tokens.replace(first, old, fresh);
+	return fresh.size();
+}
+
+void Lexer::lex_until(size_t limit, TokenStream& tokens)
+{
+	while (true) {
+		auto token = lex();
+		tokens.push_back(token, m_number);
+		if (token.type == Token::Type::Eof || token.end() >= limit)
+			break;
+	}
+}
+
+Token Lexer::lex()
 {
 	// Skip whitespaces and comments
 	while (true) {
-		ignore_while(isspace);
+		ignore_whitespace();
 		if (next_is(inline_comment_start))
 			ignore_line();
 		else if (next_is(block_comment_start))
@@ -146,18 +524,12 @@ Token Lexer::next()
 	}
 
 	// Identifiers
-	if (next_is(is_identifier_start)) {
-		auto token = make_token(Token::Type::Identifier, [this] {
-			return consume_while(is_identifier_body);
-		});
-		auto it = keywords.find(token.trivia);
-		if (it != keywords.end())
-			token.type = it->second;
-		return token;
+	if (next_is(is_identifier_start) || (next_is(is_non_ascii) && peek_utf8_sequence() > 0)) {
+		return lex_identifier();
 	}
 
 	// Numbers
-	if (next_is(isdigit) || (next_is('.') && isdigit(peek(1)))) {
+	if (next_is(is_digit) || (next_is('.') && is_digit(peek(1)))) {
 		return lex_number();
 	}
 
@@ -172,97 +544,153 @@ Token Lexer::next()
 	}
 
 	// Operators
-	if (next_is(ispunct)) {
-		return make_token([this] {
-			return descend_operator_tree(operator_tree_root);
-		});
+	return lex_operator();
+}
+
+Token Lexer::lex_identifier()
+{
+	size_t start = tell();
+	while (true) {
+		ignore_while(is_identifier_body);
+		// Only non-ASCII bytes take the slow path
+		if (!next_is(is_non_ascii))
+			break;
+		size_t length = peek_utf8_sequence();
+		if (length == 0)
+			break;
+		ignore(length);
 	}
 
-	return make_token(Token::Type::Unknown);
+	auto token = make_token(Token::Type::Identifier, start);
+	token.type = keyword_or_identifier(text(token));
+	return token;
 }
 
 Token Lexer::lex_number()
 {
-	static auto base_digits = "0123456789abcdef";
-	static const std::unordered_map<char, int> base_prefixes = {
-		{ 'b',  2 },
-		{ 'o',  8 },
-		{ 'x', 16 },
-	};
+	size_t start = tell();
 
-	int base = 10;
-	auto start_index = tell();
-	auto start_position = position();
+	// Radix prefixes, digits are packed as bits then rounded once
+	if (next_is('0')) {
+		unsigned bits = 0;
+		switch (to_lower(peek(1))) {
+			case 'b': bits = 1; break;
+			case 'o': bits = 3; break;
+			case 'x': bits = 4; break;
+		}
+		if (bits != 0) {
+			ignore(2);
 
-	if (next_is(isdigit)) {
-		if (consume_specific('0') && base_prefixes.contains(tolower(peek())))
-			base = base_prefixes.at(consume());
-		for (; !is_eof(); ignore(1)) {
-			auto p = strchr(base_digits, tolower(peek()));
-			if (p == nullptr)
-				break;
-			int digit = p - base_digits;
-			if (digit >= base)
-				break;
+			uint64_t mantissa = 0;
+			int exponent = 0;
+			bool sticky = false;
+			for (uint8_t digit; !is_eof() && (digit = digit_value(peek())) < (1u << bits); ignore(1)) {
+				if ((mantissa >> (64 - bits)) == 0) {
+					mantissa = mantissa << bits | digit;
+				} else {
+					// At least 62 significant bits are kept, the others only
+					// matter to break ties
+					exponent += bits;
+					sticky |= digit != 0;
+				}
+			}
+			m_number = std::ldexp((double)(mantissa | sticky), exponent);
+			return make_token(Token::Type::Number, start);
 		}
 	}
 
-	if (base == 10) {
-		if (consume_specific('.')) {
-			ignore_while(isdigit);
-		}
+	// Decimal integers of up to 19 digits are exact, and converted once
+	uint64_t mantissa = 0;
+	size_t digits_start = tell();
+	for (uint8_t digit; !is_eof() && (digit = digit_value(peek())) < 10; ignore(1))
+		mantissa = mantissa * 10 + digit;
+	bool is_integer = tell() - digits_start <= 19;
 
-		if (tolower(peek()) == 'e') {
-			ignore();
-			consume_specific('+') || consume_specific('-');
-			ignore_while(isdigit);
-		}
+	if (consume_specific('.')) {
+		ignore_while(is_digit);
+		is_integer = false;
 	}
 
-	return {
-		m_input.substr(start_index, tell() - start_index),
-		start_position,
-		position(),
-		Token::Type::Number
-	};
+	if (to_lower(peek()) == 'e') {
+		ignore();
+		consume_specific('+') || consume_specific('-');
+		ignore_while(is_digit);
+		is_integer = false;
+	}
+
+	auto token = make_token(Token::Type::Number, start);
+	m_number = is_integer ? (double)mantissa : decimal_value(text(token));
+	return token;
 }
 
 Token Lexer::lex_glyph()
 {
-	return make_token([this] {
-		ignore(1);
-		auto start = tell();
-		for (; !is_eof() && !next_is('\n') && !next_is('\''); ignore(1)) {
-			if (next_is("\\'"))
-				ignore(2);
-		}
-		return consume_specific('\'')
-			? std::make_pair(Token::Type::Glyph, m_input.substr(start, tell() - start - 1))
-			: std::make_pair(Token::Type::UnterminatedGlyph, std::string_view {});
-	});
+	size_t start = tell();
+	ignore(1);
+	for (; !is_eof() && !next_is('\n') && !next_is('\''); ignore(1)) {
+		// Escaped characters are skipped, but not line breaks
+		if (next_is('\\') && peek(1) != '\n')
+			ignore(1);
+	}
+	return make_token(consume_specific('\'') ? Token::Type::Glyph : Token::Type::UnterminatedGlyph, start);
 }
 
 Token Lexer::lex_string()
 {
-	return make_token([this] {
-		ignore(1);
-		auto start = tell();
-		for (; !is_eof() && !next_is('"'); ignore(1)) {
-			if (next_is("\\\""))
-				ignore(2);
+	size_t start = tell();
+	uint8_t flags = Token::Verbatim;
+	ignore(1);
+	while (true) {
+		advance_to(Scanner::find_first_of(m_input, tell(), '"', '\\'));
+		if (is_eof() || next_is('"'))
+			break;
+		// Escaped characters are skipped, whichever they are
+		flags &= ~Token::Verbatim;
+		ignore(2);
+	}
+
+	auto token = make_token(consume_specific('"') ? Token::Type::String : Token::Type::UnterminatedString, start);
+	token.flags = flags;
+	return token;
+}
+
+Token Lexer::lex_operator()
+{
+	size_t start = tell();
+	uint8_t state = operator_table.roots[(uint8_t)peek()];
+	if (state == 0)
+		return make_token(Token::Type::Unknown);
+
+	size_t length = 1;
+	while (true) {
+		auto& current = operator_table.states[state];
+		auto c = peek(length);
+		uint8_t next = 0;
+		for (size_t i = 0; i < current.edge_count; ++i) {
+			auto& edge = operator_table.edges[current.first_edge + i];
+			if (edge.c == c) {
+				next = edge.target;
+				break;
+			}
 		}
-		return consume_specific('"')
-			? std::make_pair(Token::Type::String, m_input.substr(start, tell() - start - 1))
-			: std::make_pair(Token::Type::UnterminatedString, std::string_view {});
-	});
+		if (next == 0)
+			break;
+		state = next;
+		++length;
+	}
+
+	ignore(length);
+	return make_token(operator_table.states[state].type, start);
 }
 
-std::pair<Token::Type, std::string_view> Lexer::descend_operator_tree(const OperatorTreeNode& node, size_t level)
+std::string Lexer::describe(const Token& token) const
 {
-	auto it = node.children.find(peek(level));
-	if (it == node.children.end())
-		return std::make_pair(node.type, consume(std::max(1UL, level)));
-	return descend_operator_tree(it->second, level + 1);
+	return fmt::format("{}(\"{}\")[{}->{}]",
+		token.type_to_string(),
+		text(token),
+		position_of(token.offset),
+		position_of(token.end())
+	);
 }
 
 }
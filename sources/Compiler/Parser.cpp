@@ -7,8 +7,13 @@
 #include "Bax/Compiler/Parser.hpp"
 #include "Common/Assertions.hpp"
 #include "Common/Log.hpp"
+#include "Common/Nesting.hpp"
+#include "Common/UTF8.hpp"
+#include <algorithm>
 #include <iostream>
-#include <sstream>
+#include <type_traits>
+#include <unordered_set>
+#include <utility>
 
 // -----------------------------------------------------------------------------
 
@@ -20,71 +25,101 @@
 namespace Bax
 {
 
-#define PREFIX(F) [] (Parser* p, const Token& t) { return p->F(t); }
-#define INFIX(F) [] (Parser* p, const Token& t, Ptr<AST::Expression> l) { return p->F(t, l); }
-
-const std::unordered_map<Token::Type, Parser::GrammarRule> Parser::grammar_rules = {
-	{ Token::Type::Ampersand,                { Precedence::BitwiseAnd,  Associativity::Left,  nullptr,            INFIX(binary)     } },
-	{ Token::Type::AmpersandAmpersand,       { Precedence::BooleanAnd,  Associativity::Left,  nullptr,            INFIX(binary)     } },
-	{ Token::Type::AmpersandAmpersandEquals, { Precedence::Assigns,     Associativity::Right, nullptr,            INFIX(assignment) } },
-	{ Token::Type::AmpersandEquals,          { Precedence::Assigns,     Associativity::Right, nullptr,            INFIX(assignment) } },
-	{ Token::Type::Asterisk,                 { Precedence::Factors,     Associativity::Left,  nullptr,            INFIX(binary)     } },
-	{ Token::Type::AsteriskAsterisk,         { Precedence::Power,       Associativity::Right, nullptr,            INFIX(binary)     } },
-	{ Token::Type::AsteriskAsteriskEquals,   { Precedence::Assigns,     Associativity::Right, nullptr,            INFIX(assignment) } },
-	{ Token::Type::AsteriskEquals,           { Precedence::Assigns,     Associativity::Right, nullptr,            INFIX(assignment) } },
-	{ Token::Type::Backslash,                { Precedence::Properties,  Associativity::Left,  nullptr,            INFIX(member)     } },
-	{ Token::Type::Caret,                    { Precedence::BitwiseXor,  Associativity::Left,  nullptr,            INFIX(binary)     } },
-	{ Token::Type::CaretEquals,              { Precedence::Assigns,     Associativity::Right, nullptr,            INFIX(assignment) } },
-	{ Token::Type::ColonColon,               { Precedence::Properties,  Associativity::Left,  nullptr,            INFIX(member)     } },
-	{ Token::Type::Dot,                      { Precedence::Properties,  Associativity::Left,  nullptr,            INFIX(member)     } },
-	{ Token::Type::Equals,                   { Precedence::Assigns,     Associativity::Right, nullptr,            INFIX(assignment) } },
-	{ Token::Type::EqualsEquals,             { Precedence::Equalities,  Associativity::Left,  nullptr,            INFIX(binary)     } },
-	{ Token::Type::Exclamation,              { Precedence::Unaries,     Associativity::Right, PREFIX(unary),      nullptr           } },
-	{ Token::Type::ExclamationEquals,        { Precedence::Equalities,  Associativity::Left,  nullptr,            INFIX(binary)     } },
-	{ Token::Type::False,                    { Precedence::Lowest,      Associativity::Right, PREFIX(boolean),    nullptr           } },
-	{ Token::Type::Function,                 { Precedence::Lowest,      Associativity::Right, PREFIX(function),   nullptr           } },
-	{ Token::Type::Glyph,                    { Precedence::Lowest,      Associativity::Right, PREFIX(glyph),      nullptr           } },
-	{ Token::Type::Greater,                  { Precedence::Comparisons, Associativity::Left,  nullptr,            INFIX(binary)     } },
-	{ Token::Type::GreaterEquals,            { Precedence::Comparisons, Associativity::Left,  nullptr,            INFIX(binary)     } },
-	{ Token::Type::GreaterGreater,           { Precedence::Shifts,      Associativity::Left,  nullptr,            INFIX(binary)     } },
-	{ Token::Type::GreaterGreaterEquals,     { Precedence::Assigns,     Associativity::Right, nullptr,            INFIX(assignment) } },
-	{ Token::Type::Identifier,               { Precedence::Lowest,      Associativity::Right, PREFIX(identifier), nullptr           } },
-	{ Token::Type::LeftBrace,                { Precedence::Properties,  Associativity::Right, PREFIX(object),     nullptr           } },
-	{ Token::Type::LeftBracket,              { Precedence::Properties,  Associativity::Left,  PREFIX(array),      INFIX(subscript)  } },
-	{ Token::Type::LeftParenthesis,          { Precedence::Properties,  Associativity::Left,  PREFIX(group),      INFIX(call)       } },
-	{ Token::Type::Less,                     { Precedence::Comparisons, Associativity::Left,  nullptr,            INFIX(binary)     } },
-	{ Token::Type::LessEquals,               { Precedence::Comparisons, Associativity::Left,  nullptr,            INFIX(binary)     } },
-	{ Token::Type::LessLess,                 { Precedence::Shifts,      Associativity::Left,  nullptr,            INFIX(binary)     } },
-	{ Token::Type::LessLessEquals,           { Precedence::Assigns,     Associativity::Right, nullptr,            INFIX(assignment) } },
-	{ Token::Type::Minus,                    { Precedence::Terms,       Associativity::Left,  PREFIX(unary),      INFIX(binary)     } },
-	{ Token::Type::Match,                    { Precedence::Lowest,      Associativity::Right, PREFIX(match),      nullptr           } },
-	{ Token::Type::MinusEquals,              { Precedence::Assigns,     Associativity::Right, nullptr,            INFIX(assignment) } },
-	{ Token::Type::MinusMinus,               { Precedence::Updates,     Associativity::Right, PREFIX(update),     INFIX(update)     } },
-	{ Token::Type::Null,                     { Precedence::Lowest,      Associativity::Right, PREFIX(null),       nullptr           } },
-	{ Token::Type::Number,                   { Precedence::Lowest,      Associativity::Right, PREFIX(number),     nullptr           } },
-	{ Token::Type::Percent,                  { Precedence::Factors,     Associativity::Left,  nullptr,            INFIX(binary)     } },
-	{ Token::Type::PercentEquals,            { Precedence::Assigns,     Associativity::Right, nullptr,            INFIX(assignment) } },
-	{ Token::Type::Pipe,                     { Precedence::BitwiseOr,   Associativity::Left,  nullptr,            INFIX(binary)     } },
-	{ Token::Type::PipeEquals,               { Precedence::Assigns,     Associativity::Right, nullptr,            INFIX(assignment) } },
-	{ Token::Type::PipePipe,                 { Precedence::BooleanOr,   Associativity::Left,  nullptr,            INFIX(binary)     } },
-	{ Token::Type::PipePipeEquals,           { Precedence::Assigns,     Associativity::Right, nullptr,            INFIX(assignment) } },
-	{ Token::Type::Plus,                     { Precedence::Terms,       Associativity::Left,  PREFIX(unary),      INFIX(binary)     } },
-	{ Token::Type::PlusEquals,               { Precedence::Assigns,     Associativity::Right, nullptr,            INFIX(assignment) } },
-	{ Token::Type::PlusPlus,                 { Precedence::Updates,     Associativity::Right, PREFIX(update),     INFIX(update)     } },
-	{ Token::Type::Question,                 { Precedence::Ternary,     Associativity::Right, nullptr,            INFIX(ternary)    } },
-	{ Token::Type::QuestionColon,            { Precedence::Coalesce,    Associativity::Right, nullptr,            INFIX(binary)     } },
-	{ Token::Type::QuestionDot,              { Precedence::Properties,  Associativity::Left,  nullptr,            INFIX(member)     } },
-	{ Token::Type::QuestionQuestion,         { Precedence::Coalesce,    Associativity::Left,  nullptr,            INFIX(binary)     } },
-	{ Token::Type::QuestionQuestionEquals,   { Precedence::Assigns,     Associativity::Right, nullptr,            INFIX(assignment) } },
-	{ Token::Type::Slash,                    { Precedence::Factors,     Associativity::Left,  nullptr,            INFIX(binary)     } },
-	{ Token::Type::SlashEquals,              { Precedence::Assigns,     Associativity::Right, nullptr,            INFIX(assignment) } },
-	{ Token::Type::String,                   { Precedence::Lowest,      Associativity::Right, PREFIX(string),     nullptr           } },
-	{ Token::Type::Tilde,                    { Precedence::Unaries,     Associativity::Right, PREFIX(unary),      nullptr           } },
-	{ Token::Type::True,                     { Precedence::Lowest,      Associativity::Right, PREFIX(boolean),    nullptr           } },
-};
+#define PREFIX(F) &Parser::prefix<&Parser::F>
+#define INFIX(F) &Parser::infix<&Parser::F>
+#define BUILD(F) &Parser::F
+#define OP(NODE, OPERATOR) static_cast<uint8_t>(AST::NODE##Expression::Operators::OPERATOR)
+
+constexpr Parser::GrammarRules Parser::make_grammar_rules()
+{
+	constexpr std::pair<Token::Type, GrammarRule> rules[] = {
+		{ Token::Type::Ampersand,                { Precedence::BitwiseAnd,  Associativity::Left,  nullptr,            0,                     nullptr,           OP(Binary, BitwiseAnd),            BUILD(binary)     } },
+		{ Token::Type::AmpersandAmpersand,       { Precedence::BooleanAnd,  Associativity::Left,  nullptr,            0,                     nullptr,           OP(Binary, BooleanAnd),            BUILD(binary)     } },
+		{ Token::Type::AmpersandAmpersandEquals, { Precedence::Assigns,     Associativity::Right, nullptr,            0,                     nullptr,           OP(Assignment, BooleanAnd),        BUILD(assignment) } },
+		{ Token::Type::AmpersandEquals,          { Precedence::Assigns,     Associativity::Right, nullptr,            0,                     nullptr,           OP(Assignment, BitwiseAnd),        BUILD(assignment) } },
+		{ Token::Type::Asterisk,                 { Precedence::Factors,     Associativity::Left,  nullptr,            0,                     nullptr,           OP(Binary, Multiply),              BUILD(binary)     } },
+		{ Token::Type::AsteriskAsterisk,         { Precedence::Power,       Associativity::Right, nullptr,            0,                     nullptr,           OP(Binary, Power),                 BUILD(binary)     } },
+		{ Token::Type::AsteriskAsteriskEquals,   { Precedence::Assigns,     Associativity::Right, nullptr,            0,                     nullptr,           OP(Assignment, Power),             BUILD(assignment) } },
+		{ Token::Type::AsteriskEquals,           { Precedence::Assigns,     Associativity::Right, nullptr,            0,                     nullptr,           OP(Assignment, Multiply),          BUILD(assignment) } },
+		{ Token::Type::Backslash,                { Precedence::Properties,  Associativity::Left,  nullptr,            0,                     INFIX(member),     OP(Member, Namespace),             nullptr           } },
+		{ Token::Type::Caret,                    { Precedence::BitwiseXor,  Associativity::Left,  nullptr,            0,                     nullptr,           OP(Binary, BitwiseXor),            BUILD(binary)     } },
+		{ Token::Type::CaretEquals,              { Precedence::Assigns,     Associativity::Right, nullptr,            0,                     nullptr,           OP(Assignment, BitwiseXor),        BUILD(assignment) } },
+		{ Token::Type::ColonColon,               { Precedence::Properties,  Associativity::Left,  nullptr,            0,                     INFIX(member),     OP(Member, Static),                nullptr           } },
+		{ Token::Type::Dot,                      { Precedence::Properties,  Associativity::Left,  nullptr,            0,                     INFIX(member),     OP(Member, Member),                nullptr           } },
+		{ Token::Type::Equals,                   { Precedence::Assigns,     Associativity::Right, nullptr,            0,                     nullptr,           OP(Assignment, Assign),            BUILD(assignment) } },
+		{ Token::Type::EqualsEquals,             { Precedence::Equalities,  Associativity::Left,  nullptr,            0,                     nullptr,           OP(Binary, Equals),                BUILD(binary)     } },
+		{ Token::Type::Exclamation,              { Precedence::Unaries,     Associativity::Right, PREFIX(unary),      OP(Unary, BooleanNot), nullptr,           0,                                 nullptr           } },
+		{ Token::Type::ExclamationEquals,        { Precedence::Equalities,  Associativity::Left,  nullptr,            0,                     nullptr,           OP(Binary, Inequals),              BUILD(binary)     } },
+		{ Token::Type::False,                    { Precedence::Lowest,      Associativity::Right, PREFIX(boolean),    0,                     nullptr,           0,                                 nullptr           } },
+		{ Token::Type::Function,                 { Precedence::Lowest,      Associativity::Right, PREFIX(function),   0,                     nullptr,           0,                                 nullptr           } },
+		{ Token::Type::Glyph,                    { Precedence::Lowest,      Associativity::Right, PREFIX(glyph),      0,                     nullptr,           0,                                 nullptr           } },
+		{ Token::Type::Greater,                  { Precedence::Comparisons, Associativity::Left,  nullptr,            0,                     nullptr,           OP(Binary, GreaterThan),           BUILD(binary)     } },
+		{ Token::Type::GreaterEquals,            { Precedence::Comparisons, Associativity::Left,  nullptr,            0,                     nullptr,           OP(Binary, GreaterThanOrEquals),   BUILD(binary)     } },
+		{ Token::Type::GreaterGreater,           { Precedence::Shifts,      Associativity::Left,  nullptr,            0,                     nullptr,           OP(Binary, BitwiseRightShift),     BUILD(binary)     } },
+		{ Token::Type::GreaterGreaterEquals,     { Precedence::Assigns,     Associativity::Right, nullptr,            0,                     nullptr,           OP(Assignment, BitwiseRightShift), BUILD(assignment) } },
+		{ Token::Type::Identifier,               { Precedence::Lowest,      Associativity::Right, PREFIX(identifier), 0,                     nullptr,           0,                                 nullptr           } },
+		{ Token::Type::LeftBrace,                { Precedence::Properties,  Associativity::Right, PREFIX(object),     0,                     nullptr,           0,                                 nullptr           } },
+		{ Token::Type::LeftBracket,              { Precedence::Properties,  Associativity::Left,  PREFIX(array),      0,                     INFIX(subscript),  0,                                 nullptr           } },
+		{ Token::Type::LeftParenthesis,          { Precedence::Properties,  Associativity::Left,  PREFIX(group),      0,                     INFIX(call),       0,                                 nullptr           } },
+		{ Token::Type::Less,                     { Precedence::Comparisons, Associativity::Left,  nullptr,            0,                     nullptr,           OP(Binary, LessThan),              BUILD(binary)     } },
+		{ Token::Type::LessEquals,               { Precedence::Comparisons, Associativity::Left,  nullptr,            0,                     nullptr,           OP(Binary, LessThanOrEquals),      BUILD(binary)     } },
+		{ Token::Type::LessLess,                 { Precedence::Shifts,      Associativity::Left,  nullptr,            0,                     nullptr,           OP(Binary, BitwiseLeftShift),      BUILD(binary)     } },
+		{ Token::Type::LessLessEquals,           { Precedence::Assigns,     Associativity::Right, nullptr,            0,                     nullptr,           OP(Assignment, BitwiseLeftShift),  BUILD(assignment) } },
+		{ Token::Type::Minus,                    { Precedence::Terms,       Associativity::Left,  PREFIX(unary),      OP(Unary, Negative),   nullptr,           OP(Binary, Substract),             BUILD(binary)     } },
+		{ Token::Type::Match,                    { Precedence::Lowest,      Associativity::Right, PREFIX(match),      0,                     nullptr,           0,                                 nullptr           } },
+		{ Token::Type::MinusEquals,              { Precedence::Assigns,     Associativity::Right, nullptr,            0,                     nullptr,           OP(Assignment, Substract),         BUILD(assignment) } },
+		{ Token::Type::MinusMinus,               { Precedence::Updates,     Associativity::Right, PREFIX(update),     OP(Update, Decrement), INFIX(update),     OP(Update, Decrement),             nullptr           } },
+		{ Token::Type::Null,                     { Precedence::Lowest,      Associativity::Right, PREFIX(null),       0,                     nullptr,           0,                                 nullptr           } },
+		{ Token::Type::Number,                   { Precedence::Lowest,      Associativity::Right, PREFIX(number),     0,                     nullptr,           0,                                 nullptr           } },
+		{ Token::Type::Percent,                  { Precedence::Factors,     Associativity::Left,  nullptr,            0,                     nullptr,           OP(Binary, Modulo),                BUILD(binary)     } },
+		{ Token::Type::PercentEquals,            { Precedence::Assigns,     Associativity::Right, nullptr,            0,                     nullptr,           OP(Assignment, Modulo),            BUILD(assignment) } },
+		{ Token::Type::Pipe,                     { Precedence::BitwiseOr,   Associativity::Left,  nullptr,            0,                     nullptr,           OP(Binary, BitwiseOr),             BUILD(binary)     } },
+		{ Token::Type::PipeEquals,               { Precedence::Assigns,     Associativity::Right, nullptr,            0,                     nullptr,           OP(Assignment, BitwiseOr),         BUILD(assignment) } },
+		{ Token::Type::PipePipe,                 { Precedence::BooleanOr,   Associativity::Left,  nullptr,            0,                     nullptr,           OP(Binary, BooleanOr),             BUILD(binary)     } },
+		{ Token::Type::PipePipeEquals,           { Precedence::Assigns,     Associativity::Right, nullptr,            0,                     nullptr,           OP(Assignment, BooleanOr),         BUILD(assignment) } },
+		{ Token::Type::Plus,                     { Precedence::Terms,       Associativity::Left,  PREFIX(unary),      OP(Unary, Positive),   nullptr,           OP(Binary, Add),                   BUILD(binary)     } },
+		{ Token::Type::PlusEquals,               { Precedence::Assigns,     Associativity::Right, nullptr,            0,                     nullptr,           OP(Assignment, Add),               BUILD(assignment) } },
+		{ Token::Type::PlusPlus,                 { Precedence::Updates,     Associativity::Right, PREFIX(update),     OP(Update, Increment), INFIX(update),     OP(Update, Increment),             nullptr           } },
+		{ Token::Type::Question,                 { Precedence::Ternary,     Associativity::Right, nullptr,            0,                     INFIX(ternary),    0,                                 nullptr           } },
+		{ Token::Type::QuestionColon,            { Precedence::Coalesce,    Associativity::Right, nullptr,            0,                     nullptr,           OP(Binary, Ternary),               BUILD(binary)     } },
+		{ Token::Type::QuestionDot,              { Precedence::Properties,  Associativity::Left,  nullptr,            0,                     INFIX(member),     OP(Member, Nullsafe),              nullptr           } },
+		{ Token::Type::QuestionQuestion,         { Precedence::Coalesce,    Associativity::Left,  nullptr,            0,                     nullptr,           OP(Binary, Coalesce),              BUILD(binary)     } },
+		{ Token::Type::QuestionQuestionEquals,   { Precedence::Assigns,     Associativity::Right, nullptr,            0,                     nullptr,           OP(Assignment, Coalesce),          BUILD(assignment) } },
+		{ Token::Type::Slash,                    { Precedence::Factors,     Associativity::Left,  nullptr,            0,                     nullptr,           OP(Binary, Divide),                BUILD(binary)     } },
+		{ Token::Type::SlashEquals,              { Precedence::Assigns,     Associativity::Right, nullptr,            0,                     nullptr,           OP(Assignment, Divide),            BUILD(assignment) } },
+		{ Token::Type::String,                   { Precedence::Lowest,      Associativity::Right, PREFIX(string),     0,                     nullptr,           0,                                 nullptr           } },
+		{ Token::Type::Tilde,                    { Precedence::Unaries,     Associativity::Right, PREFIX(unary),      OP(Unary, BitwiseNot), nullptr,           0,                                 nullptr           } },
+		{ Token::Type::True,                     { Precedence::Lowest,      Associativity::Right, PREFIX(boolean),    0,                     nullptr,           0,                                 nullptr           } },
+	};
+
+	GrammarRules table;
+	for (auto& [type, rule] : rules)
+		table[static_cast<size_t>(type)] = rule;
+	return table;
+}
 
 #undef PREFIX
 #undef INFIX
+#undef BUILD
+#undef OP
+
+constinit const Parser::GrammarRules Parser::grammar_rules = Parser::make_grammar_rules();
+
+template <auto Parse>
+Ptr<AST::Expression> Parser::prefix(const Token& token)
+{
+	// Prefix updates share their parsing function with postfix ones
+	if constexpr (std::is_invocable_v<decltype(Parse), Parser*, const Token&>)
+		return (this->*Parse)(token);
+	else
+		return (this->*Parse)(token, nullptr);
+}
+
+template <auto Parse>
+Ptr<AST::Expression> Parser::infix(const Token& token, Ptr<AST::Expression> lhs)
+{
+	return (this->*Parse)(token, std::move(lhs));
+}
 
 const std::array<Token::Type, 4> Parser::declaration_tokens = {
 	Token::Type::Class,
@@ -102,16 +137,60 @@ const std::array<Token::Type, 6> Parser::statement_tokens = {
 	Token::Type::While,
 };
 
+const std::array<Token::Type, 6> Parser::synchronization_tokens = {
+	Token::Type::Const,
+	Token::Type::If,
+	Token::Type::Let,
+	Token::Type::Return,
+	Token::Type::Static,
+	Token::Type::While,
+};
+
 // -----------------------------------------------------------------------------
 
-Parser::Parser(Lexer lexer)
+Parser::Parser(Lexer lexer, StringPool& strings, SymbolTable& symbols, Arena& nodes)
 : m_lexer(std::move(lexer))
-, m_current_token(m_lexer.next())
-{}
+, m_strings(strings)
+, m_symbols(symbols)
+, m_nodes(nodes)
+{
+	if (!m_lexer.is_streaming()) {
+		m_tokens = m_lexer.tokenize_all();
+
+		// Unescaped literals are never longer than their source, they all fit
+		// in a single allocation
+		size_t escaped = 0;
+		for (size_t i = 0; i < m_tokens.size(); ++i) {
+			if (m_tokens.types[i] == Token::Type::String && !(m_tokens.flags[i] & Token::Verbatim))
+				escaped += m_tokens.lengths[i];
+		}
+		m_strings.reserve(escaped);
+	}
+	m_current_token = next_token();
+}
 
 Parser::~Parser()
 {}
 
+Token Parser::next_token()
+{
+	if (m_tokens.empty()) {
+		auto token = m_lexer.next();
+		if (token.type == Token::Type::Number)
+			m_current_number = m_lexer.number();
+		return token;
+	}
+
+	// Keep returning the final Eof token once reached
+	if (m_cursor + 1 >= m_tokens.size())
+		return m_tokens[m_cursor];
+
+	auto token = m_tokens[m_cursor++];
+	if (token.type == Token::Type::Number)
+		m_current_number = m_tokens.numbers[m_number_cursor++];
+	return token;
+}
+
 const Token& Parser::peek() const
 {
 	return m_current_token;
@@ -125,7 +204,12 @@ bool Parser::peek(Token::Type type) const
 Token Parser::consume()
 {
 	Token t = m_current_token;
-	m_current_token = m_lexer.next();
+	m_consumed_number = m_current_number;
+	if (t.type == Token::Type::LeftBrace)
+		++m_open_braces;
+	else if (t.type == Token::Type::RightBrace && m_open_braces > 0)
+		--m_open_braces;
+	m_current_token = next_token();
 	return t;
 }
 
@@ -140,18 +224,66 @@ bool Parser::consume(Token::Type type)
 
 bool Parser::must_consume(Token::Type type)
 {
-	auto token = consume();
-	if (token.type != type) {
-		Log::error("Unexpected token {}, expected {}", token, Token::type_to_string(type));
+	// Left for `synchronize`, it may end the statement
+	if (!peek(type)) {
+		error("Unexpected token {}, expected {}", m_lexer.describe(m_current_token), Token::type_to_string(type));
 		return false;
 	}
+	consume();
 	return true;
 }
 
+void Parser::report(std::string message)
+{
+	m_diagnostics.push_back({ m_current_token.offset, std::move(message) });
+}
+
+void Parser::synchronize(size_t start, size_t open_braces)
+{
+	// Up to the next `;`, included, closing brace or statement keyword. The
+	// token a statement failed on without consuming anything is skipped, so
+	// that parsing always moves forward. Braces the statement opened, before
+	// failing or while skipping, are skipped up to their closing one, which
+	// must not end the enclosing block.
+	bool moved = m_current_token.offset != start;
+	size_t depth = m_open_braces - open_braces;
+	while (!peek(Token::Type::Eof) && (depth > 0 || !peek(Token::Type::RightBrace))) {
+		if (depth == 0 && moved && CONTAINS(synchronization_tokens, m_current_token.type))
+			return;
+		moved = true;
+		switch (consume().type) {
+			case Token::Type::LeftBrace:  ++depth; break;
+			case Token::Type::RightBrace: --depth; break;
+			case Token::Type::Semicolon:
+				if (depth == 0)
+					return;
+				break;
+			default: break;
+		}
+	}
+}
+
 Ptr<AST::Node> Parser::run()
 {
 	// for (Token t = consume(); t.type != Token::Type::Eof; t = consume()) Log::debug("{}", t);
-	return statement();
+	m_pending_operators.clear();
+	m_depth = 0;
+	m_open_braces = 0;
+	m_diagnostics.clear();
+
+	auto tree = statement();
+	// Whatever follows the root statement would otherwise be dropped silently
+	if (tree && !peek(Token::Type::Eof))
+		error("Unexpected token {}, expected end of file", m_lexer.describe(m_current_token));
+	return m_diagnostics.empty() ? tree : nullptr;
+}
+
+bool Parser::check_depth()
+{
+	if (m_depth <= m_max_depth)
+		return true;
+	error("Code nested deeper than {} levels at {}", m_max_depth, m_lexer.describe(m_current_token));
+	return false;
 }
 
 // -----------------------------------------------------------------------------
@@ -164,13 +296,17 @@ Ptr<AST::Declaration> Parser::declaration()
 		case Token::Type::Let:    return variable_declaration(consume());
 		case Token::Type::Static: return variable_declaration(consume());
 		default:
-			Log::error("Unexpected token {}, expected declaration", m_current_token);
+			error("Unexpected token {}, expected declaration", m_lexer.describe(m_current_token));
 			return nullptr;
 	}
 }
 
 Ptr<AST::Statement> Parser::statement()
 {
+	Nesting nesting(m_depth);
+	if (!check_depth())
+		return nullptr;
+
 	switch (m_current_token.type) {
 		case Token::Type::Identifier: return expression_statement(peek());
 		case Token::Type::If:         return if_statement(consume());
@@ -178,7 +314,7 @@ Ptr<AST::Statement> Parser::statement()
 		case Token::Type::Return:     return return_statement(consume());
 		case Token::Type::While:      return while_statement(consume());
 		default:
-			Log::error("Unexpected token {}, expected statement", m_current_token);
+			error("Unexpected token {}, expected statement", m_lexer.describe(m_current_token));
 			break;
 	}
 	return nullptr;
@@ -186,66 +322,100 @@ Ptr<AST::Statement> Parser::statement()
 
 Ptr<AST::Expression> Parser::expression(Parser::Precedence prec)
 {
-	auto token = consume();
-	if (token.type == Token::Type::Eof) {
-		Log::error("Unexpected end of file, expected expression");
+	Nesting nesting(m_depth);
+	if (!check_depth())
 		return nullptr;
-	}
 
-	auto it = grammar_rules.find(token.type);
-	if (it == grammar_rules.end()) {
-		Log::error("No grammar rule for operator {}", token);
+	// Binary operators do not recurse: their left operand is pending on the
+	// stack while the right one is parsed, then they are built once an operator
+	// that binds looser, or no operator at all, comes next
+	size_t base = m_pending_operators.size();
+	auto fail = [&] {
+		m_pending_operators.resize(base);
 		return nullptr;
-	}
-	auto rule = it->second;
-	if (rule.prefix == nullptr) {
-		Log::error("Unexpected token {}, expected prefix", token);
-		return nullptr;
-	}
+	};
 
-	auto node = (rule.prefix)(this, token);
+	auto node = operand();
+	if (!node) return fail();
 
 	while (1) {
-		auto next = peek();
-		if (next.type == Token::Type::Eof)
-			break;
-		auto it_ = grammar_rules.find(next.type);
-		if (it_ == grammar_rules.end()
-		 || it_->second.precedence < prec
-		 || (it_->second.precedence == prec && it_->second.associativity == Associativity::Left)) {
-			break;
+		auto& next = peek();
+		auto& next_rule = grammar_rule(next.type);
+
+		// Precedence of the operator whose right operand is `node`
+		auto level = m_pending_operators.size() > base ? m_pending_operators.back().rule->precedence : prec;
+		if (next_rule.precedence < level
+		 || (next_rule.precedence == level && next_rule.associativity == Associativity::Left)) {
+			if (m_pending_operators.size() == base)
+				break;
+
+			auto pending = m_pending_operators.back();
+			m_pending_operators.pop_back();
+			node = (this->*pending.rule->build)(pending.token, pending.lhs, node);
+			continue;
 		}
 
-		if (it_->second.infix == nullptr) {
-			Log::error("Unexpected token {}, expected infix", next);
-			return nullptr;
+		if (next_rule.build) {
+			m_pending_operators.push_back({ consume(), &next_rule, node });
+			node = operand();
+			if (!node) return fail();
+			continue;
 		}
 
-		token = consume();
-		node = (it_->second.infix)(this, token, std::move(node));
-		if (!node) return nullptr;
+		if (next_rule.infix == nullptr) {
+			error("Unexpected token {}, expected infix", m_lexer.describe(next));
+			return fail();
+		}
+
+		auto token = consume();
+		node = (this->*next_rule.infix)(token, std::move(node));
+		if (!node) return fail();
 	}
 
 	return node;
 }
 
+Ptr<AST::Expression> Parser::operand()
+{
+	// Invalid tokens are left for `synchronize`
+	auto& token = peek();
+	if (token.type == Token::Type::Eof) {
+		error("Unexpected end of file, expected expression");
+		return nullptr;
+	}
+
+	auto& rule = grammar_rule(token.type);
+	if (rule.precedence == Precedence::None) {
+		error("No grammar rule for operator {}", m_lexer.describe(token));
+		return nullptr;
+	}
+	if (rule.prefix == nullptr) {
+		error("Unexpected token {}, expected prefix", m_lexer.describe(token));
+		return nullptr;
+	}
+
+	return (this->*rule.prefix)(consume());
+}
+
 // -----------------------------------------------------------------------------
 
 Ptr<AST::Identifier> Parser::identifier(const Token& token)
 {
-	return makeNode<AST::Identifier>(std::string(token.trivia.data(), token.trivia.length()));
+	// The table keeps its own copy of the name, even for streamed inputs
+	Symbol symbol = m_symbols.intern(m_lexer.text(token));
+	return m_nodes.make<AST::Identifier>(symbol, m_symbols.name(symbol));
 }
 
 Ptr<AST::Null> Parser::null(const Token&)
 {
-	return makeNode<AST::Null>();
+	return m_nodes.make<AST::Null>();
 }
 
 Ptr<AST::Boolean> Parser::boolean(const Token& token)
 {
 	switch (token.type) {
-		case Token::Type::False: return makeNode<AST::Boolean>(false);
-		case Token::Type::True:  return makeNode<AST::Boolean>(true);
+		case Token::Type::False: return m_nodes.make<AST::Boolean>(false);
+		case Token::Type::True:  return m_nodes.make<AST::Boolean>(true);
 		default:
 			break;
 	}
@@ -254,82 +424,62 @@ Ptr<AST::Boolean> Parser::boolean(const Token& token)
 
 Ptr<AST::Glyph> Parser::glyph(const Token& token)
 {
-	auto t = token.trivia.cbegin();
-	uint32_t value = (*t == '\\') ? parse_escape_sequence(++t) : *t;
+	// Strip the surrounding quotes
+	auto trivia = m_lexer.text(token).substr(1, token.length - 2);
+	auto t = trivia.cbegin();
+	if (t == trivia.cend()) {
+		error("Invalid empty glyph expression: {}", m_lexer.describe(token));
+		return nullptr;
+	}
 
-	if (++t != token.trivia.cend()) {
-		Log::error("Invalid multi-glyph expression: {}", token);
+	uint32_t value = (*t == '\\') ? parse_escape_sequence(++t, trivia.cend()) : *t;
+	if (++t != trivia.cend()) {
+		error("Invalid multi-glyph expression: {}", m_lexer.describe(token));
 		return nullptr;
 	}
 
-	return makeNode<AST::Glyph>(value);
+	return m_nodes.make<AST::Glyph>(value);
 }
 
 Ptr<AST::Number> Parser::number(const Token& token)
 {
-	static auto base_digits = "0123456789abcdef";
-	static const std::unordered_map<char, int> base_prefixes = {
-		{ 'b',  2 },
-		{ 'o',  8 },
-		{ 'x', 16 },
-	};
-
-	auto t = token.trivia.cbegin();
-	int base = 10;
-	double result = 0;
+	// Values are computed by the lexer, `token` was just consumed
+	ASSERT(token.type == Token::Type::Number);
+	return m_nodes.make<AST::Number>(m_consumed_number);
+}
 
-	if (isdigit(*t)) {
-		if (*t == '0' && base_prefixes.contains(*(++t))) {
-			base = base_prefixes.at(*t++);
-		}
-		for (; *t != '\0'; ++t) {
-			auto p = strchr(base_digits, tolower(*t));
-			if (p == nullptr)
-				break;
-			int digit = p - base_digits;
-			if (digit >= base)
-				break;
-			result = result * base + digit;
-		}
+Ptr<AST::String> Parser::string(const Token& token)
+{
+	// Strip the surrounding quotes
+	auto trivia = m_lexer.text(token).substr(1, token.length - 2);
+	if (token.flags & Token::Verbatim) {
+		// Streamed inputs are only buffered until the next refill
+		return m_nodes.make<AST::String>(m_lexer.is_streaming() ? m_strings.store(trivia) : trivia);
 	}
 
-	if (base == 10) {
-		if (*t == '.') {
-			int fraction = 0;
-			unsigned divider = 1;
-			for (++t; isdigit(*t); divider *= 10, ++t)
-				fraction = fraction * 10 + (*t - '0');
-			result += fraction / (double)divider;
+	// Unescaped literals are never longer than their source
+	char* data = m_strings.prepare(trivia.length());
+	size_t length = 0;
+	for (auto it = trivia.cbegin(); it != trivia.cend(); ++it) {
+		if (*it != '\\') {
+			data[length++] = *it;
+			continue;
 		}
 
-		if (tolower(*t) == 'e') {
-			++t;
-			bool is_exponent_negative = false;
-			if (*t == '+') {
-				++t;
-			} else if (*t == '-') {
-				++t;
-				is_exponent_negative = true;
+		uint32_t code_point = parse_escape_sequence(++it, trivia.cend());
+		// Characters outside of the BMP are escaped as UTF-16 surrogate pairs
+		if (is_high_surrogate(code_point) && trivia.cend() - it > 2 && it[1] == '\\' && it[2] == 'u') {
+			auto next = it + 2;
+			uint32_t low = parse_escape_sequence(next, trivia.cend());
+			if (is_low_surrogate(low)) {
+				code_point = 0x10000 + ((code_point - 0xD800) << 10) + (low - 0xDC00);
+				it = next;
 			}
-			int exponent = 0;
-			for (; isdigit(*t); ++t)
-				exponent = exponent * 10 + (*t - '0');
-			result *= pow(10, is_exponent_negative ? -exponent : exponent);
 		}
+		length += encode_utf8(code_point, data + length);
 	}
 
-	return makeNode<AST::Number>(result);
-}
-
-Ptr<AST::String> Parser::string(const Token& token)
-{
-	std::ostringstream oss;
-
-	for (auto it = token.trivia.cbegin(); it != token.trivia.cend(); ++it) {
-		oss << (*it == '\\' ? (char)parse_escape_sequence(++it) : *it);
-	}
-
-	return makeNode<AST::String>(oss.str());
+	return m_nodes.make<AST::String>(m_strings.commit(length));
 }
 
 // -----------------------------------------------------------------------------
@@ -349,70 +499,22 @@ Ptr<AST::ArrayExpression> Parser::array(const Token&)
 	}
 	MUST_CONSUME(Token::Type::RightBracket);
 
-	return makeNode<AST::ArrayExpression>(std::move(elements));
-}
-
-Ptr<AST::AssignmentExpression> Parser::assignment(const Token& token, Ptr<AST::Expression> lhs)
-{
-	static const std::unordered_map<Token::Type, AST::AssignmentExpression::Operators> assign_operators = {
-		{ Token::Type::AmpersandAmpersandEquals, AST::AssignmentExpression::Operators::BooleanAnd        },
-		{ Token::Type::AmpersandEquals,          AST::AssignmentExpression::Operators::BitwiseAnd        },
-		{ Token::Type::AsteriskAsteriskEquals,   AST::AssignmentExpression::Operators::Power             },
-		{ Token::Type::AsteriskEquals,           AST::AssignmentExpression::Operators::Multiply          },
-		{ Token::Type::CaretEquals,              AST::AssignmentExpression::Operators::BitwiseXor        },
-		{ Token::Type::Equals,                   AST::AssignmentExpression::Operators::Assign            },
-		{ Token::Type::GreaterGreaterEquals,     AST::AssignmentExpression::Operators::BitwiseLeftShift  },
-		{ Token::Type::LessLessEquals,           AST::AssignmentExpression::Operators::BitwiseRightShift },
-		{ Token::Type::MinusEquals,              AST::AssignmentExpression::Operators::Substract         },
-		{ Token::Type::PercentEquals,            AST::AssignmentExpression::Operators::Modulo            },
-		{ Token::Type::PipeEquals,               AST::AssignmentExpression::Operators::BitwiseOr         },
-		{ Token::Type::PipePipeEquals,           AST::AssignmentExpression::Operators::BooleanOr         },
-		{ Token::Type::PlusEquals,               AST::AssignmentExpression::Operators::Add               },
-		{ Token::Type::QuestionQuestionEquals,   AST::AssignmentExpression::Operators::Coalesce          },
-		{ Token::Type::SlashEquals,              AST::AssignmentExpression::Operators::Divide            },
-	};
-
-	auto rhs = expression(Precedence::Assigns);
-	if (!rhs) return nullptr;
+	return m_nodes.make<AST::ArrayExpression>(std::move(elements));
+}
 
-	return makeNode<AST::AssignmentExpression>(
-		assign_operators.at(token.type),
+Ptr<AST::Expression> Parser::assignment(const Token& token, Ptr<AST::Expression> lhs, Ptr<AST::Expression> rhs)
+{
+	return m_nodes.make<AST::AssignmentExpression>(
+		static_cast<AST::AssignmentExpression::Operators>(grammar_rule(token.type).infix_operator),
 		std::move(lhs),
 		std::move(rhs)
 	);
 }
 
-Ptr<AST::BinaryExpression> Parser::binary(const Token& token, Ptr<AST::Expression> lhs)
-{
-	static const std::unordered_map<Token::Type, AST::BinaryExpression::Operators> binary_operators = {
-		{ Token::Type::Ampersand,          AST::BinaryExpression::Operators::BitwiseAnd          },
-		{ Token::Type::AmpersandAmpersand, AST::BinaryExpression::Operators::BooleanAnd          },
-		{ Token::Type::Asterisk,           AST::BinaryExpression::Operators::Multiply            },
-		{ Token::Type::AsteriskAsterisk,   AST::BinaryExpression::Operators::Power               },
-		{ Token::Type::Caret,              AST::BinaryExpression::Operators::BitwiseXor          },
-		{ Token::Type::EqualsEquals,       AST::BinaryExpression::Operators::Equals              },
-		{ Token::Type::ExclamationEquals,  AST::BinaryExpression::Operators::Inequals            },
-		{ Token::Type::Greater,            AST::BinaryExpression::Operators::GreaterThan         },
-		{ Token::Type::GreaterEquals,      AST::BinaryExpression::Operators::GreaterThanOrEquals },
-		{ Token::Type::GreaterGreater,     AST::BinaryExpression::Operators::BitwiseRightShift   },
-		{ Token::Type::Less,               AST::BinaryExpression::Operators::LessThan            },
-		{ Token::Type::LessEquals,         AST::BinaryExpression::Operators::LessThanOrEquals    },
-		{ Token::Type::LessLess,           AST::BinaryExpression::Operators::BitwiseLeftShift    },
-		{ Token::Type::Minus,              AST::BinaryExpression::Operators::Substract           },
-		{ Token::Type::Percent,            AST::BinaryExpression::Operators::Modulo              },
-		{ Token::Type::Pipe,               AST::BinaryExpression::Operators::BitwiseOr           },
-		{ Token::Type::PipePipe,           AST::BinaryExpression::Operators::BooleanOr           },
-		{ Token::Type::Plus,               AST::BinaryExpression::Operators::Add                 },
-		{ Token::Type::QuestionColon,      AST::BinaryExpression::Operators::Ternary             },
-		{ Token::Type::QuestionQuestion,   AST::BinaryExpression::Operators::Coalesce            },
-		{ Token::Type::Slash,              AST::BinaryExpression::Operators::Divide              },
-	};
-
-	auto rhs = expression(grammar_rules.at(token.type).precedence);
-	if (!rhs) return nullptr;
-
-	return makeNode<AST::BinaryExpression>(
-		binary_operators.at(token.type),
+Ptr<AST::Expression> Parser::binary(const Token& token, Ptr<AST::Expression> lhs, Ptr<AST::Expression> rhs)
+{
+	return m_nodes.make<AST::BinaryExpression>(
+		static_cast<AST::BinaryExpression::Operators>(grammar_rule(token.type).infix_operator),
 		std::move(lhs),
 		std::move(rhs)
 	);
@@ -425,7 +527,7 @@ Ptr<AST::CallExpression> Parser::call(const Token&, Ptr<AST::Expression> lhs)
 		return nullptr;
 	MUST_CONSUME(Token::Type::RightParenthesis);
 
-	return makeNode<AST::CallExpression>(std::move(lhs), std::move(arguments));
+	return m_nodes.make<AST::CallExpression>(std::move(lhs), std::move(arguments));
 }
 
 Ptr<AST::FunctionExpression> Parser::function(const Token&)
@@ -440,12 +542,14 @@ Ptr<AST::FunctionExpression> Parser::function(const Token&)
 	auto body = block_statement(peek());
 	if (!body) return nullptr;
 
-	return makeNode<AST::FunctionExpression>(std::move(parameters), std::move(body));
+	return m_nodes.make<AST::FunctionExpression>(std::move(parameters), std::move(body));
 }
 
 Ptr<AST::Expression> Parser::group(const Token&)
 {
 	auto expr = expression();
+	// Already reported, the parenthesis would be too at every enclosing level
+	if (!expr) return nullptr;
 	MUST_CONSUME(Token::Type::RightParenthesis);
 	return expr;
 }
@@ -467,7 +571,7 @@ Ptr<AST::MatchExpression> Parser::match(const Token&)
 			Ptr<AST::Expression> expr = nullptr;
 			if (consume(Token::Type::Default)) {
 				if (has_default) {
-					Log::error("Match expression already has a 'default' expression, found other {}", m_current_token);
+					error("Match expression already has a 'default' expression, found other {}", m_lexer.describe(m_current_token));
 					return nullptr;
 				}
 				has_default = true;
@@ -492,7 +596,7 @@ Ptr<AST::MatchExpression> Parser::match(const Token&)
 	}
 	MUST_CONSUME(Token::Type::RightBrace);
 
-	return makeNode<AST::MatchExpression>(
+	return m_nodes.make<AST::MatchExpression>(
 		std::move(subject),
 		std::move(cases)
 	);
@@ -500,33 +604,21 @@ Ptr<AST::MatchExpression> Parser::match(const Token&)
 
 Ptr<AST::MemberExpression> Parser::member(const Token& token, Ptr<AST::Expression> lhs)
 {
-	static const std::unordered_map<Token::Type, AST::MemberExpression::Operators> member_operators = {
-		{ Token::Type::Backslash,   AST::MemberExpression::Operators::Namespace },
-		{ Token::Type::ColonColon,  AST::MemberExpression::Operators::Static    },
-		{ Token::Type::Dot,         AST::MemberExpression::Operators::Member    },
-		{ Token::Type::QuestionDot, AST::MemberExpression::Operators::Nullsafe  },
-	};
-
-	static const std::array<std::string, 2> allowed_lhs = {
-		"Identifier",
-		"MemberExpression",
-	};
-
-	if (!CONTAINS(allowed_lhs, lhs->class_name())) {
-		Log::error("Left-hand side of member expressions must be an identifier or another member expression, found {} instead.", lhs->class_name());
+	if (!AST::is<AST::Identifier>(lhs) && !AST::is<AST::MemberExpression>(lhs)) {
+		error("Left-hand side of member expressions must be an identifier or another member expression, found {} instead.", lhs->class_name());
 		return nullptr;
 	}
 
 	auto rhs = expression(Precedence::Properties);
 	if (!rhs) return nullptr;
 
-	if (strcmp(rhs->class_name(), "Identifier") != 0) {
-		Log::error("Right-hand side of member expressions must be an identifier, found {} instead.", rhs->class_name());
+	if (!AST::is<AST::Identifier>(rhs)) {
+		error("Right-hand side of member expressions must be an identifier, found {} instead.", rhs->class_name());
 		return nullptr;
 	}
 
-	return makeNode<AST::MemberExpression>(
-		member_operators.at(token.type),
+	return m_nodes.make<AST::MemberExpression>(
+		static_cast<AST::MemberExpression::Operators>(grammar_rule(token.type).infix_operator),
 		std::move(lhs),
 		std::move(rhs)
 	);
@@ -534,12 +626,12 @@ Ptr<AST::MemberExpression> Parser::member(const Token& token, Ptr<AST::Expressio
 
 Ptr<AST::ObjectExpression> Parser::object(const Token&)
 {
-	std::map<Ptr<AST::Identifier>, Ptr<AST::Expression>> members;
+	AST::ObjectExpression::MembersType members;
 
 	while (!peek(Token::Type::RightBrace)) {
 		auto id_token = consume();
 		if (id_token.type != Token::Type::Identifier) {
-			Log::error("Unexpected token {}, expected indentifier", id_token);
+			error("Unexpected token {}, expected indentifier", m_lexer.describe(id_token));
 			return nullptr;
 		}
 
@@ -551,21 +643,31 @@ Ptr<AST::ObjectExpression> Parser::object(const Token&)
 		auto expr = expression();
 		if (!expr) return nullptr;
 
-		members.emplace(std::move(id), std::move(expr));
+		members.emplace_back(std::move(id), std::move(expr));
 
 		if (!consume(Token::Type::Comma))
 			break;
 	}
 	MUST_CONSUME(Token::Type::RightBrace);
 
-	return makeNode<AST::ObjectExpression>(std::move(members));
+	// Keys are compared as symbols, the first one seen twice is reported
+	std::unordered_set<Symbol> keys;
+	keys.reserve(members.size());
+	for (auto& [key, value] : members) {
+		if (!keys.insert(key->symbol).second) {
+			error("Duplicate key '{}' in object expression", key->name);
+			return nullptr;
+		}
+	}
+
+	return m_nodes.make<AST::ObjectExpression>(std::move(members));
 }
 
 Ptr<AST::SubscriptExpression> Parser::subscript(const Token&, Ptr<AST::Expression> lhs)
 {
 	// Allow empty subscript expressions (eg. `expr[]`)
 	if (consume(Token::Type::RightBracket)) {
-		return makeNode<AST::SubscriptExpression>(lhs);
+		return m_nodes.make<AST::SubscriptExpression>(lhs);
 	}
 
 	auto expr = expression();
@@ -573,7 +675,7 @@ Ptr<AST::SubscriptExpression> Parser::subscript(const Token&, Ptr<AST::Expressio
 
 	MUST_CONSUME(Token::Type::RightBracket);
 
-	return makeNode<AST::SubscriptExpression>(lhs, std::move(expr));
+	return m_nodes.make<AST::SubscriptExpression>(lhs, std::move(expr));
 }
 
 Ptr<AST::TernaryExpression> Parser::ternary(const Token&, Ptr<AST::Expression> lhs)
@@ -586,7 +688,7 @@ Ptr<AST::TernaryExpression> Parser::ternary(const Token&, Ptr<AST::Expression> l
 	auto alternate = expression(Precedence::Ternary);
 	if (!alternate) return nullptr;
 
-	return makeNode<AST::TernaryExpression>(
+	return m_nodes.make<AST::TernaryExpression>(
 		std::move(lhs),
 		std::move(consequent),
 		std::move(alternate)
@@ -595,34 +697,17 @@ Ptr<AST::TernaryExpression> Parser::ternary(const Token&, Ptr<AST::Expression> l
 
 Ptr<AST::UnaryExpression> Parser::unary(const Token& token)
 {
-	static const std::unordered_map<Token::Type, AST::UnaryExpression::Operators> unary_operators = {
-		{ Token::Type::Exclamation, AST::UnaryExpression::Operators::BooleanNot },
-		{ Token::Type::Plus,        AST::UnaryExpression::Operators::Positive   },
-		{ Token::Type::Minus,       AST::UnaryExpression::Operators::Negative   },
-		{ Token::Type::Tilde,       AST::UnaryExpression::Operators::BitwiseNot },
-	};
-
 	auto rhs = expression(Precedence::Unaries);
 	if (!rhs) return nullptr;
 
-	return makeNode<AST::UnaryExpression>(
-		unary_operators.at(token.type),
+	return m_nodes.make<AST::UnaryExpression>(
+		static_cast<AST::UnaryExpression::Operators>(grammar_rule(token.type).prefix_operator),
 		std::move(rhs)
 	);
 }
 
 Ptr<AST::UpdateExpression> Parser::update(const Token& token, Ptr<AST::Expression> lhs)
 {
-	static const std::unordered_map<Token::Type, AST::UpdateExpression::Operators> update_operators = {
-		{ Token::Type::PlusPlus,   AST::UpdateExpression::Operators::Increment },
-		{ Token::Type::MinusMinus, AST::UpdateExpression::Operators::Decrement },
-	};
-
-	static const std::array<std::string, 2> allowed_expressions = {
-		"Identifier",
-		"MemberExpression",
-	};
-
 	bool is_prefix_update = false;
 
 	// `lhs` will be a `nullptr` in the case of an infix {in,de}crement.
@@ -631,8 +716,8 @@ Ptr<AST::UpdateExpression> Parser::update(const Token& token, Ptr<AST::Expressio
 		lhs = expression(Precedence::Updates);
 		if (!lhs) return nullptr;
 	}
-	if (!CONTAINS(allowed_expressions, lhs->class_name())) {
-		Log::error(
+	if (!AST::is<AST::Identifier>(lhs) && !AST::is<AST::MemberExpression>(lhs)) {
+		error(
 			"{}-hand side of update operator must be an identifier or a member expression, found {} instead.",
 			is_prefix_update ? "Right" : "Left",
 			lhs->class_name()
@@ -640,8 +725,9 @@ Ptr<AST::UpdateExpression> Parser::update(const Token& token, Ptr<AST::Expressio
 		return nullptr;
 	}
 
-	return makeNode<AST::UpdateExpression>(
-		update_operators.at(token.type),
+	auto& rule = grammar_rule(token.type);
+	return m_nodes.make<AST::UpdateExpression>(
+		static_cast<AST::UpdateExpression::Operators>(is_prefix_update ? rule.prefix_operator : rule.infix_operator),
 		std::move(lhs),
 		is_prefix_update
 	);
@@ -654,25 +740,26 @@ Ptr<AST::BlockStatement> Parser::block_statement(const Token&)
 	std::vector<Ptr<AST::Statement>> statements;
 
 	while (!peek(Token::Type::Eof) && !peek(Token::Type::RightBrace)) {
-		if (CONTAINS(declaration_tokens, m_current_token.type)) {
-			auto decl = declaration();
-			if (!decl) return nullptr;
-			statements.push_back(std::move(decl));
-		}
-		else if (CONTAINS(statement_tokens, m_current_token.type)) {
-			auto stmt = statement();
-			if (!stmt) return nullptr;
+		size_t start = m_current_token.offset;
+		size_t open_braces = m_open_braces;
+		Ptr<AST::Statement> stmt = nullptr;
+		if (CONTAINS(declaration_tokens, m_current_token.type))
+			stmt = declaration();
+		else if (CONTAINS(statement_tokens, m_current_token.type))
+			stmt = statement();
+		else
+			error("Unexpected token {}, expected statement or declaration", m_lexer.describe(m_current_token));
+
+		// Errors are recorded, the following statements are still parsed
+		if (stmt)
 			statements.push_back(std::move(stmt));
-		}
-		else {
-			Log::error("Unexpected token {}, expected statement or declaration", m_current_token);
-			return nullptr;
-		}
+		else
+			synchronize(start, open_braces);
 	}
 
 	MUST_CONSUME(Token::Type::RightBrace);
 
-	return makeNode<AST::BlockStatement>(std::move(statements));
+	return m_nodes.make<AST::BlockStatement>(std::move(statements));
 }
 
 Ptr<AST::ExpressionStatement> Parser::expression_statement(const Token&)
@@ -682,18 +769,17 @@ Ptr<AST::ExpressionStatement> Parser::expression_statement(const Token&)
 
 	MUST_CONSUME(Token::Type::Semicolon);
 
-	/// FIXME: Check against actual types, not strings
-	static const std::array<std::string, 3> allowed_expressions = {
-		"AssignmentExpression",
-		"CallExpression",
-		"UpdateExpression",
-	};
-	if (!CONTAINS(allowed_expressions, expr->class_name())) {
-		Log::error("Expression of type {} is not allowed as a statement", expr->class_name());
-		return nullptr;
+	switch (expr->kind) {
+		case AST::Kind::AssignmentExpression:
+		case AST::Kind::CallExpression:
+		case AST::Kind::UpdateExpression:
+			break;
+		default:
+			error("Expression of type {} is not allowed as a statement", expr->class_name());
+			return nullptr;
 	}
 
-	return makeNode<AST::ExpressionStatement>(std::move(expr));
+	return m_nodes.make<AST::ExpressionStatement>(std::move(expr));
 }
 
 Ptr<AST::IfStatement> Parser::if_statement(const Token&)
@@ -714,7 +800,7 @@ Ptr<AST::IfStatement> Parser::if_statement(const Token&)
 		if (!alternate) return nullptr;
 	}
 
-	return makeNode<AST::IfStatement>(
+	return m_nodes.make<AST::IfStatement>(
 		std::move(condition),
 		std::move(consequent),
 		std::move(alternate)
@@ -727,7 +813,7 @@ Ptr<AST::ReturnStatement> Parser::return_statement(const Token&)
 	if (!expr) return nullptr;
 
 	MUST_CONSUME(Token::Type::Semicolon);
-	return makeNode<AST::ReturnStatement>(std::move(expr));
+	return m_nodes.make<AST::ReturnStatement>(std::move(expr));
 }
 
 Ptr<AST::WhileStatement> Parser::while_statement(const Token&)
@@ -742,7 +828,7 @@ Ptr<AST::WhileStatement> Parser::while_statement(const Token&)
 	auto body = statement();
 	if (!body) return nullptr;
 
-	return makeNode<AST::WhileStatement>(
+	return m_nodes.make<AST::WhileStatement>(
 		std::move(condition),
 		std::move(body)
 	);
@@ -764,16 +850,15 @@ Ptr<AST::VariableDeclaration> Parser::variable_declaration(const Token& t)
 	if (token.type == Token::Type::Const)
 		is_constant = true;
 	else if (token.type != Token::Type::Let) {
-		Log::error("Unexpected token {}, expected 'let' or 'const'", token);
+		error("Unexpected token {}, expected 'let' or 'const'", m_lexer.describe(token));
 		return nullptr;
 	}
 
-	token = consume();
-	if (token.type != Token::Type::Identifier) {
-		Log::error("Unexpected token {}, expected identifier", token);
+	if (!peek(Token::Type::Identifier)) {
+		error("Unexpected token {}, expected identifier", m_lexer.describe(m_current_token));
 		return nullptr;
 	}
-	auto name = identifier(token);
+	auto name = identifier(consume());
 	if (!name) return nullptr;
 
 	MUST_CONSUME(Token::Type::Equals);
@@ -783,7 +868,7 @@ Ptr<AST::VariableDeclaration> Parser::variable_declaration(const Token& t)
 
 	MUST_CONSUME(Token::Type::Semicolon);
 
-	return makeNode<AST::VariableDeclaration>(
+	return m_nodes.make<AST::VariableDeclaration>(
 		std::move(name),
 		std::move(value),
 		is_constant,
@@ -793,9 +878,11 @@ Ptr<AST::VariableDeclaration> Parser::variable_declaration(const Token& t)
 
 // -----------------------------------------------------------------------------
 
-uint32_t Parser::parse_escape_sequence(std::string_view::const_iterator& it)
+uint32_t Parser::parse_escape_sequence(std::string_view::const_iterator& it, std::string_view::const_iterator end)
 {
 	// Assume the '\' is already skipped
+	if (it == end)
+		return *--it;
 
 	switch (*it) {
 		case 'a': return '\a';
@@ -813,20 +900,12 @@ uint32_t Parser::parse_escape_sequence(std::string_view::const_iterator& it)
 
 		case 'u': {
 			// Must be composed of exactly 4 hex characters
-			bool valid = true;
-			for (auto i = 1; i <= 4; ++i) {
-				if (!isxdigit(*(it + i))) {
-					valid = false;
-					break;
-				}
-			}
-			if (!valid)
+			if (end - it <= 4 || !std::all_of(it + 1, it + 5, GenericLexer::is_hex_digit))
 				break;
 
 			uint32_t value = 0;
-			for (++it; isxdigit(*it); ++it)
-				value = value * 16 + (tolower(*it) - (isdigit(*it) ? '0' : 'a' - 10));
-			--it;
+			for (auto i = 0; i < 4; ++i)
+				value = value * 16 + GenericLexer::digit_value(*++it);
 			return value;
 		}
 
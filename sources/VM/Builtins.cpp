@@ -0,0 +1,104 @@
+/*
+** Bax, 2021
+** Benoit Lormeau <blormeau@outlook.com>
+** Builtins.cpp
+*/
+
+#include "Bax/VM/VM.hpp"
+#include <string>
+
+// -----------------------------------------------------------------------------
+
+namespace Bax
+{
+
+namespace
+{
+
+bool print(VM& vm, Value* arguments, size_t count, Value& result)
+{
+	std::string line;
+	for (size_t i = 0; i < count; ++i) {
+		if (i)
+			line += ' ';
+		line += vm.to_string(arguments[i]);
+	}
+	std::fwrite(line.data(), 1, line.size(), vm.output());
+	result = Value::null();
+	return true;
+}
+
+bool println(VM& vm, Value* arguments, size_t count, Value& result)
+{
+	print(vm, arguments, count, result);
+	std::fputc('\n', vm.output());
+	return true;
+}
+
+// Methods, `arguments[0]` is the object they are called on
+
+bool value_to_string(VM& vm, Value* arguments, size_t, Value& result)
+{
+	result = Value::from_object(vm.make_string(vm.to_string(arguments[0])));
+	return true;
+}
+
+bool array_length(VM&, Value* arguments, size_t, Value& result)
+{
+	result = Value::from_integer(as<Array>(arguments[0])->elements.size());
+	return true;
+}
+
+bool array_push(VM&, Value* arguments, size_t count, Value& result)
+{
+	auto& elements = as<Array>(arguments[0])->elements;
+	elements.insert(elements.end(), arguments + 1, arguments + count);
+	result = Value::from_integer(elements.size());
+	return true;
+}
+
+bool array_pop(VM& vm, Value* arguments, size_t, Value& result)
+{
+	auto& elements = as<Array>(arguments[0])->elements;
+	if (elements.empty())
+		return vm.error("Cannot pop from an empty array");
+	result = elements.back();
+	elements.pop_back();
+	return true;
+}
+
+bool string_length(VM&, Value* arguments, size_t, Value& result)
+{
+	result = Value::from_integer(as<String>(arguments[0])->value.size());
+	return true;
+}
+
+}
+
+// -----------------------------------------------------------------------------
+
+void VM::define_builtins()
+{
+	define_global("print", Value::from_object(make_native("print", print)));
+	define_global("println", Value::from_object(make_native("println", println)));
+
+	auto define = [&] (Table* methods, const char* name, NativeFunction function) {
+		methods->fields[make_string(name)] = Value::from_object(make_native(name, function));
+	};
+
+	for (auto& methods : m_value_methods) {
+		methods = make_table();
+		define(methods, "toString", value_to_string);
+	}
+	for (auto& methods : m_object_methods) {
+		methods = make_table();
+		define(methods, "toString", value_to_string);
+	}
+
+	define(m_object_methods[static_cast<size_t>(Object::Type::Array)], "length", array_length);
+	define(m_object_methods[static_cast<size_t>(Object::Type::Array)], "push", array_push);
+	define(m_object_methods[static_cast<size_t>(Object::Type::Array)], "pop", array_pop);
+	define(m_object_methods[static_cast<size_t>(Object::Type::String)], "length", string_length);
+}
+
+}
@@ -0,0 +1,24 @@
+/*
+** Bax, 2021
+** Benoit Lormeau <blormeau@outlook.com>
+** Bytecode.cpp
+*/
+
+#include "Bax/VM/Bytecode.hpp"
+
+// -----------------------------------------------------------------------------
+
+namespace Bax
+{
+
+const char* opcode_name(Opcode op)
+{
+	switch (op) {
+#define __ENUMERATE(T) case Opcode::T: return #T;
+		__ENUMERATE_OPCODES
+#undef __ENUMERATE
+	}
+	return "Unknown";
+}
+
+}
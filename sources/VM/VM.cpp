@@ -6,15 +6,68 @@
 
 #include "Bax/VM/VM.hpp"
 #include "Common/Log.hpp"
+#include "Common/UTF8.hpp"
+#include <cmath>
 #include <cstring>
 
 // -----------------------------------------------------------------------------
 
+// Threaded dispatch, each handler jumps to the next one directly, when the
+// compiler has computed gotos. Define BAX_SWITCH_DISPATCH to compare.
+#if defined(__GNUC__) && !defined(BAX_SWITCH_DISPATCH)
+#define BAX_COMPUTED_GOTO 1
+#else
+#define BAX_COMPUTED_GOTO 0
+#endif
+
+// -----------------------------------------------------------------------------
+
 namespace Bax
 {
 
+namespace
+{
+
+bool equals(Value l, Value r)
+{
+	if (l.is_integer() && r.is_integer())
+		return l.is_same(r);
+	if (l.is_number() && r.is_number())
+		return l.to_number() == r.to_number();
+	// Other values are equal when their boxes are, but for strings
+	if (l.is_same(r))
+		return true;
+	auto ls = as<String>(l), rs = as<String>(r);
+	return ls && rs && String::Equals()(ls, rs);
+}
+
+// Integer operand of the bitwise operators, and index of arrays and strings.
+// Doubles are accepted if they hold an integer.
+bool integer_operand(Value value, int64_t& integer)
+{
+	if (value.is_integer()) {
+		integer = value.to_integer();
+		return true;
+	}
+	if (!value.is_double())
+		return false;
+	double n = value.to_number();
+	if (n != std::trunc(n) || n < -0x1p63 || n >= 0x1p63)
+		return false;
+	integer = static_cast<int64_t>(n);
+	return true;
+}
+
+}
+
+// -----------------------------------------------------------------------------
+
 VM::VM()
-{}
+: m_stack(new Value[stack_size])
+{
+	m_frames.reserve(max_frames);
+	define_builtins();
+}
 
 VM::VM(char** environment)
 : VM()
@@ -29,4 +82,659 @@ VM::VM(char** environment)
 VM::~VM()
 {}
 
+bool VM::run(const Program& program, const std::vector<std::string>& args)
+{
+	m_result = Value::null();
+	m_error.clear();
+
+	auto arguments = make_array();
+	for (auto& arg : args)
+		arguments->elements.push_back(Value::from_object(make_string(arg)));
+	define_global("args", Value::from_object(arguments));
+
+	// Globals are bound once, by name, instead of being looked up when used
+	m_program_globals.clear();
+	for (auto& name : program.globals) {
+		auto it = m_globals.find(name);
+		if (it == m_globals.end()) {
+			Log::error("Undefined variable '{}'", name);
+			return false;
+		}
+		m_program_globals.push_back(it->second);
+	}
+	m_statics.assign(program.static_count, Value::null());
+	m_statics_initialized.assign(program.static_count, false);
+
+	// The main function is called like any other, from the bottom of the stack
+	auto main = make<Closure>(program.main.get());
+	m_stack[0] = Value::from_object(main);
+	m_frames.clear();
+	m_frames.push_back({ main, main->function->code.data(), m_stack.get() + 1 });
+	return execute();
+}
+
+bool VM::execute()
+{
+	const Value* const stack_end = m_stack.get() + stack_size;
+
+	Frame* frame;
+	Closure* closure;
+	const Value* constants;
+	const Instruction* pc;
+	Value* base;
+	Instruction instruction;
+	// Returned by the running function
+	Value result;
+
+#define LOAD_FRAME() do {                                  \
+		frame = &m_frames.back();                          \
+		closure = frame->closure;                          \
+		constants = closure->function->constants.data();   \
+		pc = frame->pc;                                    \
+		base = frame->base;                                \
+	} while (0)
+
+#define THROW(...) do {                                    \
+		frame->pc = pc;                                    \
+		error(__VA_ARGS__);                                \
+		goto failure;                                      \
+	} while (0)
+
+#define A instruction.a()
+#define B instruction.b()
+#define C instruction.c()
+#define R(x) base[x]
+#define K(x) constants[x]
+	// Tests are followed by their jump
+#define JUMP_IF(condition) do {                            \
+		if ((condition) == static_cast<bool>(A))           \
+			pc += 1 + pc->sj();                            \
+		else                                               \
+			++pc;                                          \
+	} while (0)
+
+	LOAD_FRAME();
+	if (base + closure->function->register_count > stack_end)
+		THROW("Stack overflow");
+
+#if BAX_COMPUTED_GOTO
+	static const void* const handlers[] = {
+#define __ENUMERATE(T) &&handle_##T,
+		__ENUMERATE_OPCODES
+#undef __ENUMERATE
+	};
+#define CASE(T) handle_##T:
+#define DISPATCH() do { instruction = *pc++; goto *handlers[static_cast<uint8_t>(instruction.op())]; } while (0)
+	DISPATCH();
+#else
+#define CASE(T) case Opcode::T:
+#define DISPATCH() continue
+	for (;;) {
+	instruction = *pc++;
+	switch (instruction.op()) {
+#endif
+
+	CASE(Move) {
+		R(A) = R(B);
+		DISPATCH();
+	}
+	CASE(LoadNull) {
+		R(A) = Value::null();
+		DISPATCH();
+	}
+	CASE(LoadBool) {
+		R(A) = Value::from_bool(B);
+		DISPATCH();
+	}
+	CASE(LoadInt) {
+		R(A) = Value::from_integer(instruction.sbx());
+		DISPATCH();
+	}
+	CASE(LoadConstant) {
+		R(A) = K(instruction.bx());
+		DISPATCH();
+	}
+	CASE(GetUpvalue) {
+		R(A) = *closure->upvalues[B]->location;
+		DISPATCH();
+	}
+	CASE(SetUpvalue) {
+		*closure->upvalues[B]->location = R(A);
+		DISPATCH();
+	}
+	CASE(GetGlobal) {
+		R(A) = m_program_globals[instruction.bx()];
+		DISPATCH();
+	}
+	CASE(GetStatic) {
+		R(A) = m_statics[instruction.bx()];
+		DISPATCH();
+	}
+	CASE(SetStatic) {
+		m_statics[instruction.bx()] = R(A);
+		m_statics_initialized[instruction.bx()] = true;
+		DISPATCH();
+	}
+	CASE(IfStatic) {
+		if (m_statics_initialized[instruction.bx()])
+			pc += 1 + pc->sj();
+		else
+			++pc;
+		DISPATCH();
+	}
+
+	CASE(NewArray) {
+		auto array = make_array();
+		array->elements.reserve(instruction.bx());
+		R(A) = Value::from_object(array);
+		DISPATCH();
+	}
+	CASE(NewTable) {
+		auto table = make_table();
+		table->fields.reserve(instruction.bx());
+		R(A) = Value::from_object(table);
+		DISPATCH();
+	}
+	CASE(Push) {
+		auto array = as<Array>(R(A));
+		if (!array)
+			THROW("Cannot append to {}", type_name(R(A)));
+		array->elements.push_back(R(B));
+		DISPATCH();
+	}
+	CASE(GetField) {
+		auto name = static_cast<const String*>(K(C).to_object());
+		auto table = as<Table>(R(B));
+		if (!table)
+			THROW("Cannot read member '{}' of {}", name->value, type_name(R(B)));
+		auto field = table->get(name);
+		R(A) = field ? *field : Value::null();
+		DISPATCH();
+	}
+	CASE(SetField) {
+		auto name = static_cast<const String*>(K(B).to_object());
+		auto table = as<Table>(R(A));
+		if (!table)
+			THROW("Cannot write member '{}' of {}", name->value, type_name(R(A)));
+		table->fields[name] = R(C);
+		DISPATCH();
+	}
+	CASE(GetIndex) {
+		Value object = R(B), key = R(C);
+		if (auto array = as<Array>(object)) {
+			int64_t index;
+			if (!integer_operand(key, index) || index < 0 || static_cast<uint64_t>(index) >= array->elements.size())
+				THROW("Index {} out of the bounds of an array of {} elements", to_string(key), array->elements.size());
+			R(A) = array->elements[index];
+		}
+		else if (auto string = as<String>(object)) {
+			int64_t index;
+			if (!integer_operand(key, index) || index < 0 || static_cast<uint64_t>(index) >= string->value.size())
+				THROW("Index {} out of the bounds of a string of {} bytes", to_string(key), string->value.size());
+			R(A) = Value::from_glyph(static_cast<unsigned char>(string->value[index]));
+		}
+		else if (auto table = as<Table>(object)) {
+			auto name = as<String>(key);
+			if (!name)
+				THROW("Objects are indexed by strings, not by {}", type_name(key));
+			auto field = table->get(name);
+			R(A) = field ? *field : Value::null();
+		}
+		else
+			THROW("Cannot index {}", type_name(object));
+		DISPATCH();
+	}
+	CASE(SetIndex) {
+		Value object = R(A), key = R(B);
+		if (auto array = as<Array>(object)) {
+			int64_t index;
+			if (!integer_operand(key, index) || index < 0 || static_cast<uint64_t>(index) >= array->elements.size())
+				THROW("Index {} out of the bounds of an array of {} elements", to_string(key), array->elements.size());
+			array->elements[index] = R(C);
+		}
+		else if (auto table = as<Table>(object)) {
+			auto name = as<String>(key);
+			if (!name)
+				THROW("Objects are indexed by strings, not by {}", type_name(key));
+			table->fields[name] = R(C);
+		}
+		else
+			THROW("Cannot assign to an index of {}", type_name(object));
+		DISPATCH();
+	}
+	CASE(Method) {
+		Value object = R(B);
+		auto name = static_cast<const String*>(K(C).to_object());
+		auto callee = method(object, name);
+		if (!callee)
+			THROW("{} has no method '{}'", type_name(object), name->value);
+		R(A + 1) = object;
+		R(A) = *callee;
+		DISPATCH();
+	}
+
+	// Integers are computed on 64 bits, where 32-bit operands cannot overflow,
+	// and results that do not fit back in 32 bits become doubles. `INTEGER`
+	// tells when the result of the integers `l` and `r` is not an integer, as
+	// -0 is only a double.
+#define ARITHMETIC(T, OPERATOR, INTEGER)                                           \
+	CASE(T) {                                                                      \
+		Value lv = R(B), rv = R(C);                                                \
+		if (lv.is_integer() && rv.is_integer()) {                                  \
+			int64_t l = lv.to_integer(), r = rv.to_integer();                      \
+			if (INTEGER) {                                                         \
+				R(A) = Value::from_integer(l OPERATOR r);                          \
+				DISPATCH();                                                        \
+			}                                                                      \
+		}                                                                          \
+		if (!lv.is_number() || !rv.is_number())                                    \
+			THROW("Cannot apply '" #OPERATOR "' to {} and {}", type_name(lv), type_name(rv)); \
+		R(A) = Value::from_number(lv.to_number() OPERATOR rv.to_number());         \
+		DISPATCH();                                                                \
+	}
+
+	// `+` when its operands are not both numbers: strings are concatenated to
+	// anything
+#define CONCATENATE(l, r) do {                                                     \
+		if (!as<String>(l) && !as<String>(r))                                      \
+			THROW("Cannot apply '+' to {} and {}", type_name(l), type_name(r));    \
+		R(A) = Value::from_object(make_string(to_string(l) + to_string(r)));       \
+	} while (0)
+
+	CASE(Add) {
+		Value l = R(B), r = R(C);
+		if (l.is_integer() && r.is_integer())
+			R(A) = Value::from_integer(static_cast<int64_t>(l.to_integer()) + r.to_integer());
+		else if (l.is_number() && r.is_number())
+			R(A) = Value::from_number(l.to_number() + r.to_number());
+		else
+			CONCATENATE(l, r);
+		DISPATCH();
+	}
+	CASE(AddInt) {
+		Value l = R(B);
+		if (l.is_integer())
+			R(A) = Value::from_integer(static_cast<int64_t>(l.to_integer()) + instruction.sc());
+		else if (l.is_number())
+			R(A) = Value::from_number(l.to_number() + instruction.sc());
+		else
+			CONCATENATE(l, Value::from_integer(instruction.sc()));
+		DISPATCH();
+	}
+	CASE(SubstractInt) {
+		Value l = R(B);
+		if (l.is_integer())
+			R(A) = Value::from_integer(static_cast<int64_t>(l.to_integer()) - instruction.sc());
+		else if (l.is_number())
+			R(A) = Value::from_number(l.to_number() - instruction.sc());
+		else
+			THROW("Cannot apply '-' to {} and number", type_name(l));
+		DISPATCH();
+	}
+#undef CONCATENATE
+	ARITHMETIC(Substract, -, true)
+	ARITHMETIC(Multiply, *, (l * r != 0 || (l >= 0 && r >= 0)))
+	ARITHMETIC(Divide, /, (r != 0 && l % r == 0 && (l != 0 || r > 0)))
+	CASE(Modulo) {
+		Value l = R(B), r = R(C);
+		if (l.is_integer() && r.is_integer() && r.to_integer() != 0) {
+			int64_t remainder = static_cast<int64_t>(l.to_integer()) % r.to_integer();
+			// The remainder has the sign of `l`, even when it is 0
+			if (remainder != 0 || l.to_integer() >= 0) {
+				R(A) = Value::from_integer(remainder);
+				DISPATCH();
+			}
+		}
+		if (!l.is_number() || !r.is_number())
+			THROW("Cannot apply '%' to {} and {}", type_name(l), type_name(r));
+		R(A) = Value::from_number(std::fmod(l.to_number(), r.to_number()));
+		DISPATCH();
+	}
+	CASE(Power) {
+		Value l = R(B), r = R(C);
+		if (!l.is_number() || !r.is_number())
+			THROW("Cannot apply '**' to {} and {}", type_name(l), type_name(r));
+		double power = std::pow(l.to_number(), r.to_number());
+		// Exact for integers that fit in 32 bits
+		if (l.is_integer() && r.is_integer() && r.to_integer() >= 0 && std::abs(power) < 0x1p31)
+			R(A) = Value::from_integer(static_cast<int64_t>(power));
+		else
+			R(A) = Value::from_number(power);
+		DISPATCH();
+	}
+#undef ARITHMETIC
+
+#define BITWISE(T, OPERATOR, EXPRESSION)                                           \
+	CASE(T) {                                                                      \
+		int64_t l, r;                                                              \
+		if (!integer_operand(R(B), l) || !integer_operand(R(C), r))                          \
+			THROW("Operands of '" #OPERATOR "' must be integers, not {} and {}", to_string(R(B)), to_string(R(C))); \
+		R(A) = Value::from_integer(EXPRESSION);                                    \
+		DISPATCH();                                                                \
+	}
+
+	BITWISE(BitwiseAnd, &, l & r)
+	BITWISE(BitwiseOr, |, l | r)
+	BITWISE(BitwiseXor, ^, l ^ r)
+	BITWISE(LeftShift, <<, r < 0 || r > 63 ? 0 : static_cast<int64_t>(static_cast<uint64_t>(l) << r))
+	BITWISE(RightShift, >>, r < 0 || r > 63 ? (l < 0 ? -1 : 0) : l >> r)
+#undef BITWISE
+
+	CASE(Negate) {
+		// -0 is only a double
+		if (R(B).is_integer() && R(B).to_integer() != 0) {
+			R(A) = Value::from_integer(-static_cast<int64_t>(R(B).to_integer()));
+			DISPATCH();
+		}
+		if (!R(B).is_number())
+			THROW("Cannot negate {}", type_name(R(B)));
+		R(A) = Value::from_number(-R(B).to_number());
+		DISPATCH();
+	}
+	CASE(Positive) {
+		if (!R(B).is_number())
+			THROW("Cannot apply '+' to {}", type_name(R(B)));
+		R(A) = R(B);
+		DISPATCH();
+	}
+	CASE(BitwiseNot) {
+		int64_t integer;
+		if (!integer_operand(R(B), integer))
+			THROW("Operand of '~' must be an integer, not {}", to_string(R(B)));
+		R(A) = Value::from_integer(~integer);
+		DISPATCH();
+	}
+	CASE(Not) {
+		R(A) = Value::from_bool(!R(B).truthy());
+		DISPATCH();
+	}
+
+#define COMPARISON(OPERATOR, ...)                                                  \
+	{                                                                              \
+		Value l = R(B), r = R(C);                                                  \
+		bool result;                                                               \
+		if (l.is_integer() && r.is_integer())                                      \
+			result = l.to_integer() OPERATOR r.to_integer();                       \
+		else if (l.is_number() && r.is_number())                                   \
+			result = l.to_number() OPERATOR r.to_number();                         \
+		else if (l.is_glyph() && r.is_glyph())                                     \
+			result = l.to_glyph() OPERATOR r.to_glyph();                           \
+		else if (as<String>(l) && as<String>(r))                                   \
+			result = as<String>(l)->value OPERATOR as<String>(r)->value;           \
+		else                                                                       \
+			THROW("Cannot compare {} and {} with '" #OPERATOR "'", type_name(l), type_name(r)); \
+		__VA_ARGS__;                                                               \
+		DISPATCH();                                                                \
+	}
+
+	CASE(Equal) {
+		R(A) = Value::from_bool(equals(R(B), R(C)));
+		DISPATCH();
+	}
+	CASE(NotEqual) {
+		R(A) = Value::from_bool(!equals(R(B), R(C)));
+		DISPATCH();
+	}
+	CASE(Less) COMPARISON(<, R(A) = Value::from_bool(result))
+	CASE(LessEqual) COMPARISON(<=, R(A) = Value::from_bool(result))
+
+	CASE(Test) {
+		JUMP_IF(R(B).truthy());
+		DISPATCH();
+	}
+	CASE(TestNull) {
+		JUMP_IF(R(B).is_null());
+		DISPATCH();
+	}
+	CASE(TestEqual) {
+		JUMP_IF(equals(R(B), R(C)));
+		DISPATCH();
+	}
+	CASE(TestLess) COMPARISON(<, JUMP_IF(result))
+	CASE(TestLessEqual) COMPARISON(<=, JUMP_IF(result))
+#undef COMPARISON
+
+	CASE(Jump) {
+		pc += instruction.sj();
+		DISPATCH();
+	}
+
+	CASE(Closure) {
+		auto function = closure->function->functions[instruction.bx()].get();
+		auto created = make<Closure>(function);
+		created->upvalues.reserve(function->upvalues.size());
+		for (auto& source : function->upvalues)
+			created->upvalues.push_back(source.is_register ? capture(base + source.index) : closure->upvalues[source.index]);
+		R(A) = Value::from_object(created);
+		DISPATCH();
+	}
+	CASE(Close) {
+		close_upvalues(base + A);
+		DISPATCH();
+	}
+
+	CASE(Call) {
+		Value callee = R(A);
+		Value* arguments = base + A + 1;
+		size_t count = B;
+
+		if (auto called = as<Closure>(callee)) {
+			auto& function = *called->function;
+			if (arguments + function.register_count > stack_end || m_frames.size() == max_frames)
+				THROW("Stack overflow, in '{}'", function.name);
+			// Missing arguments are null
+			for (size_t i = count; i < function.parameter_count; ++i)
+				arguments[i] = Value::null();
+
+			frame->pc = pc;
+			m_frames.push_back({ called, function.code.data(), arguments });
+			LOAD_FRAME();
+			DISPATCH();
+		}
+
+		auto native = as<Native>(callee);
+		if (!native)
+			THROW("Cannot call {}", type_name(callee));
+		frame->pc = pc;
+		if (!native->function(*this, arguments, count, result))
+			goto failure;
+		R(A) = result;
+		DISPATCH();
+	}
+
+	CASE(Return) {
+		result = R(A);
+		goto finish_call;
+	}
+	CASE(ReturnNull) {
+		result = Value::null();
+	finish_call:
+		if (m_open_upvalues && m_open_upvalues->location >= base)
+			close_upvalues(base);
+		m_frames.pop_back();
+		if (m_frames.empty()) {
+			m_result = result;
+			return true;
+		}
+		// Where the callee was
+		base[-1] = result;
+		LOAD_FRAME();
+		DISPATCH();
+	}
+
+#if !BAX_COMPUTED_GOTO
+	}
+	}
+#endif
+
+failure:
+	Log::error("{}", m_error);
+	// Only the innermost frames, a stack overflow would print thousands
+	for (size_t i = 0; i < m_frames.size(); ++i) {
+		auto& frame = m_frames[m_frames.size() - 1 - i];
+		if (i == max_traceback) {
+			Log::error("\t... {} more", m_frames.size() - i);
+			break;
+		}
+		Log::error("\tin '{}', at instruction {}", frame.closure->function->name, frame.pc - frame.closure->function->code.data() - 1);
+	}
+	close_upvalues(m_stack.get());
+	m_frames.clear();
+	return false;
+
+#undef LOAD_FRAME
+#undef THROW
+#undef A
+#undef B
+#undef C
+#undef R
+#undef K
+#undef JUMP_IF
+#undef CASE
+#undef DISPATCH
+}
+
+// -----------------------------------------------------------------------------
+
+template <typename T, typename... Args>
+T* VM::make(Args&&... args)
+{
+	auto object = std::make_unique<T>(std::forward<Args>(args)...);
+	auto pointer = object.get();
+	m_objects.push_back(std::move(object));
+	return pointer;
+}
+
+String* VM::make_string(std::string value)
+{
+	return make<String>(std::move(value));
+}
+
+Array* VM::make_array()
+{
+	return make<Array>();
+}
+
+Table* VM::make_table()
+{
+	return make<Table>();
+}
+
+Native* VM::make_native(std::string name, NativeFunction function)
+{
+	return make<Native>(std::move(name), function);
+}
+
+bool VM::report(std::string message)
+{
+	m_error = std::move(message);
+	return false;
+}
+
+Upvalue* VM::capture(Value* slot)
+{
+	// Open upvalues are sorted from the top of the stack, each slot has one
+	Upvalue** link = &m_open_upvalues;
+	while (*link && (*link)->location > slot)
+		link = &(*link)->next;
+	if (*link && (*link)->location == slot)
+		return *link;
+
+	auto upvalue = make<Upvalue>(slot);
+	upvalue->next = *link;
+	*link = upvalue;
+	return upvalue;
+}
+
+void VM::close_upvalues(Value* last)
+{
+	while (m_open_upvalues && m_open_upvalues->location >= last) {
+		auto upvalue = m_open_upvalues;
+		upvalue->closed = *upvalue->location;
+		upvalue->location = &upvalue->closed;
+		m_open_upvalues = upvalue->next;
+	}
+}
+
+const Value* VM::method(Value object, const String* name) const
+{
+	if (auto table = as<Table>(object)) {
+		if (auto field = table->get(name))
+			return field;
+	}
+	auto methods = object.is_object()
+		? m_object_methods[static_cast<size_t>(object.to_object()->type)]
+		: m_value_methods[static_cast<size_t>(object.type())];
+	return methods ? methods->get(name) : nullptr;
+}
+
+// -----------------------------------------------------------------------------
+
+std::string VM::to_string(Value value) const
+{
+	switch (value.type()) {
+		case Value::Type::Null: return "null";
+		case Value::Type::Bool: return value.to_bool() ? "true" : "false";
+		case Value::Type::Glyph: {
+			char buffer[4];
+			return std::string(buffer, encode_utf8(value.to_glyph(), buffer));
+		}
+		case Value::Type::Number: {
+			if (value.is_integer())
+				return fmt::format("{}", value.to_integer());
+			// Integers are printed without exponent nor decimals
+			double n = value.to_number();
+			if (n == std::trunc(n) && std::abs(n) < 0x1p53)
+				return fmt::format("{}", static_cast<int64_t>(n));
+			return fmt::format("{}", n);
+		}
+		case Value::Type::Object:
+			break;
+	}
+
+	auto object = value.to_object();
+	switch (object->type) {
+		case Object::Type::String:
+			return static_cast<const String*>(object)->value;
+		case Object::Type::Array: {
+			std::string result = "[";
+			for (auto& element : static_cast<const Array*>(object)->elements) {
+				if (result.size() > 1)
+					result += ", ";
+				result += as<String>(element) ? fmt::format("\"{}\"", to_string(element)) : to_string(element);
+			}
+			return result + "]";
+		}
+		case Object::Type::Table:
+			return fmt::format("object({} fields)", static_cast<const Table*>(object)->fields.size());
+		case Object::Type::Closure:
+			return fmt::format("function {}", static_cast<const Closure*>(object)->function->name);
+		case Object::Type::Native:
+			return fmt::format("function {}", static_cast<const Native*>(object)->name);
+		case Object::Type::Upvalue:
+			break;
+	}
+	return "?";
+}
+
+const char* VM::type_name(Value value) const
+{
+	switch (value.type()) {
+		case Value::Type::Null:   return "null";
+		case Value::Type::Bool:   return "boolean";
+		case Value::Type::Glyph:  return "glyph";
+		case Value::Type::Number: return "number";
+		case Value::Type::Object: break;
+	}
+	switch (value.to_object()->type) {
+		case Object::Type::Array:   return "array";
+		case Object::Type::Closure: return "function";
+		case Object::Type::Native:  return "function";
+		case Object::Type::String:  return "string";
+		case Object::Type::Table:   return "object";
+		case Object::Type::Upvalue: break;
+	}
+	return "?";
+}
+
 }
@@ -4,12 +4,19 @@
 ** CLI entry point
 */
 
+#include "Bax/Compiler/ASTWriter.hpp"
 #include "Bax/Compiler/Compiler.hpp"
+#include "Bax/Compiler/Parser.hpp"
 #include "Bax/VM/VM.hpp"
 #include "Common/Log.hpp"
 #include "Common/OptionParser.hpp"
 #include "fmt/format.h"
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <memory>
 #include <string>
+#include <system_error>
 #include <vector>
 
 // -----------------------------------------------------------------------------
@@ -18,6 +25,10 @@ int main(int argc, char** argv, char** envp)
 {
 	// bool run_cli = false;
 	bool only_lint = false;
+	int max_depth = Bax::Parser::default_max_depth;
+	int jobs = 0;
+	std::string ast_format;
+	std::string ast_output;
 	std::string run_inline;
 	std::string entrypoint;
 	std::vector<std::string> args;
@@ -26,8 +37,12 @@ int main(int argc, char** argv, char** envp)
 	// opt.add_option(run_cli, 'a', nullptr, "Run interactively");
 	opt.add_option(run_inline, 'i', "inline", "Run an inline string of code", "code");
 	opt.add_option(only_lint, 'l', "lint", "Syntax check only (lint)");
-	opt.add_argument(entrypoint, "file", "Parse and execute <file>", false);
-	opt.add_argument(args, "args", "Arguments passed to <file>", false);
+	opt.add_option(max_depth, 'd', "max-depth", "Maximum nesting of the code (default: 1024)", "depth");
+	opt.add_option(ast_format, 't', "ast", "Print the parsed trees as text, json or binary", "format");
+	opt.add_option(ast_output, 'o', "ast-output", "Write the parsed trees to <file> instead of stdout", "file");
+	opt.add_option(jobs, 'j', "jobs", "Threads compiling files (default: all cores)", "count");
+	opt.add_argument(entrypoint, "file", "Parse and execute <file>, or lint every file of a directory", false);
+	opt.add_argument(args, "args", "Arguments passed to <file>, or more files to lint", false);
 	if (!opt.parse(argc, argv))
 		return EXIT_FAILURE;
 
@@ -35,26 +50,75 @@ int main(int argc, char** argv, char** envp)
 	Bax::VM vm(envp);
 	// The compiler will compile such code
 	Bax::Compiler compiler;
+	compiler.set_max_depth(max_depth > 0 ? max_depth : Bax::Parser::default_max_depth);
+	compiler.set_thread_count(std::max(jobs, 0));
+	compiler.set_only_parse(only_lint);
+
+	// Trees are only printed on request, all at once
+	std::unique_ptr<Bax::ASTWriter> ast_writer;
+	if (!ast_format.empty()) {
+		ast_writer = Bax::ASTWriter::make(ast_format);
+		if (!ast_writer) {
+			fmt::print(stderr, "Unknown AST format '{}', expected text, json or binary\n", ast_format);
+			return EXIT_FAILURE;
+		}
+		compiler.set_ast_writer(ast_writer.get());
+	}
+
+	// The trees alone are written to stdout, so that they can be piped
+	FILE* ast_file = stdout;
+	if (ast_writer && !ast_output.empty()) {
+		ast_file = std::fopen(ast_output.c_str(), "wb");
+		if (!ast_file) {
+			fmt::print(stderr, "Cannot open '{}' to write the trees\n", ast_output);
+			return EXIT_FAILURE;
+		}
+	}
+	FILE* status = ast_file == stdout && ast_writer ? stderr : stdout;
+	Log::set_output(status);
+
+	// Only files can be executed
+	std::error_code error;
+	if (!only_lint && run_inline.empty() && !entrypoint.empty() && std::filesystem::is_directory(entrypoint, error)) {
+		fmt::print(stderr, "'{}' is a directory, which can only be linted with -l\n", entrypoint);
+		return EXIT_FAILURE;
+	}
 
 	bool ok = false;
 	if (!run_inline.empty())
 		ok = compiler.do_string(run_inline);
+	else if (!entrypoint.empty() && only_lint) {
+		// Every argument is an input, linted concurrently
+		std::vector<std::string> inputs = { entrypoint };
+		inputs.insert(inputs.end(), args.begin(), args.end());
+		ok = compiler.do_files(inputs);
+	}
 	else if (!entrypoint.empty())
 		ok = compiler.do_file(entrypoint);
 	else
 		ok = compiler.do_istream(std::cin);
 
+	if (ast_writer) {
+		bool written = ast_writer->flush(ast_file);
+		if (ast_file != stdout)
+			written = std::fclose(ast_file) == 0 && written;
+		if (!written) {
+			fmt::print(stderr, "Cannot write the trees to '{}'\n", ast_output.empty() ? "stdout" : ast_output);
+			return EXIT_FAILURE;
+		}
+	}
+
 	if (!ok) {
+		if (auto errors = compiler.diagnostics().size())
+			fmt::print(stderr, "{} error{} found\n", errors, errors > 1 ? "s" : "");
 		fmt::print(stderr, "Compilation failed\n");
 		return EXIT_FAILURE;
 	}
 
 	if (only_lint)
-		fmt::print("OK\n");
-	else {
-		// TODO: Transfer from the compiler to the VM
-		// vm.run(/*main_closure*/, args);
-	}
+		fmt::print(status, "OK\n");
+	else if (compiler.program() && !vm.run(*compiler.program(), args))
+		return EXIT_FAILURE;
 
 	return EXIT_SUCCESS;
 }
@@ -0,0 +1,121 @@
+/*
+** Bax Tests, 2021
+** Benoît Lormeau <blormeau@outlook.com>
+** Unit test
+*/
+
+#include "Bax/Compiler/ASTWriter.hpp"
+#include "Bax/Compiler/Parser.hpp"
+#include "gtest/gtest.h"
+#include <algorithm>
+#include <string>
+
+// -----------------------------------------------------------------------------
+
+using namespace Bax::AST;
+
+// Dump of `source` in `format`, empty if it does not parse
+static std::string dump(std::string_view format, std::string_view source)
+{
+	StringPool strings;
+	SymbolTable symbols;
+	Arena nodes;
+	auto tree = Bax::Parser(Bax::Lexer(source), strings, symbols, nodes).run();
+	if (!tree)
+		return {};
+	auto writer = Bax::ASTWriter::make(format);
+	writer->write(tree);
+	return writer->buffer();
+}
+
+static char byte(Kind kind) { return static_cast<char>(kind); }
+
+// -----------------------------------------------------------------------------
+
+TEST(ASTWriter, Formats)
+{
+	ASSERT_NE(Bax::ASTWriter::make("text"), nullptr);
+	ASSERT_NE(Bax::ASTWriter::make("json"), nullptr);
+	ASSERT_NE(Bax::ASTWriter::make("binary"), nullptr);
+	ASSERT_EQ(Bax::ASTWriter::make("xml"), nullptr);
+}
+
+TEST(ASTWriter, Text)
+{
+	auto assign = std::to_string((int)AssignmentExpression::Operators::Assign);
+	auto call = dump("text", "x = f(\"s\", 1.5)[];");
+	ASSERT_EQ(call,
+		"ExpressionStatement\n"
+		"  AssignmentExpression(" + assign + ")\n"
+		"    Identifier(x)\n"
+		"    SubscriptExpression\n"
+		"      CallExpression\n"
+		"        Identifier(f)\n"
+		"        String(s)\n"
+		"        Number(1.5)\n"
+		"      (empty subscript)\n");
+
+	auto match = dump("text", "{ let y = match (a) { 1 => b, default => c }; }");
+	ASSERT_EQ(match,
+		"BlockStatement\n"
+		"  VariableDeclaration(let, scoped)\n"
+		"    Identifier(y)\n"
+		"    MatchExpression\n"
+		"      Identifier(a)\n"
+		"      Number(1)\n"
+		"      Identifier(b)\n"
+		"      default\n"
+		"      Identifier(c)\n");
+}
+
+TEST(ASTWriter, Json)
+{
+	auto assign = std::to_string((int)AssignmentExpression::Operators::Assign);
+	auto json = dump("json", "if (o) { k = { k: \"a\\\"\\n\" }; }");
+	ASSERT_EQ(json,
+		"{\"kind\":\"IfStatement\",\"children\":["
+			"{\"kind\":\"Identifier\",\"name\":\"o\",\"children\":[]},"
+			"{\"kind\":\"BlockStatement\",\"children\":["
+				"{\"kind\":\"ExpressionStatement\",\"children\":["
+					"{\"kind\":\"AssignmentExpression\",\"operator\":" + assign + ",\"children\":["
+						"{\"kind\":\"Identifier\",\"name\":\"k\",\"children\":[]},"
+						"{\"kind\":\"ObjectExpression\",\"children\":["
+							"{\"kind\":\"Identifier\",\"name\":\"k\",\"children\":[]},"
+							"{\"kind\":\"String\",\"value\":\"a\\\"\\n\",\"children\":[]}"
+			"]}]}]}]},"
+			"null"
+		"]}\n");
+}
+
+TEST(ASTWriter, Binary)
+{
+	auto binary = dump("binary", "f(a, 2);");
+	std::string number(8, '\0');
+	number[6] = '\x00';
+	number[7] = '\x40'; // 2.0 is 0x4000000000000000
+	ASSERT_EQ(binary, std::string({
+		byte(Kind::ExpressionStatement),
+		byte(Kind::CallExpression), 2,
+		byte(Kind::Identifier), 1, 'f',
+		byte(Kind::Identifier), 1, 'a',
+		byte(Kind::Number) }) + number);
+}
+
+TEST(ASTWriter, DeepTrees)
+{
+	// Left-associative, so the tree is as deep as the expression is long
+	constexpr size_t terms = 100'000;
+	std::string source = "x = a";
+	for (size_t i = 1; i < terms; ++i)
+		source += " - a";
+	source += ';';
+
+	auto binary = dump("binary", source);
+	// Statement, assignment and operator, binary expressions and operator,
+	// identifiers and one-letter names
+	ASSERT_EQ(binary.size(), 1 + 2 + 2 * (terms - 1) + 3 * (terms + 1));
+
+	auto json = dump("json", source);
+	ASSERT_EQ(json.back(), '\n');
+	ASSERT_EQ(std::count(json.begin(), json.end(), '{'), std::count(json.begin(), json.end(), '}'));
+}
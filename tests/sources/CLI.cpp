@@ -0,0 +1,65 @@
+/*
+** Bax Tests, 2021
+** Benoît Lormeau <blormeau@outlook.com>
+** Unit test
+*/
+
+#include "gtest/gtest.h"
+#include "nlohmann/json.hpp"
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <unistd.h>
+
+// -----------------------------------------------------------------------------
+
+// What `bax` wrote to stdout when run with `arguments`, its stderr is dropped
+static std::string run_bax(const std::string& arguments)
+{
+	std::string command = std::string(BAX_EXECUTABLE) + " " + arguments + " 2>/dev/null";
+	FILE* pipe = popen(command.c_str(), "r");
+	if (!pipe)
+		return {};
+	std::string output;
+	char buffer[4096];
+	for (size_t n; (n = std::fread(buffer, 1, sizeof(buffer), pipe)) > 0;)
+		output.append(buffer, n);
+	pclose(pipe);
+	return output;
+}
+
+// Whether each line of `dump` is a JSON document, and there is one at least
+static bool is_json_lines(const std::string& dump)
+{
+	std::istringstream stream(dump);
+	size_t documents = 0;
+	for (std::string line; std::getline(stream, line); ++documents) {
+		if (!nlohmann::json::accept(line))
+			return false;
+	}
+	return documents > 0;
+}
+
+// -----------------------------------------------------------------------------
+
+TEST(CLI, JsonDumpIsAlone)
+{
+	// The status line and logs are not mixed into the trees
+	auto dump = run_bax("-l -t json " BAX_SAMPLES_DIR);
+	ASSERT_TRUE(is_json_lines(dump)) << dump;
+	ASSERT_TRUE(is_json_lines(run_bax("-l -t json -i '{ let a = [1, \"b\"]; }'")));
+}
+
+TEST(CLI, DumpToFile)
+{
+	auto path = std::filesystem::temp_directory_path() / ("bax-tests-dump-" + std::to_string(getpid()) + ".json");
+	ASSERT_EQ(run_bax("-l -t json -o " + path.string() + " " BAX_SAMPLES_DIR), "OK\n");
+
+	std::ifstream file(path);
+	std::string dump(std::istreambuf_iterator<char>(file), {});
+	std::filesystem::remove(path);
+	ASSERT_TRUE(is_json_lines(dump)) << dump;
+}
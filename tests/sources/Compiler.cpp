@@ -0,0 +1,190 @@
+/*
+** Bax Tests, 2021
+** Benoît Lormeau <blormeau@outlook.com>
+** Unit test
+*/
+
+#include "Bax/Compiler/Compiler.hpp"
+#include "Common/ConcurrentSymbolTable.hpp"
+#include "Common/Log.hpp"
+#include "gtest/gtest.h"
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+// -----------------------------------------------------------------------------
+
+// Directory of source files, removed along with it
+struct SourceTree
+{
+	std::filesystem::path root;
+
+	SourceTree()
+	: root(std::filesystem::temp_directory_path() / ("bax-tests-" + std::to_string(getpid())))
+	{
+		std::filesystem::remove_all(root);
+		std::filesystem::create_directories(root);
+	}
+
+	~SourceTree() { std::filesystem::remove_all(root); }
+
+	std::string add(const std::string& name, std::string_view source)
+	{
+		auto path = root / name;
+		std::filesystem::create_directories(path.parent_path());
+		std::ofstream(path) << source;
+		return path.string();
+	}
+};
+
+static void make_quiet(Bax::Compiler& compiler, size_t thread_count)
+{
+	Log::set_level(Log::Critical);
+	compiler.set_thread_count(thread_count);
+}
+
+// -----------------------------------------------------------------------------
+
+TEST(Compiler, DiagnosticsAreInInputOrder)
+{
+	SourceTree tree;
+	std::vector<std::string> files;
+	for (size_t i = 0; i < 200; ++i) {
+		// Every third file has two errors, some files are much longer
+		std::string source = "{\n";
+		for (size_t line = 0; line < (i % 7 == 0 ? 2000 : 10); ++line)
+			source += "\tlet a = b + c;\n";
+		if (i % 3 == 0)
+			source += "\tx = ;\n\tf(;\n";
+		source += "}\n";
+		files.push_back(tree.add("file" + std::to_string(i) + ".bax", source));
+	}
+
+	Bax::Diagnostics expected;
+	for (size_t thread_count : { 1, 2, 8 }) {
+		Bax::Compiler compiler;
+		make_quiet(compiler, thread_count);
+		ASSERT_FALSE(compiler.do_files(files));
+		ASSERT_EQ(compiler.units().size(), files.size());
+
+		auto& diagnostics = compiler.diagnostics();
+		ASSERT_EQ(diagnostics.size(), 2 * 67);
+		for (size_t i = 0; i < diagnostics.size(); ++i) {
+			ASSERT_EQ(diagnostics[i].file, files[i / 2 * 3]);
+			if (i % 2) {
+				ASSERT_LT(diagnostics[i - 1].offset, diagnostics[i].offset);
+			}
+		}
+
+		if (expected.empty())
+			expected = diagnostics;
+		for (size_t i = 0; i < diagnostics.size(); ++i)
+			ASSERT_EQ(diagnostics[i].message, expected[i].message);
+	}
+}
+
+TEST(Compiler, DirectoriesAreWalkedInOrder)
+{
+	SourceTree tree;
+	tree.add("b.bax", "{ f(); }");
+	tree.add("a/z.bax", "{ g(); }");
+	tree.add("a/y.bax", "{ h(); }");
+	tree.add("a/notes.txt", "not Bax");
+
+	Bax::Compiler compiler;
+	make_quiet(compiler, 4);
+	ASSERT_TRUE(compiler.do_files({ tree.root.string() }));
+
+	std::vector<std::string> paths;
+	for (auto& unit : compiler.units()) {
+		ASSERT_NE(unit.ast, nullptr);
+		paths.push_back(std::filesystem::path(unit.path).lexically_relative(tree.root).string());
+	}
+	ASSERT_EQ(paths, std::vector<std::string>({ "a/y.bax", "a/z.bax", "b.bax" }));
+}
+
+TEST(Compiler, MissingFilesAreReported)
+{
+	SourceTree tree;
+	Bax::Compiler compiler;
+	make_quiet(compiler, 2);
+	ASSERT_FALSE(compiler.do_files({ tree.add("ok.bax", "{}"), (tree.root / "missing.bax").string() }));
+	ASSERT_EQ(compiler.diagnostics().size(), 1);
+	ASSERT_NE(compiler.diagnostics()[0].message.find("missing.bax"), std::string::npos);
+	ASSERT_NE(compiler.units()[0].ast, nullptr);
+}
+
+TEST(Compiler, SingleInputsCanOnlyBeParsed)
+{
+	// As every input of `do_files`, whatever the code generator would find
+	SourceTree tree;
+	Bax::Compiler compiler;
+	make_quiet(compiler, 1);
+	compiler.set_only_parse(true);
+	ASSERT_TRUE(compiler.do_string("{ const x = 1; x = 2; }"));
+	ASSERT_NE(compiler.ast(), nullptr);
+	ASSERT_EQ(compiler.program(), nullptr);
+	ASSERT_TRUE(compiler.do_file(tree.add("constant.bax", "{ const x = 1; x = 2; }")));
+	ASSERT_TRUE(compiler.do_files({ tree.root.string() }));
+
+	compiler.set_only_parse(false);
+	ASSERT_FALSE(compiler.do_string("{ const x = 1; x = 2; }"));
+	ASSERT_TRUE(compiler.do_string("{ let x = 1; x = 2; }"));
+	ASSERT_NE(compiler.program(), nullptr);
+}
+
+TEST(Compiler, SymbolsAreSharedByEveryFile)
+{
+	SourceTree tree;
+	std::vector<std::string> files;
+	for (size_t i = 0; i < 64; ++i)
+		files.push_back(tree.add(std::to_string(i) + ".bax", "{ shared = unique" + std::to_string(i) + "; }"));
+
+	Bax::Compiler compiler;
+	make_quiet(compiler, 8);
+	ASSERT_TRUE(compiler.do_files(files));
+	ASSERT_EQ(compiler.symbols().size(), 1 + files.size());
+
+	auto shared = compiler.symbols().find("shared");
+	ASSERT_NE(shared, SymbolTable::empty_slot);
+	ASSERT_EQ(compiler.symbols().name(shared), "shared");
+	for (auto& unit : compiler.units()) {
+		auto block = Bax::AST::as<Bax::AST::BlockStatement>(unit.ast);
+		ASSERT_NE(block, nullptr);
+		auto statement = Bax::AST::as<Bax::AST::ExpressionStatement>(block->statements[0]);
+		auto assignment = Bax::AST::as<Bax::AST::AssignmentExpression>(statement->expression);
+		ASSERT_EQ(Bax::AST::as<Bax::AST::Identifier>(assignment->lhs)->symbol, shared);
+	}
+}
+
+TEST(Compiler, ConcurrentInterning)
+{
+	ConcurrentSymbolTable shared;
+	constexpr size_t thread_count = 8, names = 20'000;
+
+	// Every thread interns the same names, in a different order
+	std::vector<std::vector<Symbol>> symbols(thread_count, std::vector<Symbol>(names));
+	std::vector<std::thread> threads;
+	for (size_t t = 0; t < thread_count; ++t) {
+		threads.emplace_back([&, t] {
+			SymbolTable front(shared);
+			for (size_t i = 0; i < names; ++i) {
+				size_t n = (i * 7919 + t * 104729) % names;
+				symbols[t][n] = front.intern("name" + std::to_string(n));
+			}
+		});
+	}
+	for (auto& thread : threads)
+		thread.join();
+
+	ASSERT_EQ(shared.size(), names);
+	for (size_t n = 0; n < names; ++n) {
+		for (size_t t = 1; t < thread_count; ++t)
+			ASSERT_EQ(symbols[t][n], symbols[0][n]);
+		ASSERT_LT(symbols[0][n], names);
+		ASSERT_EQ(shared.name(symbols[0][n]), "name" + std::to_string(n));
+	}
+}
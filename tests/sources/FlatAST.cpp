@@ -0,0 +1,130 @@
+/*
+** Bax Tests, 2021
+** Benoît Lormeau <blormeau@outlook.com>
+** Unit test
+*/
+
+#include "Bax/Compiler/FlatAST.hpp"
+#include "Bax/Compiler/Parser.hpp"
+#include "gtest/gtest.h"
+#include <string>
+
+// -----------------------------------------------------------------------------
+
+using Kind = Bax::FlatAST::Kind;
+
+// Flat form of `source`, with the storage its names and strings refer to
+struct Flattened
+{
+	StringPool strings;
+	SymbolTable symbols;
+	Arena nodes;
+	Bax::FlatAST flat;
+
+	Flattened(std::string_view source)
+	{
+		auto tree = Bax::Parser(Bax::Lexer(source), strings, symbols, nodes).run();
+		if (tree)
+			flat = Bax::FlatAST::from_tree(tree);
+	}
+};
+
+// Every kind of node
+static constexpr std::string_view every_node = R"({
+	let a = [1, 'x', "s", null, true];
+	static const o = { k: a[0], m: a[] };
+	let f = function (x, y) { return x ? y : -x; };
+	if (a) { a = b.c; } else while (a) { a++; }
+	f(match (a) { 1, 2 => 3, default => 4 }, a ?? b, --a);
+})";
+
+// -----------------------------------------------------------------------------
+
+TEST(FlatAST, Layout)
+{
+	Flattened flattened("f(a, 2);");
+	auto& flat = flattened.flat;
+
+	// Children first, the root last
+	ASSERT_EQ(flat.kinds, std::vector({ Kind::Identifier, Kind::Identifier, Kind::Number, Kind::CallExpression, Kind::ExpressionStatement }));
+	ASSERT_EQ(flat.root(), 4);
+	ASSERT_EQ(flat.lhs[4], 3);
+
+	ASSERT_EQ(flat.lhs[3], 0);
+	auto arguments = flat.list(flat.rhs[3]);
+	ASSERT_EQ(std::vector(arguments.begin(), arguments.end()), std::vector<Bax::FlatAST::Index>({ 1, 2 }));
+
+	ASSERT_EQ(flat.lhs[0], flattened.symbols.find("f"));
+	ASSERT_EQ(flat.strings[flat.rhs[0]], "f");
+	ASSERT_EQ(flat.strings[flat.rhs[1]], "a");
+	ASSERT_EQ(flat.numbers[flat.lhs[2]], 2);
+}
+
+TEST(FlatAST, ChildrenComeFirst)
+{
+	Flattened flattened(every_node);
+	auto& flat = flattened.flat;
+	ASSERT_FALSE(flat.empty());
+
+	// Operands that are always nodes
+	for (Bax::FlatAST::Index i = 0; i < flat.size(); ++i) {
+		switch (flat.kinds[i]) {
+			case Kind::AssignmentExpression:
+			case Kind::BinaryExpression:
+			case Kind::MemberExpression:
+			case Kind::WhileStatement:
+			case Kind::VariableDeclaration:
+				ASSERT_LT(flat.rhs[i], i);
+				[[fallthrough]];
+			case Kind::CallExpression:
+			case Kind::FunctionExpression:
+			case Kind::MatchExpression:
+			case Kind::TernaryExpression:
+			case Kind::UnaryExpression:
+			case Kind::UpdateExpression:
+			case Kind::ExpressionStatement:
+			case Kind::IfStatement:
+			case Kind::ReturnStatement:
+				ASSERT_LT(flat.lhs[i], i);
+				break;
+			default:
+				break;
+		}
+	}
+}
+
+TEST(FlatAST, RoundTrip)
+{
+	Flattened flattened(every_node);
+	auto& flat = flattened.flat;
+	ASSERT_FALSE(flat.empty());
+	ASSERT_EQ(flat.kinds.back(), Kind::BlockStatement);
+
+	// Every kind is covered
+	for (size_t kind = 0; kind < Bax::AST::kind_count; ++kind)
+		ASSERT_NE(std::find(flat.kinds.begin(), flat.kinds.end(), static_cast<Kind>(kind)), flat.kinds.end()) << Bax::AST::kind_name(static_cast<Kind>(kind));
+
+	Arena nodes;
+	auto tree = flat.to_tree(nodes);
+	ASSERT_NE(tree, nullptr);
+	ASSERT_EQ(Bax::FlatAST::from_tree(tree), flat);
+}
+
+TEST(FlatAST, DeepTrees)
+{
+	// Right-associative, so the tree is as deep as the expression is long
+	constexpr size_t terms = 1'000'000;
+	std::string source = "x = a";
+	for (size_t i = 1; i < terms; ++i)
+		source += " ** a";
+	source += ';';
+
+	Flattened flattened(source);
+	auto& flat = flattened.flat;
+	// Statement, assignment, binary expressions and identifiers
+	ASSERT_EQ(flat.size(), 1 + 1 + (terms - 1) + (terms + 1));
+	ASSERT_EQ(flat.kinds[flat.root()], Kind::ExpressionStatement);
+
+	Arena nodes;
+	ASSERT_EQ(Bax::FlatAST::from_tree(flat.to_tree(nodes)), flat);
+}
@@ -6,6 +6,31 @@
 
 #include "Bax/Compiler/Lexer.hpp"
 #include "gtest/gtest.h"
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <random>
+#include <sstream>
+
+// -----------------------------------------------------------------------------
+
+// Checks that every way of splitting `source` through the parallel path
+// yields the same tokens as the sequential lexer
+static void expect_parallel_matches(std::string_view source)
+{
+	auto expected = Bax::Lexer(source).tokenize_all(SIZE_MAX, 1);
+
+	for (size_t chunk_size = 1; chunk_size <= 16; ++chunk_size) {
+		for (size_t thread_count : {1, 3}) {
+			auto tokens = Bax::Lexer(source).tokenize_all(chunk_size, thread_count);
+			ASSERT_EQ(tokens.types, expected.types) << "chunk size " << chunk_size;
+			ASSERT_EQ(tokens.offsets, expected.offsets) << "chunk size " << chunk_size;
+			ASSERT_EQ(tokens.lengths, expected.lengths) << "chunk size " << chunk_size;
+			ASSERT_EQ(tokens.numbers, expected.numbers) << "chunk size " << chunk_size;
+			ASSERT_EQ(tokens.flags, expected.flags) << "chunk size " << chunk_size;
+		}
+	}
+}
 
 // -----------------------------------------------------------------------------
 
@@ -13,6 +38,7 @@ TEST(Lexer, EmptySource)
 {
 	std::string_view source = "";
 	Bax::Lexer lexer(source);
+	expect_parallel_matches(source);
 
 	ASSERT_TRUE(lexer.is_eof());
 
@@ -24,154 +50,282 @@ TEST(Lexer, UnknownCharacter)
 {
 	std::string_view source = "$";
 	Bax::Lexer lexer(source);
+	expect_parallel_matches(source);
 
 	auto token = lexer.next();
 	ASSERT_EQ(token.type, Bax::Token::Type::Unknown);
-	ASSERT_EQ(token.trivia, source);
-	ASSERT_EQ(token.start.line, 1);
-	ASSERT_EQ(token.start.column, 1);
-	ASSERT_EQ(token.end.line, 1);
-	ASSERT_EQ(token.end.column, 2);
+	ASSERT_EQ(lexer.text(token), source);
+	ASSERT_EQ(lexer.position_of(token.offset).line, 1);
+	ASSERT_EQ(lexer.position_of(token.offset).column, 1);
+	ASSERT_EQ(lexer.position_of(token.end()).line, 1);
+	ASSERT_EQ(lexer.position_of(token.end()).column, 2);
 }
 
 TEST(Lexer, InvalidNumber)
 {
 	std::string_view source = "0a";
 	Bax::Lexer lexer(source);
+	expect_parallel_matches(source);
 
 	auto token = lexer.next();
 	ASSERT_EQ(token.type, Bax::Token::Type::Number);
-	ASSERT_EQ(token.trivia, source.substr(0, 1));
-	ASSERT_EQ(token.start.line, 1);
-	ASSERT_EQ(token.start.column, 1);
-	ASSERT_EQ(token.end.line, 1);
-	ASSERT_EQ(token.end.column, 2);
+	ASSERT_EQ(lexer.text(token), source.substr(0, 1));
+	ASSERT_EQ(lexer.position_of(token.offset).line, 1);
+	ASSERT_EQ(lexer.position_of(token.offset).column, 1);
+	ASSERT_EQ(lexer.position_of(token.end()).line, 1);
+	ASSERT_EQ(lexer.position_of(token.end()).column, 2);
 }
 
 TEST(Lexer, NumberInteger)
 {
 	std::string_view source = "12";
 	Bax::Lexer lexer(source);
+	expect_parallel_matches(source);
 
 	auto token = lexer.next();
 	ASSERT_EQ(token.type, Bax::Token::Type::Number);
-	ASSERT_EQ(token.trivia, source);
-	ASSERT_EQ(token.start.line, 1);
-	ASSERT_EQ(token.start.column, 1);
-	ASSERT_EQ(token.end.line, 1);
-	ASSERT_EQ(token.end.column, 3);
+	ASSERT_EQ(lexer.text(token), source);
+	ASSERT_EQ(lexer.position_of(token.offset).line, 1);
+	ASSERT_EQ(lexer.position_of(token.offset).column, 1);
+	ASSERT_EQ(lexer.position_of(token.end()).line, 1);
+	ASSERT_EQ(lexer.position_of(token.end()).column, 3);
 }
 
 TEST(Lexer, NumberDecimal)
 {
 	std::string_view source = "64.265";
 	Bax::Lexer lexer(source);
+	expect_parallel_matches(source);
 
 	auto token = lexer.next();
 	ASSERT_EQ(token.type, Bax::Token::Type::Number);
-	ASSERT_EQ(token.trivia, source);
-	ASSERT_EQ(token.start.line, 1);
-	ASSERT_EQ(token.start.column, 1);
-	ASSERT_EQ(token.end.line, 1);
-	ASSERT_EQ(token.end.column, 7);
+	ASSERT_EQ(lexer.text(token), source);
+	ASSERT_EQ(lexer.position_of(token.offset).line, 1);
+	ASSERT_EQ(lexer.position_of(token.offset).column, 1);
+	ASSERT_EQ(lexer.position_of(token.end()).line, 1);
+	ASSERT_EQ(lexer.position_of(token.end()).column, 7);
 }
 
 TEST(Lexer, NumberExponent)
 {
 	std::string_view source = "3e5";
 	Bax::Lexer lexer(source);
+	expect_parallel_matches(source);
 
 	auto token = lexer.next();
 	ASSERT_EQ(token.type, Bax::Token::Type::Number);
-	ASSERT_EQ(token.trivia, source);
-	ASSERT_EQ(token.start.line, 1);
-	ASSERT_EQ(token.start.column, 1);
-	ASSERT_EQ(token.end.line, 1);
-	ASSERT_EQ(token.end.column, 4);
+	ASSERT_EQ(lexer.text(token), source);
+	ASSERT_EQ(lexer.position_of(token.offset).line, 1);
+	ASSERT_EQ(lexer.position_of(token.offset).column, 1);
+	ASSERT_EQ(lexer.position_of(token.end()).line, 1);
+	ASSERT_EQ(lexer.position_of(token.end()).column, 4);
 }
 
 TEST(Lexer, NumberNegativeExponent)
 {
 	std::string_view source = "3e-5";
 	Bax::Lexer lexer(source);
+	expect_parallel_matches(source);
 
 	auto token = lexer.next();
 	ASSERT_EQ(token.type, Bax::Token::Type::Number);
-	ASSERT_EQ(token.trivia, source);
-	ASSERT_EQ(token.start.line, 1);
-	ASSERT_EQ(token.start.column, 1);
-	ASSERT_EQ(token.end.line, 1);
-	ASSERT_EQ(token.end.column, 5);
+	ASSERT_EQ(lexer.text(token), source);
+	ASSERT_EQ(lexer.position_of(token.offset).line, 1);
+	ASSERT_EQ(lexer.position_of(token.offset).column, 1);
+	ASSERT_EQ(lexer.position_of(token.end()).line, 1);
+	ASSERT_EQ(lexer.position_of(token.end()).column, 5);
 }
 
 TEST(Lexer, NumberBinary)
 {
 	std::string_view source = "0b00110011";
 	Bax::Lexer lexer(source);
+	expect_parallel_matches(source);
 
 	auto token = lexer.next();
 	ASSERT_EQ(token.type, Bax::Token::Type::Number);
-	ASSERT_EQ(token.trivia, source);
-	ASSERT_EQ(token.start.line, 1);
-	ASSERT_EQ(token.start.column, 1);
-	ASSERT_EQ(token.end.line, 1);
-	ASSERT_EQ(token.end.column, 11);
+	ASSERT_EQ(lexer.text(token), source);
+	ASSERT_EQ(lexer.position_of(token.offset).line, 1);
+	ASSERT_EQ(lexer.position_of(token.offset).column, 1);
+	ASSERT_EQ(lexer.position_of(token.end()).line, 1);
+	ASSERT_EQ(lexer.position_of(token.end()).column, 11);
 }
 
 TEST(Lexer, NumberOctal)
 {
 	std::string_view source = "0o644";
 	Bax::Lexer lexer(source);
+	expect_parallel_matches(source);
 
 	auto token = lexer.next();
 	ASSERT_EQ(token.type, Bax::Token::Type::Number);
-	ASSERT_EQ(token.trivia, source);
-	ASSERT_EQ(token.start.line, 1);
-	ASSERT_EQ(token.start.column, 1);
-	ASSERT_EQ(token.end.line, 1);
-	ASSERT_EQ(token.end.column, 6);
+	ASSERT_EQ(lexer.text(token), source);
+	ASSERT_EQ(lexer.position_of(token.offset).line, 1);
+	ASSERT_EQ(lexer.position_of(token.offset).column, 1);
+	ASSERT_EQ(lexer.position_of(token.end()).line, 1);
+	ASSERT_EQ(lexer.position_of(token.end()).column, 6);
 }
 
 TEST(Lexer, NumberHexadecimal)
 {
 	std::string_view source = "0xDEADBEEF";
 	Bax::Lexer lexer(source);
+	expect_parallel_matches(source);
 
 	auto token = lexer.next();
 	ASSERT_EQ(token.type, Bax::Token::Type::Number);
-	ASSERT_EQ(token.trivia, source);
-	ASSERT_EQ(token.start.line, 1);
-	ASSERT_EQ(token.start.column, 1);
-	ASSERT_EQ(token.end.line, 1);
-	ASSERT_EQ(token.end.column, 11);
+	ASSERT_EQ(lexer.text(token), source);
+	ASSERT_EQ(lexer.position_of(token.offset).line, 1);
+	ASSERT_EQ(lexer.position_of(token.offset).column, 1);
+	ASSERT_EQ(lexer.position_of(token.end()).line, 1);
+	ASSERT_EQ(lexer.position_of(token.end()).column, 11);
+}
+
+TEST(Lexer, NumberValues)
+{
+	std::pair<std::string_view, double> cases[] = {
+		{ "0", 0 },
+		{ "012", 12 },
+		{ "4294967296", 4294967296.0 },
+		{ "9007199254740993", 9007199254740992.0 },      // Ties to even
+		{ "18446744073709551615", 18446744073709551615.0 }, // More than 19 digits
+		{ "0.1", 0.1 },
+		{ ".5", 0.5 },
+		{ "1.", 1 },
+		{ "3.14159265358979323846264338327950288", 3.14159265358979323846 },
+		{ "1e", 1 },
+		{ "2E+", 2 },
+		{ "1.5e-3", 1.5e-3 },
+		{ "123456789012.345678e-8", 123456789012.345678e-8 },
+		{ "1e400", HUGE_VAL },
+		{ "0.00001e-400", 0 },
+		{ "1e-400", 0 },
+		{ "0b101", 5 },
+		{ "0B", 0 },
+		{ "0o17", 15 },
+		{ "0xdeadBEEF", 0xdeadbeef },
+		{ "0x1FFFFFFFFFFFFF1", 0x1FFFFFFFFFFFFF1p0 },
+		{ "0x1000000000000000000000001", 0x1000000000000000000000001p0 },
+		{ "0x2000000000000000080000000", 0x2000000000000000080000000p0 },
+		{ "0x2000000000000000180000000", 0x2000000000000000180000000p0 },
+	};
+
+	for (auto [source, value] : cases) {
+		Bax::Lexer lexer(source);
+		auto token = lexer.next();
+		ASSERT_EQ(token.type, Bax::Token::Type::Number) << source;
+		ASSERT_EQ(token.length, source.length()) << source;
+		ASSERT_EQ(lexer.number(), value) << source;
+
+		auto tokens = Bax::Lexer(source).tokenize_all();
+		ASSERT_EQ(tokens.numbers, std::vector<double>{ value }) << source;
+	}
+}
+
+TEST(Lexer, NumberValuesAreCorrectlyRounded)
+{
+	// Subnormals, and values too small or too large for them
+	for (std::string source : { "49e-320", "2.5e-310", "0.000001e-317", "1e-400", "1e400", "123456789e-330" }) {
+		Bax::Lexer lexer(source);
+		lexer.next();
+		ASSERT_EQ(lexer.number(), strtod(source.c_str(), nullptr)) << source;
+	}
+
+	std::mt19937_64 rng(1);
+	for (size_t i = 0; i < 20000; ++i) {
+		std::string source = std::to_string(rng() >> (rng() % 64));
+		if (rng() % 2)
+			source.insert(rng() % (source.size() + 1), ".");
+		if (rng() % 2)
+			source += "e" + std::to_string((int)(rng() % 660) - 330);
+		if (source[0] == '.' && source.size() > 1 && source[1] == 'e')
+			continue;
+
+		Bax::Lexer lexer(source);
+		auto token = lexer.next();
+		ASSERT_EQ(token.length, source.length()) << source;
+		ASSERT_EQ(lexer.number(), strtod(source.c_str(), nullptr)) << source;
+	}
 }
 
 TEST(Lexer, IdentifierAndKeywords)
 {
 	std::string_view source = "let str ";
 	Bax::Lexer lexer(source);
+	expect_parallel_matches(source);
 
 	auto token = lexer.next();
 	ASSERT_EQ(token.type, Bax::Token::Type::Let);
-	ASSERT_EQ(token.trivia, source.substr(0, 3));
-	ASSERT_EQ(token.start.line, 1);
-	ASSERT_EQ(token.start.column, 1);
-	ASSERT_EQ(token.end.line, 1);
-	ASSERT_EQ(token.end.column, 4);
+	ASSERT_EQ(lexer.text(token), source.substr(0, 3));
+	ASSERT_EQ(lexer.position_of(token.offset).line, 1);
+	ASSERT_EQ(lexer.position_of(token.offset).column, 1);
+	ASSERT_EQ(lexer.position_of(token.end()).line, 1);
+	ASSERT_EQ(lexer.position_of(token.end()).column, 4);
 
 	token = lexer.next();
 	ASSERT_EQ(token.type, Bax::Token::Type::Identifier);
-	ASSERT_EQ(token.trivia, source.substr(4, 3));
-	ASSERT_EQ(token.start.line, 1);
-	ASSERT_EQ(token.start.column, 5);
-	ASSERT_EQ(token.end.line, 1);
-	ASSERT_EQ(token.end.column, 8);
+	ASSERT_EQ(lexer.text(token), source.substr(4, 3));
+	ASSERT_EQ(lexer.position_of(token.offset).line, 1);
+	ASSERT_EQ(lexer.position_of(token.offset).column, 5);
+	ASSERT_EQ(lexer.position_of(token.end()).line, 1);
+	ASSERT_EQ(lexer.position_of(token.end()).column, 8);
+}
+
+TEST(Lexer, Utf8Identifiers)
+{
+	std::string_view source = "caf\xC3\xA9 _\xE6\x97\xA5\xE6\x9C\xAC" "2 \xF0\x9D\x94\x98x \xE2\x82\xAC";
+	Bax::Lexer lexer(source);
+	expect_parallel_matches(source);
+
+	for (auto expected : {"caf\xC3\xA9", "_\xE6\x97\xA5\xE6\x9C\xAC" "2", "\xF0\x9D\x94\x98x", "\xE2\x82\xAC"}) {
+		auto token = lexer.next();
+		ASSERT_EQ(token.type, Bax::Token::Type::Identifier);
+		ASSERT_EQ(lexer.text(token), expected);
+	}
+	ASSERT_EQ(lexer.next().type, Bax::Token::Type::Eof);
+}
+
+TEST(Lexer, MalformedUtf8)
+{
+	// Overlong, surrogate, above U+10FFFF, stray continuation and truncated
+	std::string_view source = "a\xC0\x80 \xED\xA0\x80 \xF4\x90\x80\x80 \x80 b\xE2\x82";
+	Bax::Lexer lexer(source);
+	expect_parallel_matches(source);
+
+	auto token = lexer.next();
+	ASSERT_EQ(token.type, Bax::Token::Type::Identifier);
+	ASSERT_EQ(lexer.text(token), "a");
+	for (size_t i = 0; i < 2 + 3 + 4 + 1; ++i) {
+		token = lexer.next();
+		ASSERT_EQ(token.type, Bax::Token::Type::Unknown);
+		ASSERT_EQ(token.length, 1);
+	}
+	token = lexer.next();
+	ASSERT_EQ(lexer.text(token), "b");
+	ASSERT_EQ(lexer.next().type, Bax::Token::Type::Unknown);
+	ASSERT_EQ(lexer.next().type, Bax::Token::Type::Unknown);
+	ASSERT_EQ(lexer.next().type, Bax::Token::Type::Eof);
+}
+
+TEST(Lexer, CharClassesMatchTheCLocale)
+{
+	for (int c = 0; c < 256; ++c) {
+		bool ascii = c < 0x80;
+		ASSERT_EQ(Bax::Lexer::is_whitespace(c), ascii && isspace(c)) << c;
+		ASSERT_EQ(Bax::Lexer::is_digit(c), ascii && isdigit(c)) << c;
+		ASSERT_EQ(Bax::Lexer::is_hex_digit(c), ascii && isxdigit(c)) << c;
+		ASSERT_EQ(Bax::Lexer::is_alpha(c), ascii && isalpha(c)) << c;
+		ASSERT_EQ(Bax::Lexer::is_alnum(c), ascii && isalnum(c)) << c;
+		ASSERT_EQ(Bax::Lexer::is_punctuation(c), ascii && ispunct(c)) << c;
+		ASSERT_EQ(Bax::Lexer::is_non_ascii(c), !ascii) << c;
+	}
 }
 
 TEST(Lexer, Operators)
 {
 	std::string_view source = "+ - * / = += -= *= /= == **= ++ --";
 	Bax::Lexer lexer(source);
+	expect_parallel_matches(source);
 
 	ASSERT_EQ(lexer.next().type, Bax::Token::Type::Plus);
 	ASSERT_EQ(lexer.next().type, Bax::Token::Type::Minus);
@@ -187,3 +341,345 @@ TEST(Lexer, Operators)
 	ASSERT_EQ(lexer.next().type, Bax::Token::Type::PlusPlus);
 	ASSERT_EQ(lexer.next().type, Bax::Token::Type::MinusMinus);
 }
+
+TEST(Lexer, WhitespacesAndComments)
+{
+	std::string_view source =
+		"\t\t  // inline comment\n"
+		"/* block\n"
+		"   comment */    \n"
+		"\v\f\r   a /* */ b // eof";
+	Bax::Lexer lexer(source);
+	expect_parallel_matches(source);
+
+	auto token = lexer.next();
+	ASSERT_EQ(token.type, Bax::Token::Type::Identifier);
+	ASSERT_EQ(lexer.text(token), "a");
+	ASSERT_EQ(lexer.position_of(token.offset).line, 4);
+	ASSERT_EQ(lexer.position_of(token.offset).column, 7);
+
+	token = lexer.next();
+	ASSERT_EQ(token.type, Bax::Token::Type::Identifier);
+	ASSERT_EQ(lexer.text(token), "b");
+	ASSERT_EQ(lexer.position_of(token.offset).line, 4);
+	ASSERT_EQ(lexer.position_of(token.offset).column, 15);
+
+	ASSERT_EQ(lexer.next().type, Bax::Token::Type::Eof);
+}
+
+TEST(Lexer, LongTrivia)
+{
+	std::string source;
+	source += std::string(100, ' ') + "\n";
+	source += "//" + std::string(100, '-') + "\n";
+	source += "/*" + std::string(100, '*') + "\n" + std::string(50, '\t') + "*/";
+	source += std::string(40, '\n') + std::string(33, ' ') + "x";
+	Bax::Lexer lexer(source);
+	expect_parallel_matches(source);
+
+	auto token = lexer.next();
+	ASSERT_EQ(token.type, Bax::Token::Type::Identifier);
+	ASSERT_EQ(lexer.text(token), "x");
+	ASSERT_EQ(lexer.position_of(token.offset).line, 44);
+	ASSERT_EQ(lexer.position_of(token.offset).column, 34);
+	ASSERT_EQ(lexer.next().type, Bax::Token::Type::Eof);
+}
+
+TEST(Lexer, OperatorsLongestMatch)
+{
+	std::string_view source = "&&=&&&<<=<<<>>=?.?:?\?=??? ... => :: \\ @";
+	Bax::Lexer lexer(source);
+	expect_parallel_matches(source);
+
+	ASSERT_EQ(lexer.next().type, Bax::Token::Type::AmpersandAmpersandEquals);
+	ASSERT_EQ(lexer.next().type, Bax::Token::Type::AmpersandAmpersand);
+	ASSERT_EQ(lexer.next().type, Bax::Token::Type::Ampersand);
+	ASSERT_EQ(lexer.next().type, Bax::Token::Type::LessLessEquals);
+	ASSERT_EQ(lexer.next().type, Bax::Token::Type::LessLess);
+	ASSERT_EQ(lexer.next().type, Bax::Token::Type::Less);
+	ASSERT_EQ(lexer.next().type, Bax::Token::Type::GreaterGreaterEquals);
+	ASSERT_EQ(lexer.next().type, Bax::Token::Type::QuestionDot);
+	ASSERT_EQ(lexer.next().type, Bax::Token::Type::QuestionColon);
+	ASSERT_EQ(lexer.next().type, Bax::Token::Type::QuestionQuestionEquals);
+	ASSERT_EQ(lexer.next().type, Bax::Token::Type::QuestionQuestion);
+	ASSERT_EQ(lexer.next().type, Bax::Token::Type::Question);
+	ASSERT_EQ(lexer.next().type, Bax::Token::Type::Dot);
+	ASSERT_EQ(lexer.next().type, Bax::Token::Type::Dot);
+	ASSERT_EQ(lexer.next().type, Bax::Token::Type::Dot);
+	ASSERT_EQ(lexer.next().type, Bax::Token::Type::EqualsGreater);
+	ASSERT_EQ(lexer.next().type, Bax::Token::Type::ColonColon);
+	ASSERT_EQ(lexer.next().type, Bax::Token::Type::Backslash);
+
+	auto token = lexer.next();
+	ASSERT_EQ(token.type, Bax::Token::Type::Unknown);
+	ASSERT_EQ(lexer.text(token), "@");
+	ASSERT_EQ(lexer.next().type, Bax::Token::Type::Eof);
+}
+
+TEST(Lexer, AllKeywords)
+{
+	std::string_view source =
+		"class const default else extends false for function if implements let "
+		"match null private protected public return static true while";
+	Bax::Lexer lexer(source);
+	expect_parallel_matches(source);
+
+	ASSERT_EQ(lexer.next().type, Bax::Token::Type::Class);
+	ASSERT_EQ(lexer.next().type, Bax::Token::Type::Const);
+	ASSERT_EQ(lexer.next().type, Bax::Token::Type::Default);
+	ASSERT_EQ(lexer.next().type, Bax::Token::Type::Else);
+	ASSERT_EQ(lexer.next().type, Bax::Token::Type::Extends);
+	ASSERT_EQ(lexer.next().type, Bax::Token::Type::False);
+	ASSERT_EQ(lexer.next().type, Bax::Token::Type::For);
+	ASSERT_EQ(lexer.next().type, Bax::Token::Type::Function);
+	ASSERT_EQ(lexer.next().type, Bax::Token::Type::If);
+	ASSERT_EQ(lexer.next().type, Bax::Token::Type::Implements);
+	ASSERT_EQ(lexer.next().type, Bax::Token::Type::Let);
+	ASSERT_EQ(lexer.next().type, Bax::Token::Type::Match);
+	ASSERT_EQ(lexer.next().type, Bax::Token::Type::Null);
+	ASSERT_EQ(lexer.next().type, Bax::Token::Type::Private);
+	ASSERT_EQ(lexer.next().type, Bax::Token::Type::Protected);
+	ASSERT_EQ(lexer.next().type, Bax::Token::Type::Public);
+	ASSERT_EQ(lexer.next().type, Bax::Token::Type::Return);
+	ASSERT_EQ(lexer.next().type, Bax::Token::Type::Static);
+	ASSERT_EQ(lexer.next().type, Bax::Token::Type::True);
+	ASSERT_EQ(lexer.next().type, Bax::Token::Type::While);
+	ASSERT_EQ(lexer.next().type, Bax::Token::Type::Eof);
+}
+
+TEST(Lexer, KeywordLookalikes)
+{
+	std::string_view source = "classes con If whilst _let truer i f elses nul";
+	Bax::Lexer lexer(source);
+	expect_parallel_matches(source);
+
+	for (auto token = lexer.next(); token.type != Bax::Token::Type::Eof; token = lexer.next())
+		ASSERT_EQ(token.type, Bax::Token::Type::Identifier) << lexer.text(token);
+}
+
+TEST(Lexer, StringsAndGlyphsSpanTheirQuotes)
+{
+	std::string_view source = "\"abc\"\n  'x' \"unterminated";
+	Bax::Lexer lexer(source);
+	expect_parallel_matches(source);
+
+	auto token = lexer.next();
+	ASSERT_EQ(token.type, Bax::Token::Type::String);
+	ASSERT_EQ(lexer.text(token), "\"abc\"");
+
+	token = lexer.next();
+	ASSERT_EQ(token.type, Bax::Token::Type::Glyph);
+	ASSERT_EQ(lexer.text(token), "'x'");
+	ASSERT_EQ(lexer.position_of(token.offset).line, 2);
+	ASSERT_EQ(lexer.position_of(token.offset).column, 3);
+
+	token = lexer.next();
+	ASSERT_EQ(token.type, Bax::Token::Type::UnterminatedString);
+	ASSERT_EQ(lexer.text(token), "\"unterminated");
+	ASSERT_EQ(lexer.next().type, Bax::Token::Type::Eof);
+}
+
+TEST(Lexer, EscapesInStringsAndGlyphs)
+{
+	std::string long_text(100, 'x');
+	std::string source =
+		"\"a\\\\\" '\\'' '\\\\' \"" + long_text + "\" \"" + long_text + "\\\"" + long_text + "\" \"\\\"";
+	Bax::Lexer lexer(source);
+	expect_parallel_matches(source);
+
+	auto token = lexer.next();
+	ASSERT_EQ(token.type, Bax::Token::Type::String);
+	ASSERT_EQ(lexer.text(token), "\"a\\\\\"");
+	ASSERT_FALSE(token.flags & Bax::Token::Verbatim);
+
+	token = lexer.next();
+	ASSERT_EQ(token.type, Bax::Token::Type::Glyph);
+	ASSERT_EQ(lexer.text(token), "'\\''");
+	token = lexer.next();
+	ASSERT_EQ(token.type, Bax::Token::Type::Glyph);
+	ASSERT_EQ(lexer.text(token), "'\\\\'");
+
+	token = lexer.next();
+	ASSERT_EQ(token.type, Bax::Token::Type::String);
+	ASSERT_EQ(token.length, long_text.length() + 2);
+	ASSERT_TRUE(token.flags & Bax::Token::Verbatim);
+
+	token = lexer.next();
+	ASSERT_EQ(token.type, Bax::Token::Type::String);
+	ASSERT_EQ(token.length, 2 * long_text.length() + 4);
+	ASSERT_FALSE(token.flags & Bax::Token::Verbatim);
+
+	token = lexer.next();
+	ASSERT_EQ(token.type, Bax::Token::Type::UnterminatedString);
+	ASSERT_EQ(lexer.text(token), "\"\\\"");
+	ASSERT_EQ(lexer.next().type, Bax::Token::Type::Eof);
+}
+
+TEST(Lexer, StreamingMatchesWholeInput)
+{
+	std::string_view source =
+		"/* a block comment\n spanning lines */ let identifier = 0x1F + 3.25e-2;\n"
+		"// inline\n"
+		"const s = \"a string \\\" with an escape\"; 'g' ?\?= a?.b >>= 1;\n"
+		"\"unterminated";
+
+	for (size_t chunk_size = 1; chunk_size <= 16; ++chunk_size) {
+		Bax::Lexer whole(source);
+		std::istringstream stream { std::string(source) };
+		Bax::Lexer streamed(stream, chunk_size);
+
+		while (true) {
+			auto expected = whole.next();
+			auto token = streamed.next();
+			ASSERT_EQ(token.type, expected.type) << "chunk size " << chunk_size;
+			ASSERT_EQ(token.offset, expected.offset);
+			ASSERT_EQ(token.length, expected.length);
+			ASSERT_EQ(streamed.text(token), whole.text(expected));
+
+			auto position = streamed.position_of(token.offset);
+			auto expected_position = whole.position_of(expected.offset);
+			ASSERT_EQ(position.line, expected_position.line);
+			ASSERT_EQ(position.column, expected_position.column);
+
+			if (token.type == Bax::Token::Type::Eof)
+				break;
+		}
+	}
+}
+
+TEST(Lexer, StreamingKeepsMemoryBounded)
+{
+	std::string source;
+	while (source.size() < 1024 * 1024)
+		source += "let value = call(a, b) + 1; // comment\n";
+
+	std::istringstream stream(source);
+	Bax::Lexer lexer(stream, 256);
+
+	size_t tokens = 0;
+	while (lexer.next().type != Bax::Token::Type::Eof)
+		++tokens;
+
+	ASSERT_GT(tokens, 100000);
+	ASSERT_LT(lexer.input().length(), 1024);
+}
+
+TEST(Lexer, TokenizeAllMatchesNext)
+{
+	std::string_view source =
+		"/* comment */ let identifier = 0x1F + 3.25e-2;\n"
+		"const s = \"a string\"; 'g' ?\?= a?.b >>= 1; $";
+
+	Bax::Lexer pulled(source);
+	auto tokens = Bax::Lexer(source).tokenize_all();
+
+	ASSERT_FALSE(tokens.empty());
+	ASSERT_EQ(tokens.types.back(), Bax::Token::Type::Eof);
+	for (size_t i = 0; i < tokens.size(); ++i) {
+		auto expected = pulled.next();
+		ASSERT_EQ(tokens.types[i], expected.type);
+		ASSERT_EQ(tokens.offsets[i], expected.offset);
+		ASSERT_EQ(tokens.lengths[i], expected.length);
+	}
+}
+
+TEST(Lexer, ParallelChunksStartingWithinTokens)
+{
+	// Chunks start at line starts, which all fall within strings and block
+	// comments here. Lines also look like valid code, to lure the chunks
+	std::string source;
+	for (size_t i = 0; i < 64; ++i) {
+		source += "let a = \"\n";
+		source += "let b = 1; /*\n";
+		source += "let c = \"*/ d\";\n";
+		source += "'\\\n' e // \"\n";
+	}
+	source += "\"unterminated\nlet f = 2;";
+
+	expect_parallel_matches(source);
+
+	std::string large;
+	while (large.size() < 4 * Bax::Lexer::parallel_chunk_size)
+		large += source;
+	Bax::Lexer lexer(large);
+	auto tokens = lexer.tokenize_all();
+	ASSERT_EQ(tokens.types, Bax::Lexer(large).tokenize_all(SIZE_MAX, 1).types);
+	ASSERT_TRUE(lexer.is_eof());
+
+	// Or on the threads it is given
+	Bax::Lexer sequential(large);
+	sequential.set_thread_count(1);
+	ASSERT_EQ(sequential.tokenize_all().types, tokens.types);
+}
+
+TEST(Lexer, ParallelChunksEndingAcrossLines)
+{
+	// Chunks stop at the first token ending at or past the next one's start:
+	// right before the line break, on the first character of the next line,
+	// or lines past it
+	expect_parallel_matches("a\nb\n\"\n\"c\n\"x\ny\nz\" d\n'\n'\n e\n\n\nf");
+	expect_parallel_matches("\"\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\n\"\nx");
+}
+
+TEST(Lexer, RelexMatchesFullLexing)
+{
+	std::string source =
+		"/* block */ let identifier = 0x1F + 3.25e-2; // inline\n"
+		"const s = \"a string\"; 'g' ?\?= a?.b >>= 1;\n";
+	std::string_view alphabet = "ab1 .=/*\"'\n\\e+\xE2\x82\xAC\xF0";
+
+	std::mt19937 rng(42);
+	auto tokens = Bax::Lexer(source).tokenize_all();
+	for (size_t i = 0; i < 2000; ++i) {
+		size_t offset = rng() % (source.size() + 1);
+		size_t removed = std::min<size_t>(rng() % 3, source.size() - offset);
+		std::string inserted;
+		for (size_t n = rng() % 3; n > 0; --n)
+			inserted += alphabet[rng() % alphabet.size()];
+		source.replace(offset, removed, inserted);
+
+		Bax::Lexer(source).relex(tokens, {offset, removed, inserted});
+		auto expected = Bax::Lexer(source).tokenize_all();
+		ASSERT_EQ(tokens.types, expected.types) << "edit " << i << " of: " << source;
+		ASSERT_EQ(tokens.offsets, expected.offsets) << "edit " << i << " of: " << source;
+		ASSERT_EQ(tokens.lengths, expected.lengths) << "edit " << i << " of: " << source;
+		ASSERT_EQ(tokens.numbers, expected.numbers) << "edit " << i << " of: " << source;
+		ASSERT_EQ(tokens.flags, expected.flags) << "edit " << i << " of: " << source;
+	}
+}
+
+TEST(Lexer, RelexOnlyLexesAroundTheEdit)
+{
+	std::string source;
+	while (source.size() < 64 * 1024)
+		source += "let value = call(a, b) + 1; // comment\n";
+	auto tokens = Bax::Lexer(source).tokenize_all();
+	auto count = tokens.size();
+
+	// Renaming `value` to `values` in the middle
+	size_t offset = source.find("value", source.size() / 2) + 5;
+	source.insert(offset, "s");
+	ASSERT_LE(Bax::Lexer(source).relex(tokens, {offset, 0, "s"}), 2);
+	ASSERT_EQ(tokens.size(), count);
+	ASSERT_EQ(tokens.offsets.back(), source.size());
+
+	// Opening a block comment swallows the rest of the source
+	source.insert(offset, "/*");
+	Bax::Lexer(source).relex(tokens, {offset, 0, "/*"});
+	ASSERT_EQ(tokens.types, Bax::Lexer(source).tokenize_all().types);
+	ASSERT_LT(tokens.size(), count);
+}
+
+TEST(Lexer, RelexCompletingUtf8Sequence)
+{
+	// `a` depends on the bytes following it, up to the invalid sequence's end
+	std::string source = "a\xF0\x9F\x98 b";
+	auto tokens = Bax::Lexer(source).tokenize_all();
+	ASSERT_EQ(tokens.size(), 6);
+
+	source[4] = '\x80';
+	Bax::Lexer(source).relex(tokens, {4, 1, "\x80"});
+	ASSERT_EQ(tokens.size(), 2);
+	ASSERT_EQ(tokens.types[0], Bax::Token::Type::Identifier);
+	ASSERT_EQ(tokens.lengths[0], source.size());
+}
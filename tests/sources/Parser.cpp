@@ -0,0 +1,315 @@
+/*
+** Bax Tests, 2021
+** Benoît Lormeau <blormeau@outlook.com>
+** Unit test
+*/
+
+#include "Bax/Compiler/Parser.hpp"
+#include "gtest/gtest.h"
+#include <optional>
+#include <string>
+#include <type_traits>
+#include <sstream>
+
+// -----------------------------------------------------------------------------
+
+// Arguments of the single call statement `f(...);` in `source`
+static std::vector<Bax::Ptr<Bax::AST::Expression>> call_arguments(Bax::Lexer lexer, StringPool& strings, SymbolTable& symbols, Arena& nodes)
+{
+	Bax::Parser parser(std::move(lexer), strings, symbols, nodes);
+	auto statement = Bax::AST::as<Bax::AST::ExpressionStatement>(parser.run());
+	if (!statement)
+		return {};
+	auto call = Bax::AST::as<Bax::AST::CallExpression>(statement->expression);
+	if (!call)
+		return {};
+	return call->arguments;
+}
+
+static std::string_view string_value(Bax::Ptr<Bax::AST::Expression> expression)
+{
+	auto string = Bax::AST::as<Bax::AST::String>(expression);
+	return string ? string->value : "<not a string>";
+}
+
+// Operator of `expression`, if it is a `Node`
+template <typename Node>
+static std::optional<typename Node::Operators> operator_of(Bax::Ptr<Bax::AST::Expression> expression)
+{
+	auto node = Bax::AST::as<Node>(expression);
+	return node ? std::optional(node->op) : std::nullopt;
+}
+
+// Grouping of the operands of binary, assignment and unary expressions, eg.
+// `((a b) c)` for `a - b - c`
+static std::string grouping(Bax::Ptr<const Bax::AST::Expression> expression)
+{
+	using namespace Bax::AST;
+
+	return visit(static_cast<const Node&>(*expression), [] <typename T> (const T& node) -> std::string {
+		if constexpr (std::is_same_v<T, Identifier>)
+			return std::string(node.name);
+		else if constexpr (std::is_same_v<T, BinaryExpression> || std::is_same_v<T, AssignmentExpression>)
+			return "(" + grouping(node.lhs) + " " + grouping(node.rhs) + ")";
+		else if constexpr (std::is_same_v<T, UnaryExpression>)
+			return "!" + grouping(node.rhs);
+		else
+			return kind_name(node.kind);
+	});
+}
+
+// Offsets of the errors found in `source`
+static std::vector<size_t> error_offsets(std::string_view source)
+{
+	StringPool strings;
+	SymbolTable symbols;
+	Arena nodes;
+	Bax::Parser parser(Bax::Lexer(source), strings, symbols, nodes);
+	if (parser.run())
+		return {};
+
+	std::vector<size_t> offsets;
+	for (auto& diagnostic : parser.diagnostics())
+		offsets.push_back(diagnostic.offset);
+	return offsets;
+}
+
+static bool parses(std::string_view source, size_t max_depth = Bax::Parser::default_max_depth)
+{
+	StringPool strings;
+	SymbolTable symbols;
+	Arena nodes;
+	Bax::Parser parser(Bax::Lexer(source), strings, symbols, nodes);
+	parser.set_max_depth(max_depth);
+	return parser.run() != nullptr;
+}
+
+// -----------------------------------------------------------------------------
+
+TEST(Parser, VerbatimStringsReferToTheSource)
+{
+	std::string_view source = "f(\"plain\", \"\");";
+	StringPool strings;
+	SymbolTable symbols;
+	Arena nodes;
+	auto arguments = call_arguments(Bax::Lexer(source), strings, symbols, nodes);
+
+	ASSERT_EQ(arguments.size(), 2);
+	ASSERT_EQ(string_value(arguments[0]), "plain");
+	ASSERT_EQ(string_value(arguments[0]).data(), source.data() + 3);
+	ASSERT_EQ(string_value(arguments[1]), "");
+}
+
+TEST(Parser, EscapedStrings)
+{
+	std::string_view source =
+		"f(\"a\\tb\\\\\", \"q\\\"\\?\\x\", \"\\u00e9\\u20AC\\u12\", \"\\uD83D\\uDE00|\\uD83D|\\uDE00\", \"\\u00410\");";
+	StringPool strings;
+	SymbolTable symbols;
+	Arena nodes;
+	auto arguments = call_arguments(Bax::Lexer(source), strings, symbols, nodes);
+
+	ASSERT_EQ(arguments.size(), 5);
+	ASSERT_EQ(string_value(arguments[0]), "a\tb\\");
+	ASSERT_EQ(string_value(arguments[1]), "q\"?\\x");
+	ASSERT_EQ(string_value(arguments[2]), "\xC3\xA9\xE2\x82\xAC\\u12");
+	ASSERT_EQ(string_value(arguments[3]), "\xF0\x9F\x98\x80|\xEF\xBF\xBD|\xEF\xBF\xBD");
+	ASSERT_EQ(string_value(arguments[4]), "A0");
+}
+
+TEST(Parser, StreamedStringsAreCopied)
+{
+	std::string source = "f(\"" + std::string(100, 'a') + "\", \"b\\n\");";
+	std::istringstream stream(source);
+	StringPool strings;
+	SymbolTable symbols;
+	Arena nodes;
+	auto arguments = call_arguments(Bax::Lexer(stream, 16), strings, symbols, nodes);
+
+	ASSERT_EQ(arguments.size(), 2);
+	ASSERT_EQ(string_value(arguments[0]), std::string(100, 'a'));
+	ASSERT_EQ(string_value(arguments[1]), "b\n");
+}
+
+TEST(Parser, OperatorsOfExpressions)
+{
+	using namespace Bax::AST;
+
+	StringPool strings;
+	SymbolTable symbols;
+	Arena nodes;
+	auto arguments = call_arguments(Bax::Lexer("f(a - b, -a, a <<= b, a >>= b, a?.b, ++a, a--, a ?: b);"), strings, symbols, nodes);
+
+	ASSERT_EQ(arguments.size(), 8);
+	ASSERT_EQ(operator_of<BinaryExpression>(arguments[0]), BinaryExpression::Operators::Substract);
+	ASSERT_EQ(operator_of<UnaryExpression>(arguments[1]), UnaryExpression::Operators::Negative);
+	ASSERT_EQ(operator_of<AssignmentExpression>(arguments[2]), AssignmentExpression::Operators::BitwiseLeftShift);
+	ASSERT_EQ(operator_of<AssignmentExpression>(arguments[3]), AssignmentExpression::Operators::BitwiseRightShift);
+	ASSERT_EQ(operator_of<MemberExpression>(arguments[4]), MemberExpression::Operators::Nullsafe);
+	ASSERT_EQ(operator_of<UpdateExpression>(arguments[5]), UpdateExpression::Operators::Increment);
+	ASSERT_EQ(operator_of<UpdateExpression>(arguments[6]), UpdateExpression::Operators::Decrement);
+	ASSERT_EQ(operator_of<BinaryExpression>(arguments[7]), BinaryExpression::Operators::Ternary);
+}
+
+TEST(Parser, ShapesOfOperands)
+{
+	ASSERT_TRUE(parses("a.b.c = a::b;"));
+	ASSERT_TRUE(parses("a.b++;"));
+	ASSERT_TRUE(parses("f(--a);"));
+
+	// Member expressions need identifiers on both sides
+	ASSERT_FALSE(parses("f(1.a);"));
+	ASSERT_FALSE(parses("f(a.1);"));
+	// Updates need an identifier or a member expression
+	ASSERT_FALSE(parses("f(++1);"));
+	ASSERT_FALSE(parses("f(a()++);"));
+	// Only assignments, calls and updates are statements
+	ASSERT_FALSE(parses("a + b;"));
+	ASSERT_FALSE(parses("a;"));
+}
+
+TEST(Parser, IdentifiersAreInterned)
+{
+	using namespace Bax::AST;
+
+	std::string source = "f(a, b, a, { b: a, c: b }, a.c);";
+	std::istringstream stream(source);
+	StringPool strings;
+	SymbolTable symbols;
+	Arena nodes;
+	// Streamed by tiny chunks, names cannot refer to the input
+	auto arguments = call_arguments(Bax::Lexer(stream, 4), strings, symbols, nodes);
+
+	ASSERT_EQ(arguments.size(), 5);
+	ASSERT_EQ(symbols.size(), 4);
+	auto a = as<Identifier>(arguments[0]), b = as<Identifier>(arguments[1]);
+	ASSERT_NE(a, nullptr);
+	ASSERT_NE(b, nullptr);
+	ASSERT_NE(a->symbol, b->symbol);
+	ASSERT_EQ(as<Identifier>(arguments[2])->symbol, a->symbol);
+	ASSERT_EQ(a->name, "a");
+	ASSERT_EQ(a->name.data(), symbols.name(a->symbol).data());
+	ASSERT_EQ(symbols.find("c"), as<Identifier>(as<MemberExpression>(arguments[4])->rhs)->symbol);
+	ASSERT_EQ(symbols.find("d"), SymbolTable::empty_slot);
+
+	// Members are kept in source order
+	auto object = as<ObjectExpression>(arguments[3]);
+	ASSERT_NE(object, nullptr);
+	ASSERT_EQ(object->members.size(), 2);
+	ASSERT_EQ(object->members[0].first->symbol, b->symbol);
+	ASSERT_EQ(object->members[0].second->kind, Kind::Identifier);
+	ASSERT_EQ(object->members[1].first->name, "c");
+}
+
+TEST(Parser, DuplicateKeys)
+{
+	StringPool strings;
+	SymbolTable symbols;
+	Arena nodes;
+
+	ASSERT_EQ(call_arguments(Bax::Lexer("f({ a: 1, b: 2, a: 3 });"), strings, symbols, nodes).size(), 0);
+	ASSERT_EQ(call_arguments(Bax::Lexer("f({ a: 1, b: { a: 2 } });"), strings, symbols, nodes).size(), 1);
+
+	// The first duplicate in the source, whatever the order of the symbols
+	Bax::Parser parser(Bax::Lexer("f({ b: 1, a: 2, a: 3, b: 4 });"), strings, symbols, nodes);
+	ASSERT_EQ(parser.run(), nullptr);
+	ASSERT_EQ(parser.diagnostics().size(), 1);
+	ASSERT_EQ(parser.diagnostics()[0].message, "Duplicate key 'a' in object expression");
+}
+
+TEST(Parser, PrecedenceAndAssociativity)
+{
+	StringPool strings;
+	SymbolTable symbols;
+	Arena nodes;
+	auto arguments = call_arguments(Bax::Lexer(
+		"f(a - b - c, a ** b ** c, a = b += c, a + b * c - d, a || b && c | d, -a ** b, a * -b + c, a < b == c ?: d ?? e, a += b ? c : d, g(a) + b[c] * d.e);"
+	), strings, symbols, nodes);
+
+	ASSERT_EQ(arguments.size(), 10);
+	ASSERT_EQ(grouping(arguments[0]), "((a b) c)");
+	ASSERT_EQ(grouping(arguments[1]), "(a (b c))");
+	ASSERT_EQ(grouping(arguments[2]), "(a (b c))");
+	ASSERT_EQ(grouping(arguments[3]), "((a (b c)) d)");
+	ASSERT_EQ(grouping(arguments[4]), "(a (b (c d)))");
+	ASSERT_EQ(grouping(arguments[5]), "(!a b)");
+	ASSERT_EQ(grouping(arguments[6]), "((a !b) c)");
+	ASSERT_EQ(grouping(arguments[7]), "((((a b) c) d) e)");
+	ASSERT_EQ(grouping(arguments[8]), "(a TernaryExpression)");
+	ASSERT_EQ(grouping(arguments[9]), "(CallExpression (SubscriptExpression MemberExpression))");
+}
+
+TEST(Parser, LongOperatorChains)
+{
+	// Right-associative chains used to recurse once per operator
+	for (std::string_view op : { " + ", " ** ", " = ", " ?: " }) {
+		std::string source = "x = a";
+		for (size_t i = 0; i < 200'000; ++i) {
+			source += op;
+			source += "a";
+		}
+		source += ";";
+		ASSERT_TRUE(parses(source)) << op;
+	}
+}
+
+TEST(Parser, MaximumDepth)
+{
+	auto nested = [] (size_t depth) {
+		return "x = " + std::string(depth, '(') + "a" + std::string(depth, ')') + ";";
+	};
+
+	// The statement, its expression and each group
+	ASSERT_TRUE(parses(nested(8), 10));
+	ASSERT_FALSE(parses(nested(9), 10));
+	ASSERT_FALSE(parses("{{{{ x = a; }}}}", 4));
+	ASSERT_TRUE(parses("{{{{ x = a; }}}}", 6));
+
+	// Far too deep for the stack, without a limit
+	ASSERT_TRUE(parses(nested(1000)));
+	ASSERT_FALSE(parses(nested(1'000'000)));
+	ASSERT_FALSE(parses("x = " + std::string(1'000'000, '-') + "a;"));
+}
+
+TEST(Parser, EveryErrorIsReported)
+{
+	using Offsets = std::vector<size_t>;
+
+	//                       0         1         2         3         4
+	//                       01234567890123456789012345678901234567890123
+	ASSERT_EQ(error_offsets("{ a = ; f(); let = 1; if (a) { b( } c = 1 }"), Offsets({ 6, 17, 34, 42 }));
+	// Each statement is skipped up to its `;`, the next statement keyword or
+	// the end of its block
+	ASSERT_EQ(error_offsets("{ f(; g(); }"), Offsets({ 4 }));
+	ASSERT_EQ(error_offsets("{ x = ) y = 1; while (a) { x = 2; } a + ; }"), Offsets({ 6, 40 }));
+	ASSERT_EQ(error_offsets("{ ; ; f(); ) }"), Offsets({ 2, 4, 11 }));
+	// Braces are skipped in pairs, the block they are in goes on after them
+	//                       0         1         2         3
+	//                       0123456789012345678901234567890
+	ASSERT_EQ(error_offsets("{ if (a { x = 1; } let c = ; }"), Offsets({ 8, 27 }));
+	ASSERT_EQ(error_offsets("{ x = { 1: 2 }; let y = ; }"), Offsets({ 9, 24 }));
+	// What follows the root statement
+	ASSERT_EQ(error_offsets("{ if (a) { b( } } } c = 1;"), Offsets({ 14, 18 }));
+	// Inside of function bodies
+	ASSERT_EQ(error_offsets("{ f(function () { x = ; }, function () { return ; }); }"), Offsets({ 22, 48 }));
+	ASSERT_EQ(error_offsets("{ f(); "), Offsets({ 7 }));
+	// Once, however deep the expression it is nested in
+	ASSERT_EQ(error_offsets("{ x = (((a + ; y = 1; }"), Offsets({ 13 }));
+	ASSERT_EQ(error_offsets("{ x = " + std::string(2000, '(') + "a" + std::string(2000, ')') + "; }").size(), 1);
+
+	ASSERT_TRUE(error_offsets("{ f(); let a = 1; }").empty());
+}
+
+TEST(Parser, ErrorsAreFoundInOnePass)
+{
+	// One error per statement, at the start of its value
+	std::string source = "{\n";
+	for (size_t i = 0; i < 100'000; ++i)
+		source += "\tx = * 2;\n";
+	source += "}";
+
+	auto offsets = error_offsets(source);
+	ASSERT_EQ(offsets.size(), 100'000);
+	for (size_t i = 0; i < offsets.size(); ++i)
+		ASSERT_EQ(offsets[i], 2 + i * 10 + 5);
+}
@@ -0,0 +1,226 @@
+/*
+** Bax Tests, 2021
+** Benoît Lormeau <blormeau@outlook.com>
+** Unit test
+*/
+
+#include "Bax/Compiler/Compiler.hpp"
+#include "Bax/VM/VM.hpp"
+#include "Common/Log.hpp"
+#include "gtest/gtest.h"
+#include <cstdio>
+#include <string>
+#include <string_view>
+
+// -----------------------------------------------------------------------------
+
+// Compiles and runs `source`, keeping what it printed
+struct Execution
+{
+	Bax::Compiler compiler;
+	Bax::VM vm;
+	bool compiled = false;
+	bool ran = false;
+	std::string output;
+
+	explicit Execution(std::string_view source)
+	{
+		Log::set_level(Log::Critical);
+		compiled = compiler.do_string(source);
+		if (!compiled)
+			return;
+
+		FILE* file = std::tmpfile();
+		vm.set_output(file);
+		ran = vm.run(*compiler.program());
+		std::rewind(file);
+		char buffer[4096];
+		for (size_t n; (n = std::fread(buffer, 1, sizeof(buffer), file)) > 0;)
+			output.append(buffer, n);
+		std::fclose(file);
+		vm.set_output(stdout);
+	}
+
+	// The value returned by the program, as printed
+	std::string result() { return vm.to_string(vm.result()); }
+};
+
+// -----------------------------------------------------------------------------
+
+TEST(VM, Arithmetic)
+{
+	EXPECT_EQ(Execution("return 1 + 2 * 3 - 4 / 2;").result(), "5");
+	EXPECT_EQ(Execution("return (1 + 2) * 3;").result(), "9");
+	EXPECT_EQ(Execution("return 7 / 2;").result(), "3.5");
+	EXPECT_EQ(Execution("return 7 % 3 + 2 ** 10;").result(), "1025");
+	EXPECT_EQ(Execution("return 1 << 4 | 3 & ~1 ^ 8;").result(), "26");
+	EXPECT_EQ(Execution("return -3 + +2;").result(), "-1");
+}
+
+TEST(VM, Concatenation)
+{
+	// Small literals are added as immediates, which concatenate the same
+	EXPECT_EQ(Execution("return \"a\" + 5;").result(), "a5");
+	EXPECT_EQ(Execution("return \"a\" + 500;").result(), "a500");
+	EXPECT_EQ(Execution("return 5 + \"a\";").result(), "5a");
+	EXPECT_EQ(Execution("{ let s = \"a\"; s += 1; return s; }").result(), "a1");
+	EXPECT_EQ(Execution("{ let s = \"a\"; s += -1; return s; }").result(), "a-1");
+}
+
+TEST(VM, Integers)
+{
+	// Overflows become doubles
+	EXPECT_EQ(Execution("return 2147483647 + 1;").result(), "2147483648");
+	EXPECT_EQ(Execution("return -2147483648 - 1;").result(), "-2147483649");
+	EXPECT_EQ(Execution("return 65536 * 65536;").result(), "4294967296");
+	EXPECT_EQ(Execution("{ let i = 2147483647; i++; return i; }").result(), "2147483648");
+	EXPECT_EQ(Execution("return -(-2147483648);").result(), "2147483648");
+	EXPECT_EQ(Execution("return 2 ** 40;").result(), "1099511627776");
+
+	// Which are still integers when they can be
+	EXPECT_EQ(Execution("return 6 / 3;").result(), "2");
+	EXPECT_EQ(Execution("return 7 / 2;").result(), "3.5");
+	EXPECT_EQ(Execution("return -7 % 3;").result(), "-1");
+	EXPECT_EQ(Execution("return 7 % 0;").result(), "nan");
+	EXPECT_EQ(Execution("return 1 << 40;").result(), "1099511627776");
+	EXPECT_EQ(Execution("return 2.5 * 2 | 1;").result(), "5");
+
+	// -0 is only a double
+	EXPECT_EQ(Execution("return 1 / (0 * -1);").result(), "-inf");
+	EXPECT_EQ(Execution("return 1 / (0 / -1);").result(), "-inf");
+	EXPECT_EQ(Execution("return 1 / (-3 % 3);").result(), "-inf");
+	EXPECT_EQ(Execution("{ let z = 0; return 1 / -z; }").result(), "-inf");
+
+	// And the same numbers as doubles
+	EXPECT_EQ(Execution("return 1 == 1.0 && 3 / 2 * 2 == 3 && 0.5 < 1;").result(), "true");
+
+	// Immediates are integers, which only take the fast path with another one
+	EXPECT_EQ(Execution("{ let i = 2147483647; return i + 1; }").result(), "2147483648");
+	EXPECT_EQ(Execution("{ let i = -2147483648; return i - 1; }").result(), "-2147483649");
+	EXPECT_EQ(Execution("{ let x = 0.5; x += 1; return x - 2; }").result(), "-0.5");
+	EXPECT_EQ(Execution("{ let s = \"n\"; let i = 0; while (i < 3) { s += i; i++; } return s; }").result(), "n012");
+	EXPECT_EQ(Execution("{ let s = \"n\"; return s - 1; }").vm.error_message(), "Cannot apply '-' to string and number");
+}
+
+TEST(VM, Logic)
+{
+	EXPECT_EQ(Execution("return 1 && 2;").result(), "2");
+	EXPECT_EQ(Execution("return null || 'd';").result(), "d");
+	EXPECT_EQ(Execution("return 0 ? 1 : 2;").result(), "1");
+	EXPECT_EQ(Execution("return !null;").result(), "true");
+	EXPECT_EQ(Execution("return 1 == 1.0 && \"x\" != \"y\" && \"a\" < \"b\" && 3 <= 3;").result(), "true");
+}
+
+TEST(VM, Loops)
+{
+	Execution run("{ let s = 0; let i = 0; while (i < 100) { s += i; i++; } return s; }");
+	EXPECT_EQ(run.result(), "4950");
+}
+
+TEST(VM, Recursion)
+{
+	Execution run("{ const fib = function(n) { if (n < 2) return n; return fib(n - 1) + fib(n - 2); }; return fib(20); }");
+	EXPECT_EQ(run.result(), "6765");
+}
+
+TEST(VM, Closures)
+{
+	// Each call has its own `n`, which outlives it
+	Execution counters(R"({
+		const counter = function() { let n = 0; return function() { n += 1; return n; }; };
+		const a = counter();
+		const b = counter();
+		a(); a(); b();
+		return a() * 10 + b();
+	})");
+	EXPECT_EQ(counters.result(), "32");
+
+	// Each iteration has its own `j`
+	Execution loop(R"({
+		let fs = [];
+		let i = 0;
+		while (i < 3) { let j = i; fs[] = function() { return j; }; i++; }
+		return fs[0]() + fs[1]() * 10 + fs[2]() * 100;
+	})");
+	EXPECT_EQ(loop.result(), "210");
+}
+
+TEST(VM, Statics)
+{
+	Execution run("{ const f = function() { static let x = 0; x++; return x; }; f(); f(); return f(); }");
+	EXPECT_EQ(run.result(), "3");
+}
+
+TEST(VM, Match)
+{
+	Execution run(R"({
+		const name = function(i) {
+			return match (0) { i % 15 => "FizzBuzz", i % 3 => "Fizz", i % 5 => "Buzz", default => i.toString() };
+		};
+		return name(3) + name(5) + name(15) + name(7);
+	})");
+	EXPECT_EQ(run.result(), "FizzBuzzFizzBuzz7");
+}
+
+TEST(VM, ArraysAndObjects)
+{
+	Execution array("{ let a = [1, 2, 3]; a[] = 4; a.push(5); a[0] = a.pop(); return a.length() * 10 + a[0]; }");
+	EXPECT_EQ(array.result(), "45");
+
+	Execution object("{ let o = { x: 1, y: \"b\" }; o.x += 41; o.z = o; return o.z.y + o.x + o?.w; }");
+	EXPECT_EQ(object.result(), "b42null");
+}
+
+TEST(VM, Output)
+{
+	Execution run("{ let i = 0; while (i < 3) { i++; println(i, \"x\"); } print(true, null, 'c'); }");
+	EXPECT_TRUE(run.ran);
+	EXPECT_EQ(run.output, "1 x\n2 x\n3 x\ntrue null c");
+}
+
+TEST(VM, RuntimeErrors)
+{
+	Execution call("{ let x = null; x(); }");
+	EXPECT_TRUE(call.compiled);
+	EXPECT_FALSE(call.ran);
+	EXPECT_EQ(call.vm.error_message(), "Cannot call null");
+
+	Execution global("undefined_function();");
+	EXPECT_TRUE(global.compiled);
+	EXPECT_FALSE(global.ran);
+
+	Execution overflow("{ const f = function(n) { return f(n + 1); }; f(0); }");
+	EXPECT_FALSE(overflow.ran);
+
+	Execution pop("[].pop();");
+	EXPECT_FALSE(pop.ran);
+
+	Execution substract("{ let s = \"a\"; let n = s - 1; }");
+	EXPECT_TRUE(substract.compiled);
+	EXPECT_FALSE(substract.ran);
+	EXPECT_EQ(substract.vm.error_message(), "Cannot apply '-' to string and number");
+
+	Execution decrement("{ let s = \"a\"; s--; }");
+	EXPECT_FALSE(decrement.ran);
+	EXPECT_EQ(decrement.vm.error_message(), "Cannot apply '-' to string and number");
+}
+
+TEST(VM, CompileErrors)
+{
+	Execution constant("{ const x = 1; x = 2; }");
+	EXPECT_FALSE(constant.compiled);
+	ASSERT_EQ(constant.compiler.diagnostics().size(), 1);
+	EXPECT_EQ(constant.compiler.program(), nullptr);
+
+	Execution redeclared("{ let x = 1; let x = 2; }");
+	EXPECT_FALSE(redeclared.compiled);
+}
+
+TEST(VM, Samples)
+{
+	Log::set_level(Log::Critical);
+	Bax::Compiler compiler;
+	ASSERT_TRUE(compiler.do_file(BAX_SAMPLES_DIR "/001-fizzbuzz.bax"));
+	Bax::VM vm;
+	EXPECT_TRUE(vm.run(*compiler.program()));
+}
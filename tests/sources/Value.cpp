@@ -0,0 +1,123 @@
+/*
+** Bax Tests, 2021
+** Benoît Lormeau <blormeau@outlook.com>
+** Unit test
+*/
+
+#include "Bax/VM/Object.hpp"
+#include "Bax/VM/Value.hpp"
+#include "gtest/gtest.h"
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+
+// -----------------------------------------------------------------------------
+
+using Bax::Value;
+
+TEST(Value, RoundTrips)
+{
+	EXPECT_EQ(sizeof(Value), 8);
+
+	EXPECT_TRUE(Value().is_null());
+	EXPECT_EQ(Value::null().type(), Value::Type::Null);
+
+	EXPECT_TRUE(Value::from_bool(true).to_bool());
+	EXPECT_FALSE(Value::from_bool(false).to_bool());
+	EXPECT_EQ(Value::from_bool(false).type(), Value::Type::Bool);
+
+	for (uint32_t glyph : { 0u, uint32_t('a'), 0x10FFFFu, UINT32_MAX }) {
+		EXPECT_TRUE(Value::from_glyph(glyph).is_glyph());
+		EXPECT_EQ(Value::from_glyph(glyph).to_glyph(), glyph);
+		EXPECT_EQ(Value::from_glyph(glyph).type(), Value::Type::Glyph);
+	}
+
+	for (double number : { 0.0, -0.0, 1.5, -1e300, std::numeric_limits<double>::infinity(),
+	                      -std::numeric_limits<double>::infinity(), std::numeric_limits<double>::denorm_min() }) {
+		auto value = Value::from_number(number);
+		EXPECT_TRUE(value.is_number());
+		EXPECT_EQ(value.type(), Value::Type::Number);
+		EXPECT_EQ(std::signbit(value.to_number()), std::signbit(number));
+		EXPECT_EQ(value.to_number(), number);
+	}
+
+	Bax::String string("bax");
+	auto object = Value::from_object(&string);
+	EXPECT_TRUE(object.is_object());
+	EXPECT_EQ(object.type(), Value::Type::Object);
+	EXPECT_EQ(object.to_object(), &string);
+	EXPECT_EQ(Bax::as<Bax::String>(object), &string);
+	EXPECT_EQ(Bax::as<Bax::Array>(object), nullptr);
+}
+
+TEST(Value, Integers)
+{
+	for (int64_t integer : { int64_t(0), int64_t(-1), int64_t(INT32_MIN), int64_t(INT32_MAX) }) {
+		auto value = Value::from_integer(integer);
+		EXPECT_TRUE(value.is_integer());
+		EXPECT_TRUE(value.is_number());
+		EXPECT_EQ(value.type(), Value::Type::Number);
+		EXPECT_EQ(value.to_integer(), integer);
+		EXPECT_EQ(value.to_number(), integer);
+	}
+
+	// Promoted beyond 32 bits
+	for (int64_t integer : { int64_t(INT32_MIN) - 1, int64_t(INT32_MAX) + 1, int64_t(1) << 53 }) {
+		auto value = Value::from_integer(integer);
+		EXPECT_TRUE(value.is_double());
+		EXPECT_EQ(value.to_number(), integer);
+	}
+}
+
+TEST(Value, NaNsStayNumbers)
+{
+	// Negative quiet NaNs with a payload share their bits with tagged values
+	for (uint64_t bits : { 0x7FF8000000000000ull, 0xFFF8000000000000ull, 0xFFFA000000000001ull, 0xFFFD123456789ABCull }) {
+		auto value = Value::from_number(std::bit_cast<double>(bits));
+		EXPECT_TRUE(value.is_number());
+		EXPECT_TRUE(std::isnan(value.to_number()));
+	}
+	// As computed by the hardware, negative on x86
+	volatile double minus_one = -1;
+	EXPECT_TRUE(Value::from_number(std::sqrt(minus_one)).is_number());
+}
+
+TEST(Value, TypesAreExclusive)
+{
+	Bax::Array array;
+	Value values[] = { Value::from_number(0), Value::null(), Value::from_bool(false), Value::from_glyph(0), Value::from_object(&array), Value::from_integer(0) };
+	for (size_t i = 0; i < std::size(values); ++i) {
+		EXPECT_EQ(static_cast<size_t>(values[i].type()), i % 5);
+		EXPECT_EQ(values[i].is_number(), i == 0 || i == 5);
+		EXPECT_EQ(values[i].is_double(), i == 0);
+		EXPECT_EQ(values[i].is_integer(), i == 5);
+		EXPECT_EQ(values[i].is_null(), i == 1);
+		EXPECT_EQ(values[i].is_bool(), i == 2);
+		EXPECT_EQ(values[i].is_glyph(), i == 3);
+		EXPECT_EQ(values[i].is_object(), i == 4);
+		for (size_t j = 0; j < std::size(values); ++j)
+			EXPECT_EQ(values[i].is_same(values[j]), i == j);
+	}
+}
+
+TEST(Value, Truthiness)
+{
+	EXPECT_FALSE(Value::null().truthy());
+	EXPECT_FALSE(Value::from_bool(false).truthy());
+	EXPECT_TRUE(Value::from_bool(true).truthy());
+	EXPECT_TRUE(Value::from_number(0).truthy());
+	EXPECT_TRUE(Value::from_integer(0).truthy());
+	EXPECT_TRUE(Value::from_number(NAN).truthy());
+	EXPECT_TRUE(Value::from_glyph(0).truthy());
+}
+
+#ifdef BAX_CHECK_VALUES
+TEST(Value, ChecksBoxing)
+{
+	EXPECT_DEATH(Value::null().to_number(), "Assertion failed");
+	EXPECT_DEATH(Value::from_number(1).to_object(), "Assertion failed");
+	EXPECT_DEATH(Value::from_number(1).to_integer(), "Assertion failed");
+	EXPECT_DEATH(Value::from_object(reinterpret_cast<Bax::Object*>(0xFFFF000000000000ull)), "Assertion failed");
+}
+#endif